@@ -3,8 +3,12 @@ module BLAKE2
        ) where
 import           Criterion.Main
 import           Crypto.Hash.BLAKE2
+import           Crypto.KDF.BLAKE2
+import           Crypto.Key
 
 import qualified Data.ByteString    as B
+import           Data.Maybe         (fromJust)
+import           Data.Word
 
 import           Util               ()
 
@@ -14,4 +18,15 @@ benchmarks = return
   , bench "blake2bp" $ nf blake2bp (B.replicate 512 3)
   , bench "blake2s"  $ nf blake2s  (B.replicate 512 3)
   , bench "blake2sp" $ nf blake2sp (B.replicate 512 3)
+  , bench "kdf (64 x concat+blake2b)" $ nf (map labelled) [0..63]
+  , bench "kdf (64 x deriveKey)" $ nf (map (unSecretKey . derive1)) [0..63]
+  , bench "kdf (deriveKeys 64)"  $ nf (map unSecretKey . deriveN) [0..63]
   ]
+  where
+    master = fromJust $ masterKey (B.replicate 32 7)
+    ctx    = fromJust $ context "bench"
+    labelled i = B.take 32 $ blake2b (B.concat [B.replicate 32 7, B.pack [i]])
+    derive1 :: Word64 -> SecretKey ()
+    derive1 i = deriveKey master i ctx
+    deriveN :: [Word64] -> [SecretKey ()]
+    deriveN is = deriveKeys master is ctx
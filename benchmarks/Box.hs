@@ -8,6 +8,7 @@ import           Crypto.Nonce
 
 import           Data.ByteString    (ByteString)
 import qualified Data.ByteString    as B
+import           Data.Maybe         (fromJust, listToMaybe)
 
 import           Util               ()
 
@@ -21,11 +22,18 @@ benchmarks = do
   let dummy512 = B.replicate 512 3
       nm1      = createNM pk1 sk2
       nm2      = createNM pk2 sk1
+      -- 256 candidates, the right one last
+      nms      = [ fromJust (nmFromBytes (B.replicate 32 (fromIntegral i)))
+                 | i <- [1 .. 255 :: Int] ]
+                 ++ [nm2]
+      enc512   = encryptNM nm1 nonce dummy512
   return [ bgroup "full"
            [ bench "roundtrip 512" $ nf (roundtrip kp1 kp2 nonce) dummy512
            ]
          , bgroup "nm"
            [ bench "roundtrip 512" $ nf (roundtripNM nm1 nm2 nonce) dummy512
+           , bench "decryptNM each of 256, 512" $ nf (tryEach nms nonce) enc512
+           , bench "trialOpen 256, 512" $ nf (trialOpen nms nonce) enc512
            ]
          ]
 
@@ -40,3 +48,7 @@ roundtripNM nm1 nm2 nonce xs =
   let enc = encryptNM nm1 nonce xs
       dec = decryptNM nm2 nonce enc
   in maybe False (== xs) dec
+
+tryEach :: [NM] -> Nonce Box -> ByteString -> Maybe (Int, ByteString)
+tryEach nms nonce c =
+  listToMaybe [ (i, m) | (i, nm) <- zip [0..] nms, Just m <- [decryptNM nm nonce c] ]
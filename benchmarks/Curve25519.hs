@@ -19,8 +19,10 @@ benchmarks :: IO [Benchmark]
 benchmarks = do
   keys1@(p1,_s2) <- createKeypair
   keys2@(_p2,s1) <- createKeypair
+  let prep = preparePeerKey p1
   return [ bench "createKeypair" $ nfIO createKeypair
          , bench "curve25519"    $ nf (curve25519 s1) p1
+         , bench "curve25519Prepared" $ nf (curve25519Prepared s1) prep
          , bench "roundtrip"     $ nf (roundtrip keys1) keys2
          ]
 
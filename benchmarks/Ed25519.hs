@@ -17,12 +17,19 @@ instance NFData (PublicKey t)
 benchmarks :: IO [Benchmark]
 benchmarks = do
   keys@(pk,sk) <- createKeypair
+  (pks, _) <- createKeypairArrays 64
   let dummy = B.replicate 512 3
       msg = sign sk dummy
+      Just prep = prepareKey pk
+      items = replicate 64 (pk, dummy, sign' sk dummy)
   return [ bench "keypair"   $ nfIO createKeypair
+         , bench "keypairs (64)" $ nfIO (createKeypairs 64)
          , bench "sign"      $ nf (sign sk)        dummy
          , bench "verify"    $ nf (verify pk)      msg
          , bench "roundtrip" $ nf (signBench keys) dummy
+         , bench "prepareKeys (64)" $ nf (snd . prepareKeys) pks
+         , bench "verifyPrepared"   $ nf (verifyPrepared prep) msg
+         , bench "verifyMany (64)"  $ nf verifyMany items
          ]
 
 signBench :: (PublicKey Ed25519, SecretKey Ed25519) -> B.ByteString -> Bool
@@ -5,6 +5,7 @@ module Nonce
 import           Criterion.Main
 import           Crypto.Encrypt.Box
 import           Crypto.Nonce
+import           Crypto.Nonce.Replay
 
 import           Control.DeepSeq
 
@@ -16,5 +17,13 @@ instance (Nonces t, NFData t) => NFData (Nonce t)
 benchmarks :: IO [Benchmark]
 benchmarks = do
   n <- randomNonce :: IO (Nonce Box)
+  let ns = take 64 (iterate incNonce n)
+      fresh f = newReplayWindow 2048 >>= f
   return [ bench "increment" $ nf incNonce n
+         , bench "show"      $ nf show n
+         , bench "read"      $ nf (read :: String -> Nonce Box) (show n)
+         , bench "checkAndMark (64)" $
+             nfIO (fresh $ \w -> mapM (checkAndMark w) ns)
+         , bench "checkAndMarkMany (64)" $
+             nfIO (fresh $ \w -> checkAndMarkMany w ns)
          ]
@@ -18,9 +18,12 @@ benchmarks = do
   let dummy = B.replicate 512 3
       k     = SecretKey (B.replicate 32 3)
       msg   = authenticate k dummy
+      short = replicate 64 (k, B.take 64 dummy)
   return [ bench "authenticate" $ nf (authenticate k) dummy
          , bench "verify"       $ nf (verify k)       msg
          , bench "roundtrip"    $ nf (roundtrip k)    dummy
+         , bench "authenticate (64 x 64B)" $ nf (map (uncurry authenticate)) short
+         , bench "authenticateMany (64 x 64B)" $ nf authenticateMany short
          ]
 
 roundtrip :: SecretKey Poly1305 -> B.ByteString -> Bool
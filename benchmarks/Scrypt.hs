@@ -0,0 +1,20 @@
+module Scrypt
+       ( benchmarks -- :: IO [Benchmark]
+       ) where
+import           Criterion.Main
+import           Crypto.KDF.Scrypt
+
+import qualified Data.ByteString   as B
+import           Data.Maybe        (fromJust)
+
+import           Util              ()
+
+-- ROMix is bound by memory latency once V (128*r*N bytes) no longer
+-- fits in cache, so this covers both sides of that line.
+benchmarks :: IO [Benchmark]
+benchmarks = do
+  salt <- newSalt
+  let pass = B.replicate 16 3
+      at logN = bench ("stretch N=2^" ++ show logN ++ ", r=8") $
+                  nf (stretch (fromJust $ scryptParams logN 8 1) 32 salt) pass
+  return [ at 10, at 14, at 17 ]
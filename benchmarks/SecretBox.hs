@@ -8,15 +8,32 @@ import           Crypto.Nonce
 
 import           Data.ByteString          (ByteString)
 import qualified Data.ByteString          as B
+import           Data.ByteString.Builder
+import qualified Data.ByteString.Lazy     as L
+import           Data.Monoid              (mconcat, (<>))
+import           Foreign.Marshal.Alloc    (allocaBytes)
 
 import           Util                     ()
 
 benchmarks :: IO [Benchmark]
 benchmarks = do
   key   <- randomKey
+  key'  <- randomKey
   nonce <- randomNonce
   let dummy512 = B.replicate 512 3
+      enc64k   = encrypt nonce (B.replicate 65536 3) key
+      build64k = mconcat (replicate 1024 (word64LE 3 <> byteString (B.replicate 56 3)))
   return [ bench "roundtrip 512" $ nf (roundtrip key nonce) dummy512
+         , bench "decrypt/encrypt 64k" $ nf (rotate key nonce key') enc64k
+         , bench "reseal 64k" $ nf (reseal key nonce key' nonce) enc64k
+         , bench "build, then encrypt 64k" $
+             nf (\b -> encrypt nonce (L.toStrict (toLazyByteString b)) key) build64k
+         , bench "sealedBuilder 64k" $
+             nf (L.toStrict . toLazyByteString . sealedBuilder key nonce) build64k
+         , bench "decrypt 64k" $ nf (\c -> decrypt nonce c key) enc64k
+         , bench "openInto 64k" $
+             nfIO (allocaBytes 65536 $ openInto nonce enc64k key)
+         , bench "verifyOnly 64k" $ nf (\c -> verifyOnly nonce c key) enc64k
          ]
 
 roundtrip :: SecretKey SecretBox -> Nonce SecretBox -> ByteString -> Bool
@@ -24,3 +41,7 @@ roundtrip key nonce xs =
   let enc = encrypt nonce xs key
       dec = decrypt nonce enc key
   in maybe False (== xs) dec
+
+rotate :: SecretKey SecretBox -> Nonce SecretBox -> SecretKey SecretBox
+       -> ByteString -> Maybe ByteString
+rotate key nonce key' xs = fmap (\p -> encrypt nonce p key') (decrypt nonce xs key)
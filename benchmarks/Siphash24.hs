@@ -3,11 +3,14 @@ module Siphash24
        ( benchmarks -- :: IO [Benchmark]
        ) where
 import           Criterion.Main
+import           Crypto.Hash.Placement
 import           Crypto.Key
 import           Crypto.MAC.Siphash24
 
 import           Control.DeepSeq
 import qualified Data.ByteString      as B
+import qualified Data.ByteString.Char8 as BC
+import           Data.Maybe           (fromJust)
 
 import           Util                 ()
 
@@ -18,9 +21,14 @@ benchmarks = do
   let dummy = B.replicate 512 3
       k     = SecretKey (B.replicate 16 3)
       msg   = authenticate k dummy
+      pk    = SecretKey (B.replicate 16 3)
+      keys  = [ BC.pack ("user:" ++ show i) | i <- [1..1000 :: Int] ]
+      ns    = fromJust $ nodes pk [ BC.pack ("node" ++ show i) | i <- [1..64 :: Int] ]
   return [ bench "authenticate" $ nf (authenticate k) dummy
          , bench "verify"       $ nf (verify k)       msg
          , bench "roundtrip"    $ nf (roundtrip k)    dummy
+         , bench "jumpMany (1000 keys, 1000 buckets)" $ nf (jumpMany pk 1000) keys
+         , bench "rendezvousMany (1000 keys, 64 nodes)" $ nf (rendezvousMany ns) keys
          ]
 
 roundtrip :: SecretKey Siphash24 -> B.ByteString -> Bool
@@ -14,6 +14,7 @@ import           HMACSHA512     (benchmarks)
 import           Nonce          (benchmarks)
 import           Poly1305       (benchmarks)
 import           Random         (benchmarks)
+import           Scrypt         (benchmarks)
 import           SecretBox      (benchmarks)
 import           SHA            (benchmarks)
 import           Siphash24      (benchmarks)
@@ -33,6 +34,7 @@ main = mapM (uncurry bencher) suites >>= defaultMain
              , ("Nonce",            Nonce.benchmarks)
              , ("Poly1305",         Poly1305.benchmarks)
              , ("Random",           Random.benchmarks)
+             , ("Scrypt",           Scrypt.benchmarks)
              , ("SecretBox",        SecretBox.benchmarks)
              , ("SHA",              SHA.benchmarks)
              , ("Siphash24",        Siphash24.benchmarks)
@@ -53,10 +53,18 @@ module Crypto.Encrypt.Box
 
          -- ** Example usage
          -- $precompExample
-       , NM        -- :: *
-       , createNM  -- :: PublicKey Box -> SecretKey Box -> NM
-       , encryptNM -- :: NM -> Nonce Box -> ByteString -> ByteString
-       , decryptNM -- :: NM -> Nonce Box -> ByteString -> Maybe ByteString
+       , NM          -- :: *
+       , createNM    -- :: PublicKey Box -> SecretKey Box -> NM
+       , nmToBytes   -- :: NM -> ByteString
+       , nmFromBytes -- :: ByteString -> Maybe NM
+       , encryptNM   -- :: NM -> Nonce Box -> ByteString -> ByteString
+       , decryptNM   -- :: NM -> Nonce Box -> ByteString -> Maybe ByteString
+       , trialOpen   -- :: [NM] -> Nonce Box -> ByteString -> Maybe (Int, ByteString)
+
+         -- ** Prepared peer keys
+       , PreparedPeerKey     -- :: * -> *
+       , preparePeerKey      -- :: PublicKey t -> PreparedPeerKey t
+       , createNMPrepared    -- :: PreparedPeerKey Box -> SecretKey Box -> NM
        ) where
 import           Data.Word
 import           Foreign.C.Types
@@ -69,6 +77,8 @@ import           Data.ByteString          as S
 import           Data.ByteString.Internal as SI
 import           Data.ByteString.Unsafe   as SU
 
+import           Crypto.DH.Curve25519     (preparePeerKey)
+import           Crypto.Internal.Curve25519
 import           Crypto.Key
 import           Crypto.Nonce
 
@@ -235,6 +245,18 @@ decrypt (Nonce n) cipher (PublicKey pk) (SecretKey sk) = unsafePerformIO $ do
 -- interface.
 newtype NM = NM ByteString deriving (Eq, Show)
 
+-- | The raw bytes of an @'NM'@, e.g. for storing it. They are just as
+-- sensitive as the secret key the @'NM'@ was computed from.
+nmToBytes :: NM -> ByteString
+nmToBytes (NM nm) = nm
+
+-- | Rebuild an @'NM'@ from the bytes given by @'nmToBytes'@. Returns
+-- @'Nothing'@ unless there are exactly 32 of them.
+nmFromBytes :: ByteString -> Maybe NM
+nmFromBytes xs
+  | S.length xs == boxBEFORENMBYTES = Just (NM xs)
+  | otherwise                       = Nothing
+
 -- | Creates an intermediate piece of @'NM'@ data for
 -- sending\/receiving messages to\/from the same person. The resulting
 -- @'NM'@ can be used for any number of messages between
@@ -251,6 +273,24 @@ createNM (PublicKey pk) (SecretKey sk) = unsafePerformIO $ do
   return $! NM $ SI.fromForeignPtr nm 0 boxBEFORENMBYTES
 {-# INLINE createNM #-}
 
+-- | Like @'createNM'@, but against a peer key prepared with
+-- @'preparePeerKey'@. Useful when one peer key is combined with many
+-- secret keys (e.g. a server key and a stream of ephemeral client
+-- keys); the result is always the same as @'createNM'@.
+--
+-- >>> let bob = preparePeerKey bobPk
+-- >>> createNMPrepared bob aliceSk == createNM bobPk aliceSk
+-- True
+createNMPrepared :: PreparedPeerKey Box -> SecretKey Box -> NM
+createNMPrepared (PreparedPeerKey pk Nothing) sk = createNM pk sk
+createNMPrepared (PreparedPeerKey _ (Just table)) (SecretKey sk) = unsafePerformIO $ do
+  nm <- SI.mallocByteString boxBEFORENMBYTES
+  _ <- withForeignPtr nm $ \pnm ->
+    SU.unsafeUseAsCString table $ \ptable ->
+      SU.unsafeUseAsCString sk $ \psk ->
+        c_crypto_box_beforenm_prepared pnm ptable psk
+  return $! NM $ SI.fromForeignPtr nm 0 boxBEFORENMBYTES
+
 -- | Encrypt data from a specific sender to a specific receiver with
 -- some precomputed @'NM'@ data.
 encryptNM :: NM -> Nonce Box -> ByteString -> ByteString
@@ -287,6 +327,42 @@ decryptNM (NM nm) (Nonce n) cipher = unsafePerformIO $ do
             else Just $ SI.fromForeignPtr m zeroBYTES (clen - zeroBYTES)
 {-# INLINE decryptNM #-}
 
+-- | @'trialOpen' nms nonce c@ decrypts @c@ with the first of the
+-- candidate @nms@ it was encrypted under, returning that @'NM'@'s
+-- position in the list along with the plaintext. This is the same as
+-- trying @'decryptNM'@ with each candidate in turn, for receivers who
+-- cannot tell who sent a message.
+--
+-- It is much cheaper than that, though: for each candidate, only the
+-- Poly1305 key is derived (eight candidates at a time, on machines
+-- with AVX2) and the tag checked, without allocating anything per
+-- candidate. Only once a candidate matches is the plaintext
+-- allocated, and the message decrypted under that candidate alone.
+--
+-- >>> let nms = [createNM alicePk bobSk, createNM bobPk bobSk]
+-- >>> nonce <- randomNonce :: IO (Nonce Box)
+-- >>> trialOpen nms nonce (encryptNM (createNM bobPk aliceSk) nonce "Hello")
+-- Just (0,"Hello")
+trialOpen :: [NM] -> Nonce Box -> ByteString -> Maybe (Int, ByteString)
+trialOpen nms (Nonce n) cipher
+  | clen < boxZEROBYTES || Prelude.null nms = Nothing
+  | otherwise = unsafePerformIO $ do
+      r <- trial nullPtr nms
+      if r < 0 then return Nothing else do
+        let i = fromIntegral r
+        m <- SI.create mlen $ \pm -> trial pm [nms !! i] >> return ()
+        return $! Just (i, m)
+  where
+    -- With a null output, the C side only searches.
+    trial pm ks =
+      SU.unsafeUseAsCString cipher $ \pc ->
+        SU.unsafeUseAsCString n $ \pn ->
+          SU.unsafeUseAsCString (S.concat (Prelude.map nmToBytes ks)) $ \pks ->
+            c_crypto_box_trial_open_afternm pm pc (fromIntegral clen) pn
+              pks (fromIntegral (Prelude.length ks))
+    clen = S.length cipher
+    mlen = clen - boxZEROBYTES
+
 -- $precompExample
 -- >>> let aliceNM = createNM bobPk aliceSk
 -- >>> let bobNM   = createNM alicePk bobSk
@@ -332,6 +408,9 @@ foreign import ccall unsafe "curve25519xsalsa20poly1305_box_open"
 foreign import ccall unsafe "curve25519xsalsa20poly1305_box_beforenm"
   c_crypto_box_beforenm :: Ptr Word8 -> Ptr CChar -> Ptr CChar -> IO Int
 
+foreign import ccall unsafe "curve25519xsalsa20poly1305_box_beforenm_prepared"
+  c_crypto_box_beforenm_prepared :: Ptr Word8 -> Ptr CChar -> Ptr CChar -> IO Int
+
 foreign import ccall unsafe "curve25519xsalsa20poly1305_box_afternm"
   c_crypto_box_afternm :: Ptr Word8 -> Ptr CChar -> CULLong ->
                           Ptr CChar -> Ptr CChar -> IO Int
@@ -339,3 +418,7 @@ foreign import ccall unsafe "curve25519xsalsa20poly1305_box_afternm"
 foreign import ccall unsafe "curve25519xsalsa20poly1305_box_open_afternm"
   c_crypto_box_open_afternm :: Ptr Word8 -> Ptr CChar -> CULLong ->
                                Ptr CChar -> Ptr CChar -> IO Int
+
+foreign import ccall unsafe "curve25519xsalsa20poly1305_box_trial_open_afternm"
+  c_crypto_box_trial_open_afternm :: Ptr Word8 -> Ptr CChar -> CULLong ->
+                                     Ptr CChar -> Ptr CChar -> CULLong -> IO CInt
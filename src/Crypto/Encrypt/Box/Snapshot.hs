@@ -0,0 +1,195 @@
+-- |
+-- Module      : Crypto.Encrypt.Box.Snapshot
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- Persistent snapshots of precomputed @'NM'@ values.
+--
+-- A service talking to thousands of peers has to run @'createNM'@
+-- (a full Curve25519 scalar multiplication) for every one of them
+-- before it can serve traffic. A @'Snapshot'@ lets you save those
+-- values to disk and load them back on the next start, so a warm
+-- restart costs a single decryption instead.
+--
+-- Every entry is filed under a fingerprint of the key pair it was
+-- computed from, so if either key changes the old entry simply stops
+-- matching and @'lookupNM'@ recomputes it. Snapshots are encrypted
+-- and authenticated with a @'SecretBox'@ key, since an @'NM'@ is just
+-- as sensitive as the secret key it came from; a snapshot which is
+-- corrupt, truncated, from another format version or sealed with a
+-- different key is treated as empty.
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with other cryptographic primitives, e.g.
+--
+-- > import qualified Crypto.Encrypt.Box.Snapshot as Snapshot
+--
+module Crypto.Encrypt.Box.Snapshot
+       ( -- * Types
+         Snapshot          -- :: *
+       , emptySnapshot     -- :: Snapshot
+       , snapshotSize      -- :: Snapshot -> Int
+
+         -- * Building snapshots
+       , precompute        -- :: SecretKey Box -> [PublicKey Box] -> Snapshot
+       , insertNM          -- :: PublicKey Box -> SecretKey Box -> NM -> Snapshot -> Snapshot
+       , lookupNM          -- :: Snapshot -> PublicKey Box -> SecretKey Box -> NM
+
+         -- * Serialization
+         -- ** Example usage
+         -- $example
+       , encodeSnapshot    -- :: SecretKey SecretBox -> Nonce SecretBox -> Snapshot -> ByteString
+       , decodeSnapshot    -- :: SecretKey SecretBox -> ByteString -> Maybe Snapshot
+       , writeSnapshot     -- :: FilePath -> SecretKey SecretBox -> Snapshot -> IO ()
+       , readSnapshot      -- :: FilePath -> SecretKey SecretBox -> IO Snapshot
+       ) where
+import           Control.Exception        (IOException, onException, try)
+import           Data.Bits                (shiftR)
+import           Data.List                (foldl')
+import           Data.Maybe               (fromMaybe)
+import           Data.Word
+import           System.Directory         (removeFile, renameFile)
+import           System.FilePath          (takeDirectory, takeFileName, (<.>))
+import           System.IO                (hClose, openBinaryTempFile)
+
+import           Data.Map                 (Map)
+import qualified Data.Map                 as M
+
+import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as S
+import qualified Data.ByteString.Char8    as S8
+
+import           Crypto.Encrypt.Box
+import           Crypto.Encrypt.SecretBox (SecretBox)
+import qualified Crypto.Encrypt.SecretBox as SecretBox
+import           Crypto.Hash.BLAKE2       (blake2b)
+import           Crypto.Key
+import           Crypto.Nonce
+
+-- $setup
+-- >>> import qualified Crypto.Encrypt.SecretBox as SecretBox
+-- >>> (pk1, sk1) <- createKeypair
+-- >>> (pk2, sk2) <- createKeypair
+
+-- | A collection of precomputed @'NM'@ values, each filed under the
+-- key pair it was computed from.
+newtype Snapshot = Snapshot (Map ByteString NM)
+  deriving Eq
+
+-- | A @'Snapshot'@ with no entries.
+emptySnapshot :: Snapshot
+emptySnapshot = Snapshot M.empty
+
+-- | The number of entries in a @'Snapshot'@.
+snapshotSize :: Snapshot -> Int
+snapshotSize (Snapshot m) = M.size m
+
+-- | Compute the @'NM'@ between a secret key and each of the given
+-- peers.
+precompute :: SecretKey Box -> [PublicKey Box] -> Snapshot
+precompute sk = foldl' (\s pk -> insertNM pk sk (createNM pk sk) s) emptySnapshot
+
+-- | Record the @'NM'@ for a key pair.
+insertNM :: PublicKey Box -> SecretKey Box -> NM -> Snapshot -> Snapshot
+insertNM pk sk nm (Snapshot m) = Snapshot (M.insert (fingerprint pk sk) nm m)
+
+-- | Find the @'NM'@ for a key pair, computing it with @'createNM'@ if
+-- the snapshot has no (current) entry for it.
+--
+-- >>> let snap = precompute sk1 [pk2]
+-- >>> lookupNM snap pk2 sk1 == createNM pk2 sk1
+-- True
+lookupNM :: Snapshot -> PublicKey Box -> SecretKey Box -> NM
+lookupNM (Snapshot m) pk sk =
+  case M.lookup (fingerprint pk sk) m of
+    Just nm -> nm
+    Nothing -> createNM pk sk
+
+-- $example
+-- >>> key   <- SecretBox.randomKey
+-- >>> nonce <- randomNonce :: IO (Nonce SecretBox)
+-- >>> let snap = precompute sk1 [pk2]
+-- >>> decodeSnapshot key (encodeSnapshot key nonce snap) == Just snap
+-- True
+
+-- | Serialize and seal a @'Snapshot'@. The nonce must never be reused
+-- with the same key; @'writeSnapshot'@ picks a random one.
+encodeSnapshot :: SecretKey SecretBox -> Nonce SecretBox -> Snapshot -> ByteString
+encodeSnapshot key nonce@(Nonce n) (Snapshot m) =
+  S.concat [ magic, word32 snapshotVERSION, n
+           , SecretBox.encrypt nonce payload key ]
+  where payload = S.concat [ S.append fp (nmToBytes nm) | (fp, nm) <- M.toList m ]
+
+-- | Open a sealed @'Snapshot'@. Returns @'Nothing'@ if the input is
+-- malformed, from a different format version, or fails to
+-- authenticate under the given key.
+decodeSnapshot :: SecretKey SecretBox -> ByteString -> Maybe Snapshot
+decodeSnapshot key xs
+  | S.length xs < headerLen              = Nothing
+  | S.take 8 xs /= magic                 = Nothing
+  | S.take 4 (S.drop 8 xs) /= word32 snapshotVERSION = Nothing
+  | otherwise = do
+      let n = Nonce (S.take 24 (S.drop 12 xs))
+      payload <- SecretBox.decrypt n (S.drop headerLen xs) key
+      if S.length payload `mod` entryLen /= 0
+        then Nothing
+        else (Snapshot . M.fromList) `fmap` entries payload
+  where
+    headerLen = 8 + 4 + 24
+    entries p
+      | S.null p  = Just []
+      | otherwise = do
+          let (e, rest) = S.splitAt entryLen p
+              (fp, xs)  = S.splitAt fingerprintBYTES e
+          nm <- nmFromBytes xs
+          ((fp, nm) :) `fmap` entries rest
+
+-- | Seal a @'Snapshot'@ under a fresh random nonce and write it to a
+-- file. The snapshot is written to a temporary file in the same
+-- directory and then renamed over @path@, so a crash part way through
+-- leaves the previous snapshot in place rather than a truncated one.
+writeSnapshot :: FilePath -> SecretKey SecretBox -> Snapshot -> IO ()
+writeSnapshot path key snap = do
+  nonce <- randomNonce
+  (tmp, h) <- openBinaryTempFile (takeDirectory path) (takeFileName path <.> "tmp")
+  (S.hPut h (encodeSnapshot key nonce snap) >> hClose h >> renameFile tmp path)
+    `onException` (hClose h >> removeFile tmp)
+
+-- | Load a @'Snapshot'@ written by @'writeSnapshot'@. A missing,
+-- stale or damaged file yields @'emptySnapshot'@, in which case
+-- @'lookupNM'@ recomputes every entry on demand.
+readSnapshot :: FilePath -> SecretKey SecretBox -> IO Snapshot
+readSnapshot path key = do
+  r <- try (S.readFile path) :: IO (Either IOException ByteString)
+  return $! case r of
+    Left _   -> emptySnapshot
+    Right xs -> fromMaybe emptySnapshot (decodeSnapshot key xs)
+
+--
+-- Utilities
+--
+
+-- Entries are keyed by a hash over both halves of the key pair, so
+-- a rotated key on either side never matches a stale entry.
+fingerprint :: PublicKey Box -> SecretKey Box -> ByteString
+fingerprint (PublicKey pk) (SecretKey sk) =
+  S.take fingerprintBYTES $ blake2b (S.concat [S8.pack "nacl-nm", sk, pk])
+
+word32 :: Word32 -> ByteString
+word32 w = S.pack [ fromIntegral (w `shiftR` s) | s <- [0,8,16,24] ]
+
+magic :: ByteString
+magic = S8.pack "NACLSNAP"
+
+snapshotVERSION :: Word32
+snapshotVERSION = 1
+
+fingerprintBYTES :: Int
+fingerprintBYTES = 32
+
+entryLen :: Int
+entryLen = fingerprintBYTES + 32
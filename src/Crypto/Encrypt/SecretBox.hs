@@ -36,19 +36,46 @@ module Crypto.Encrypt.SecretBox
          -- $example
        , encrypt -- :: Nonce SecretBox -> ByteString -> SecretKey SecretBox -> ByteString
        , decrypt -- :: Nonce SecretBox -> ByteString -> SecretKey SecretBox -> Maybe ByteString
+
+         -- * Decrypting without allocating
+       , openInto     -- :: Nonce SecretBox -> ByteString -> SecretKey SecretBox -> Ptr Word8 -> IO Bool
+       , verifyOnly   -- :: Nonce SecretBox -> ByteString -> SecretKey SecretBox -> Bool
+       , verifyHandle -- :: Nonce SecretBox -> Handle -> SecretKey SecretBox -> IO Bool
+
+         -- * Rotating keys
+       , reseal     -- :: SecretKey SecretBox -> Nonce SecretBox -> SecretKey SecretBox -> Nonce SecretBox -> ByteString -> Maybe ByteString
+       , resealMany -- :: SecretKey SecretBox -> SecretKey SecretBox -> [(Nonce SecretBox, Nonce SecretBox, ByteString)] -> [Maybe ByteString]
+
+         -- * Encrypting builders
+       , sealedBuilder -- :: SecretKey SecretBox -> Nonce SecretBox -> Builder -> Builder
+       , openSealed    -- :: SecretKey SecretBox -> Nonce SecretBox -> ByteString -> Maybe ByteString
+
+         -- * Encrypting file descriptors
+       , encryptFd -- :: Nonce SecretBox -> Fd -> Fd -> SecretKey SecretBox -> IO Integer
+       , decryptFd -- :: Nonce SecretBox -> Fd -> Fd -> SecretKey SecretBox -> IO (Maybe Integer)
        ) where
+import           Control.Monad            (when)
 import           Data.Word
+import           Foreign.C.Error
 import           Foreign.C.Types
-import           Foreign.ForeignPtr       (withForeignPtr)
+import           Foreign.ForeignPtr       (mallocForeignPtrBytes,
+                                           withForeignPtr)
+import           Foreign.Marshal.Alloc    (allocaBytes)
+import           Foreign.Marshal.Array    (allocaArray, peekArray, withArray)
 import           Foreign.Ptr
+import           System.IO                (Handle, hGetBuf)
+import           System.Posix.Types       (Fd(..))
 
 
 import           System.IO.Unsafe         (unsafePerformIO)
 
 import           Data.ByteString          as S
+import           Data.ByteString.Builder  (Builder)
 import           Data.ByteString.Internal as SI
 import           Data.ByteString.Unsafe   as SU
 
+import           Crypto.Internal.Builder
+import           Crypto.Internal.Parallel
 import           Crypto.Key
 import           Crypto.Nonce
 import           System.Crypto.Random
@@ -137,6 +164,301 @@ decrypt (Nonce n) cipher (SecretKey k) = unsafePerformIO $ do
   return $! if r /= 0 then Nothing
             else Just $ SI.fromForeignPtr m zeroBYTES (clen - zeroBYTES)
 
+-- | @'openInto' n c k dst@ verifies and decrypts the ciphertext @c@
+-- (as returned by @'encrypt'@) into the @'S.length' c - 16@ bytes at
+-- @dst@, returning whether it verified. Nothing is allocated, so
+-- @dst@ can be, e.g., a memory mapped file as large as the message.
+--
+-- The whole tag is checked before anything is decrypted, so if @c@
+-- is forged @dst@ is left untouched and unverified plaintext is never
+-- written anywhere. This costs a second pass over @c@, which is
+-- noticeable once @c@ no longer fits in cache; for small messages
+-- @'decrypt'@ is just as fast.
+--
+-- >>> key <- randomKey
+-- >>> nonce <- randomNonce :: IO (Nonce SecretBox)
+-- >>> let c = encrypt nonce "Hello" key
+-- >>> allocaBytes 5 $ \p -> openInto nonce c key p >>= \ok -> fmap ((,) ok) (packCStringLen (castPtr p, 5))
+-- (True,"Hello")
+openInto :: Nonce SecretBox
+         -- ^ Nonce
+         -> ByteString
+         -- ^ Input
+         -> SecretKey SecretBox
+         -- ^ Shared @'SecretKey'@
+         -> Ptr Word8
+         -- ^ Destination for the plaintext
+         -> IO Bool
+         -- ^ Whether @c@ verified
+openInto (Nonce n) cipher (SecretKey k) dst =
+  SU.unsafeUseAsCStringLen cipher $ \(pc, clen) ->
+    SU.unsafeUseAsCString n $ \pn ->
+      SU.unsafeUseAsCString k $ \pk -> do
+        r <- c_crypto_secretbox_open_into dst pc (fromIntegral clen) pn pk
+        return (r == 0)
+
+-- | Check that a ciphertext (as returned by @'encrypt'@) is
+-- authentic, without decrypting it. This costs about a sixth as much
+-- as @'decrypt'@ and allocates nothing, so it is suitable for
+-- checking large or memory mapped ciphertexts before they are used.
+--
+-- >>> key <- randomKey
+-- >>> nonce <- randomNonce :: IO (Nonce SecretBox)
+-- >>> verifyOnly nonce (encrypt nonce "Hello" key) key
+-- True
+verifyOnly :: Nonce SecretBox
+           -- ^ Nonce
+           -> ByteString
+           -- ^ Input
+           -> SecretKey SecretBox
+           -- ^ Shared @'SecretKey'@
+           -> Bool
+           -- ^ Whether the input verified
+verifyOnly (Nonce n) cipher (SecretKey k) = unsafePerformIO $
+  SU.unsafeUseAsCStringLen cipher $ \(pc, clen) ->
+    SU.unsafeUseAsCString n $ \pn ->
+      SU.unsafeUseAsCString k $ \pk -> do
+        r <- c_crypto_secretbox_verify pc (fromIntegral clen) pn pk
+        return (r == 0)
+
+-- | Like @'verifyOnly'@, for a ciphertext read from a @'Handle'@
+-- (in binary mode) until end of file. It is read through a single
+-- fixed size buffer, so memory use does not depend on its size.
+verifyHandle :: Nonce SecretBox
+             -- ^ Nonce
+             -> Handle
+             -- ^ Input
+             -> SecretKey SecretBox
+             -- ^ Shared @'SecretKey'@
+             -> IO Bool
+             -- ^ Whether the input verified
+verifyHandle (Nonce n) h (SecretKey k) =
+  allocaBytes (fromIntegral c_crypto_secretbox_statebytes) $ \pst ->
+    allocaBytes verifyCHUNK $ \buf -> do
+      SU.unsafeUseAsCString n $ \pn ->
+        SU.unsafeUseAsCString k $ \pk ->
+          c_crypto_secretbox_seal_init pst pn pk
+      got <- hGetBuf h buf macBYTES
+      let body = buf `plusPtr` macBYTES
+          loop = do
+            l <- hGetBuf h body (verifyCHUNK - macBYTES)
+            if l == 0 then return () else do
+              c_crypto_secretbox_verify_update pst body (fromIntegral l)
+              loop
+      when (got == macBYTES) loop
+      r <- c_crypto_secretbox_verify_final pst buf
+      return (got == macBYTES && r == 0)
+
+-- | @'reseal' k n k' n' c@ turns @c@, a ciphertext encrypted with
+-- nonce @n@ under key @k@, into the ciphertext of the same message
+-- with nonce @n'@ under key @k'@. Returns @'Nothing'@ if @c@ fails to
+-- verify under @k@.
+--
+-- This is equivalent to decrypting and encrypting again, but the
+-- plaintext is never computed: @c@ is XORed with both keystreams at
+-- once, and the new authenticator is computed as it goes. It is no
+-- slower than @'decrypt'@ alone, and leaves no plaintext behind on
+-- the heap.
+--
+-- >>> [k, k'] <- sequence [randomKey, randomKey]
+-- >>> [n, n'] <- sequence [randomNonce, randomNonce] :: IO [Nonce SecretBox]
+-- >>> reseal k n k' n' (encrypt n "Hello" k) == Just (encrypt n' "Hello" k')
+-- True
+reseal :: SecretKey SecretBox
+       -- ^ Old key
+       -> Nonce SecretBox
+       -- ^ Old nonce
+       -> SecretKey SecretBox
+       -- ^ New key
+       -> Nonce SecretBox
+       -- ^ New nonce
+       -> ByteString
+       -- ^ Ciphertext under the old key and nonce
+       -> Maybe ByteString
+       -- ^ Ciphertext under the new key and nonce
+reseal (SecretKey k) (Nonce n) (SecretKey k') (Nonce n') cipher
+  | clen < boxZEROBYTES = Nothing
+  | otherwise = unsafePerformIO $ do
+      out <- SI.mallocByteString clen
+      r <- withForeignPtr out $ \pout ->
+        SU.unsafeUseAsCString cipher $ \pc ->
+          SU.unsafeUseAsCString n $ \pn ->
+            SU.unsafeUseAsCString k $ \pk ->
+              SU.unsafeUseAsCString n' $ \pn' ->
+                SU.unsafeUseAsCString k' $ \pk' ->
+                  c_crypto_secretbox_reseal pout pc (fromIntegral clen) pn pk pn' pk'
+      return $! if r /= 0 then Nothing
+                else Just $ SI.fromForeignPtr out 0 clen
+  where clen = S.length cipher
+
+-- | @'resealMany' k k' xs@ reseals every ciphertext in @xs@ from @k@
+-- to @k'@, with the old and new nonces given alongside, as
+-- @'reseal'@ would.
+--
+-- The ciphertexts are split into one batch per capability, and every
+-- batch is resealed by a single foreign call, in parallel when the
+-- program uses the threaded runtime.
+resealMany :: SecretKey SecretBox
+           -- ^ Old key
+           -> SecretKey SecretBox
+           -- ^ New key
+           -> [(Nonce SecretBox, Nonce SecretBox, ByteString)]
+           -- ^ Old nonce, new nonce and ciphertext
+           -> [Maybe ByteString]
+           -- ^ New ciphertexts
+resealMany (SecretKey k) (SecretKey k') jobs =
+  unsafePerformIO $ parChunks 64 (resealBatch k k') jobs
+
+resealBatch :: ByteString -> ByteString
+            -> [(Nonce SecretBox, Nonce SecretBox, ByteString)]
+            -> IO [Maybe ByteString]
+resealBatch k k' jobs = do
+  out <- SI.mallocByteString total
+  oks <- withForeignPtr out $ \pout ->
+    allocaArray cnt $ \pok ->
+      SU.unsafeUseAsCString (S.concat cs) $ \pc ->
+        withArray (Prelude.map fromIntegral lens) $ \plens ->
+          SU.unsafeUseAsCString (S.concat [ n | (Nonce n, _, _) <- jobs ]) $ \pn ->
+            SU.unsafeUseAsCString k $ \pk ->
+              SU.unsafeUseAsCString (S.concat [ n | (_, Nonce n, _) <- jobs ]) $ \pn' ->
+                SU.unsafeUseAsCString k' $ \pk' -> do
+                  c_crypto_secretbox_reseal_many pout pok pc plens
+                    (fromIntegral cnt) pn pk pn' pk'
+                  peekArray cnt pok
+  return $ slices (SI.fromForeignPtr out 0 total) lens oks
+  where
+    cs    = [ c | (_, _, c) <- jobs ]
+    lens  = Prelude.map S.length cs
+    total = Prelude.sum lens
+    cnt   = Prelude.length jobs
+
+    slices xs (l:ls) (ok:oks) =
+      let (y, rest) = S.splitAt l xs
+      in (if ok /= 0 then Just y else Nothing) : slices rest ls oks
+    slices _ _ _ = []
+
+-- | @'sealedBuilder' k n b@ writes what @b@ writes, encrypted under
+-- @k@ and @n@, followed by its 16 byte authenticator. The ciphertext
+-- and authenticator are the same as @'encrypt'@'s, but in the
+-- opposite order, so the result must be decrypted with
+-- @'openSealed'@.
+--
+-- Serialization and encryption happen in a single pass: every chunk
+-- is encrypted, and added to the authenticator, in the buffer @b@
+-- wrote it to, so the plaintext is never copied or concatenated.
+--
+-- >>> import Data.ByteString.Builder (toLazyByteString, byteString)
+-- >>> import qualified Data.ByteString.Lazy as L
+-- >>> key <- randomKey
+-- >>> nonce <- randomNonce :: IO (Nonce SecretBox)
+-- >>> let c = L.toStrict (toLazyByteString (sealedBuilder key nonce (byteString "Hello")))
+-- >>> openSealed key nonce c
+-- Just "Hello"
+sealedBuilder :: SecretKey SecretBox
+              -- ^ Shared @'SecretKey'@
+              -> Nonce SecretBox
+              -- ^ Nonce
+              -> Builder
+              -- ^ Input
+              -> Builder
+              -- ^ Ciphertext, then authenticator
+sealedBuilder (SecretKey k) (Nonce n) = filterBuilder macBYTES $ do
+  st <- mallocForeignPtrBytes (fromIntegral c_crypto_secretbox_statebytes)
+  withForeignPtr st $ \pst ->
+    SU.unsafeUseAsCString n $ \pn ->
+      SU.unsafeUseAsCString k $ \pk ->
+        c_crypto_secretbox_seal_init pst pn pk
+  return Filter
+    { filterBytes   = \p l -> withForeignPtr st $ \pst ->
+                        c_crypto_secretbox_seal_update pst p p (fromIntegral l)
+    , filterTrailer = \p -> withForeignPtr st $ \pst ->
+                        c_crypto_secretbox_seal_final pst p
+    }
+
+-- | Verify and decrypt the output of @'sealedBuilder'@. Returns
+-- @'Nothing'@ if it fails to verify.
+openSealed :: SecretKey SecretBox
+           -- ^ Shared @'SecretKey'@
+           -> Nonce SecretBox
+           -- ^ Nonce
+           -> ByteString
+           -- ^ Ciphertext, then authenticator
+           -> Maybe ByteString
+           -- ^ Plaintext
+openSealed (SecretKey k) (Nonce n) xs
+  | S.length xs < macBYTES = Nothing
+  | otherwise = unsafePerformIO $ do
+      m <- SI.mallocByteString clen
+      r <- withForeignPtr m $ \pm ->
+        SU.unsafeUseAsCString xs $ \pc ->
+          SU.unsafeUseAsCString n $ \pn ->
+            SU.unsafeUseAsCString k $ \pk ->
+              c_crypto_secretbox_open_detached pm pc (pc `plusPtr` clen)
+                                               (fromIntegral clen) pn pk
+      return $! if r /= 0 then Nothing
+                else Just $ SI.fromForeignPtr m 0 clen
+  where clen = S.length xs - macBYTES
+
+-- | @'encryptFd' n input output k@ reads @input@ until end of file
+-- and writes it to @output@ as a stream of sealed records. Returns
+-- the number of bytes written, and throws an @'IOError'@ if reading
+-- or writing fails.
+--
+-- Every record is sealed with its own nonce: the last 8 bytes of @n@
+-- are treated as a big endian counter, which is bumped after every
+-- record, so none of the nonces @n@, @n+1@, ... may be used with
+-- @k@ for anything else. Records hold 256KiB of plaintext each,
+-- except for the last, which holds less, so a stream cut short
+-- between two records fails to decrypt.
+--
+-- The data never enters the Haskell heap: it is read into a few
+-- large buffers on the C side, and reading, encryption and writing
+-- run in parallel on separate OS threads.
+encryptFd :: Nonce SecretBox
+          -- ^ Nonce
+          -> Fd
+          -- ^ Input
+          -> Fd
+          -- ^ Output
+          -> SecretKey SecretBox
+          -- ^ Shared @'SecretKey'@
+          -> IO Integer
+          -- ^ Bytes written
+encryptFd (Nonce n) (Fd i) (Fd o) (SecretKey k) =
+  SU.unsafeUseAsCString n $ \pn ->
+    SU.unsafeUseAsCString k $ \pk ->
+      fmap toInteger . throwErrnoIfMinus1 "encryptFd" $
+        c_pipe_secretbox_seal i o pn pk
+
+-- | @'decryptFd' n input output k@ decrypts a stream written by
+-- @'encryptFd'@ from @input@ to @output@, and returns the number of
+-- bytes written. Returns @'Nothing'@ as soon as a record fails to
+-- verify, or if the stream is truncated or has trailing data, and
+-- throws an @'IOError'@ if reading or writing fails.
+--
+-- Only verified records are ever written to @output@, but on failure
+-- some of them may already have been, so the output should be
+-- discarded unless @'decryptFd'@ succeeds (e.g. by writing to a
+-- temporary file and renaming it.)
+decryptFd :: Nonce SecretBox
+          -- ^ Nonce
+          -> Fd
+          -- ^ Input
+          -> Fd
+          -- ^ Output
+          -> SecretKey SecretBox
+          -- ^ Shared @'SecretKey'@
+          -> IO (Maybe Integer)
+          -- ^ Bytes written
+decryptFd (Nonce n) (Fd i) (Fd o) (SecretKey k) =
+  SU.unsafeUseAsCString n $ \pn ->
+    SU.unsafeUseAsCString k $ \pk -> do
+      r <- c_pipe_secretbox_open i o pn pk
+      if r /= -1 then return $ Just (toInteger r) else do
+        errno <- getErrno
+        if errno == eBADMSG then return Nothing
+                            else throwErrno "decryptFd"
+
 -- $example
 -- >>> key <- randomKey
 -- >>> nonce <- randomNonce :: IO (Nonce SecretBox)
@@ -157,6 +479,12 @@ zeroBYTES = 32
 boxZEROBYTES :: Int
 boxZEROBYTES = 16
 
+macBYTES :: Int
+macBYTES = 16
+
+verifyCHUNK :: Int
+verifyCHUNK = 65536
+
 foreign import ccall unsafe "xsalsa20poly1305_secretbox"
   c_crypto_secretbox :: Ptr Word8 -> Ptr CChar -> CULLong ->
                         Ptr CChar -> Ptr CChar -> IO Int
@@ -164,3 +492,52 @@ foreign import ccall unsafe "xsalsa20poly1305_secretbox"
 foreign import ccall unsafe "xsalsa20poly1305_secretbox_open"
   c_crypto_secretbox_open :: Ptr Word8 -> Ptr CChar -> CULLong ->
                              Ptr CChar -> Ptr CChar -> IO Int
+
+foreign import ccall unsafe "xsalsa20poly1305_reseal"
+  c_crypto_secretbox_reseal :: Ptr Word8 -> Ptr CChar -> CULLong ->
+                               Ptr CChar -> Ptr CChar ->
+                               Ptr CChar -> Ptr CChar -> IO Int
+
+foreign import ccall unsafe "xsalsa20poly1305_reseal_many"
+  c_crypto_secretbox_reseal_many :: Ptr Word8 -> Ptr Word8 -> Ptr CChar ->
+                                    Ptr CULLong -> CULLong ->
+                                    Ptr CChar -> Ptr CChar ->
+                                    Ptr CChar -> Ptr CChar -> IO ()
+
+foreign import ccall unsafe "xsalsa20poly1305_open_detached"
+  c_crypto_secretbox_open_detached :: Ptr Word8 -> Ptr CChar -> Ptr CChar ->
+                                      CULLong -> Ptr CChar -> Ptr CChar -> IO Int
+
+foreign import ccall unsafe "xsalsa20poly1305_open_into"
+  c_crypto_secretbox_open_into :: Ptr Word8 -> Ptr CChar -> CULLong ->
+                                  Ptr CChar -> Ptr CChar -> IO Int
+
+foreign import ccall unsafe "xsalsa20poly1305_verify"
+  c_crypto_secretbox_verify :: Ptr CChar -> CULLong ->
+                               Ptr CChar -> Ptr CChar -> IO Int
+
+foreign import ccall unsafe "xsalsa20poly1305_verify_update"
+  c_crypto_secretbox_verify_update :: Ptr Word8 -> Ptr Word8 -> CULLong -> IO ()
+
+foreign import ccall unsafe "xsalsa20poly1305_verify_final"
+  c_crypto_secretbox_verify_final :: Ptr Word8 -> Ptr Word8 -> IO Int
+
+foreign import ccall unsafe "xsalsa20poly1305_seal_statebytes"
+  c_crypto_secretbox_statebytes :: CULong
+
+foreign import ccall unsafe "xsalsa20poly1305_seal_init"
+  c_crypto_secretbox_seal_init :: Ptr Word8 -> Ptr CChar -> Ptr CChar -> IO ()
+
+foreign import ccall unsafe "xsalsa20poly1305_seal_update"
+  c_crypto_secretbox_seal_update :: Ptr Word8 -> Ptr Word8 -> Ptr Word8 ->
+                                    CULLong -> IO ()
+
+foreign import ccall unsafe "xsalsa20poly1305_seal_final"
+  c_crypto_secretbox_seal_final :: Ptr Word8 -> Ptr Word8 -> IO ()
+
+-- These block on I/O, so they must not be unsafe.
+foreign import ccall safe "nacl_pipe_secretbox_seal"
+  c_pipe_secretbox_seal :: CInt -> CInt -> Ptr CChar -> Ptr CChar -> IO CLLong
+
+foreign import ccall safe "nacl_pipe_secretbox_open"
+  c_pipe_secretbox_open :: CInt -> CInt -> Ptr CChar -> Ptr CChar -> IO CLLong
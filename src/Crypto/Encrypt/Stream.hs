@@ -35,10 +35,16 @@ module Crypto.Encrypt.Stream
        , stream    -- :: Nonce Stream -> Int -> SecretKey Stream -> ByteString
        , encrypt   -- :: Nonce Stream -> ByteString -> SecretKey Stream -> ByteString
        , decrypt   -- :: Nonce Stream -> ByteString -> SecretKey Stream -> ByteString
+
+         -- * Encrypting file descriptors
+       , encryptFd -- :: Nonce Stream -> Fd -> Fd -> SecretKey Stream -> IO Integer
+       , decryptFd -- :: Nonce Stream -> Fd -> Fd -> SecretKey Stream -> IO Integer
        ) where
 import           Data.Word
+import           Foreign.C.Error          (throwErrnoIfMinus1)
 import           Foreign.C.Types
 import           Foreign.Ptr
+import           System.Posix.Types       (Fd(..))
 
 import           System.IO.Unsafe         (unsafePerformIO)
 
@@ -154,6 +160,44 @@ decrypt :: Nonce Stream
 decrypt = encrypt
 {-# INLINE decrypt #-}
 
+-- | @'encryptFd' n input output k@ reads @input@ until end of file
+-- and writes it to @output@ encrypted, exactly as @'encrypt'@ would
+-- encrypt the whole input at once. Returns the number of bytes
+-- written, and throws an @'IOError'@ if reading or writing fails.
+--
+-- The data never enters the Haskell heap: it is read into a few
+-- large buffers on the C side, and reading, encryption and writing
+-- run in parallel on separate OS threads. Use this rather than
+-- @'encrypt'@ for large files and sockets.
+encryptFd :: Nonce Stream
+          -- ^ Nonce
+          -> Fd
+          -- ^ Input
+          -> Fd
+          -- ^ Output
+          -> SecretKey Stream
+          -- ^ Key
+          -> IO Integer
+          -- ^ Bytes written
+encryptFd (Nonce n) (Fd i) (Fd o) (SecretKey sk) =
+  SU.unsafeUseAsCString n $ \pn ->
+    SU.unsafeUseAsCString sk $ \psk ->
+      fmap toInteger . throwErrnoIfMinus1 "encryptFd" $
+        c_pipe_stream_xor i o pn psk
+
+-- | Simple alias for @'encryptFd'@.
+decryptFd :: Nonce Stream
+          -- ^ Nonce
+          -> Fd
+          -- ^ Input
+          -> Fd
+          -- ^ Output
+          -> SecretKey Stream
+          -- ^ Key
+          -> IO Integer
+          -- ^ Bytes written
+decryptFd = encryptFd
+
 -- $example
 -- >>> nonce <- randomNonce :: IO (Nonce Stream)
 -- >>> key <- randomKey
@@ -175,3 +219,7 @@ foreign import ccall unsafe "xsalsa20_stream"
 foreign import ccall unsafe "xsalsa20_stream_xor"
   c_xsalsa20_crypto_stream_xor :: Ptr Word8 -> Ptr CChar ->
                                   CULLong -> Ptr CChar -> Ptr CChar -> IO Int
+
+-- This one blocks on I/O, so it must not be unsafe.
+foreign import ccall safe "nacl_pipe_stream_xor"
+  c_pipe_stream_xor :: CInt -> CInt -> Ptr CChar -> Ptr CChar -> IO CLLong
@@ -35,17 +35,24 @@ module Crypto.HMAC.SHA512
          -- $example
        , authenticate -- :: SecretKey HMACSHA512 -> ByteString -> Auth
        , verify       -- :: SecretKey HMACSHA512 -> Auth -> ByteString -> Bool
+
+         -- * Authenticating builders
+       , hmacBuilder  -- :: SecretKey HMACSHA512 -> Builder -> Builder
        ) where
 import           Data.Word
 import           Foreign.C.Types
+import           Foreign.ForeignPtr       (mallocForeignPtrBytes,
+                                           withForeignPtr)
 import           Foreign.Ptr
 
 import           System.IO.Unsafe         (unsafePerformIO)
 
 import           Data.ByteString          (ByteString)
+import           Data.ByteString.Builder  (Builder)
 import           Data.ByteString.Internal (create)
 import           Data.ByteString.Unsafe
 
+import           Crypto.Internal.Builder
 import           Crypto.Key
 import           System.Crypto.Random
 
@@ -119,6 +126,38 @@ verify (SecretKey k) (Auth auth) msg =
         return (b == 0)
 {-# INLINE verify #-}
 
+-- | @'hmacBuilder' k b@ writes what @b@ writes, followed by its
+-- authenticator under @k@: the same bytes as @m@ followed by
+-- @'authenticate' k m@, where @m@ is @b@'s output.
+--
+-- The authenticator is computed as @b@ fills each buffer, so the
+-- message is never concatenated or copied to be authenticated.
+--
+-- >>> import Data.ByteString.Builder (toLazyByteString, byteString)
+-- >>> import qualified Data.ByteString as S
+-- >>> import qualified Data.ByteString.Lazy as L
+-- >>> key <- randomKey
+-- >>> let xs = L.toStrict (toLazyByteString (hmacBuilder key (byteString "Hello")))
+-- >>> Auth (S.drop 5 xs) == authenticate key "Hello"
+-- True
+hmacBuilder :: SecretKey HMACSHA512
+            -- ^ Secret key
+            -> Builder
+            -- ^ Message
+            -> Builder
+            -- ^ Message, then authenticator
+hmacBuilder (SecretKey k) = filterBuilder hmacsha512256BYTES $ do
+  st <- mallocForeignPtrBytes (fromIntegral c_crypto_hmacsha512256_statebytes)
+  withForeignPtr st $ \pst ->
+    unsafeUseAsCString k $ \pk ->
+      c_crypto_hmacsha512256_init pst pk
+  return Filter
+    { filterBytes   = \p l -> withForeignPtr st $ \pst ->
+                        c_crypto_hmacsha512256_update pst p (fromIntegral l)
+    , filterTrailer = \p -> withForeignPtr st $ \pst ->
+                        c_crypto_hmacsha512256_final pst p
+    }
+
 -- $example
 -- >>> key <- randomKey
 -- >>> let a = authenticate key "Hello"
@@ -142,3 +181,15 @@ foreign import ccall unsafe "sha512256_hmac"
 foreign import ccall unsafe "sha512256_hmac_verify"
   c_crypto_hmacsha512256_verify :: Ptr CChar -> Ptr CChar -> CULLong ->
                                  Ptr CChar -> IO Int
+
+foreign import ccall unsafe "sha512256_hmac_statebytes"
+  c_crypto_hmacsha512256_statebytes :: CULong
+
+foreign import ccall unsafe "sha512256_hmac_init"
+  c_crypto_hmacsha512256_init :: Ptr Word8 -> Ptr CChar -> IO ()
+
+foreign import ccall unsafe "sha512256_hmac_update"
+  c_crypto_hmacsha512256_update :: Ptr Word8 -> Ptr Word8 -> CULLong -> IO ()
+
+foreign import ccall unsafe "sha512256_hmac_final"
+  c_crypto_hmacsha512256_final :: Ptr Word8 -> Ptr Word8 -> IO ()
@@ -0,0 +1,208 @@
+{-# LANGUAGE EmptyDataDecls           #-}
+{-# LANGUAGE ForeignFunctionInterface #-}
+-- |
+-- Module      : Crypto.Hash.Placement
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- Placing keys onto shards, with keyed hashes.
+--
+-- Two schemes are provided, both built on SipHash-2-4 under a secret
+-- placement key, so that nobody without the key can pick keys which
+-- all land on the same shard:
+--
+--   * /Jump consistent hashing/ (Lamping and Veach, 2014) places keys
+--     into @n@ numbered buckets. When @n@ grows by one, only the keys
+--     which move to the new bucket change place. Buckets can only be
+--     added or removed at the end.
+--
+--   * /Rendezvous/ (highest random weight) hashing places keys onto
+--     an arbitrary set of named @'Nodes'@: every node gets a weight for
+--     every key, and the heaviest one wins. Removing a node only moves
+--     the keys that were on it.
+--
+-- The @Many@ variants place a whole list of keys with a single
+-- foreign call, and allocate nothing per key or node. When built
+-- with AVX2 they hash four keys (or four nodes) at a time with vector
+-- instructions.
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with other cryptographic primitives, e.g.
+--
+-- > import qualified Crypto.Hash.Placement as Placement
+--
+module Crypto.Hash.Placement
+       ( -- * Types
+         Placement      -- :: *
+       , Nodes          -- :: *
+
+         -- * Key creation
+       , randomKey      -- :: IO (SecretKey Placement)
+
+         -- * Jump consistent hashing
+       , jump           -- :: SecretKey Placement -> Int -> ByteString -> Int
+       , jumpMany       -- :: SecretKey Placement -> Int -> [ByteString] -> [Int]
+
+         -- * Rendezvous hashing
+       , nodes          -- :: SecretKey Placement -> [ByteString] -> Maybe Nodes
+       , nodeCount      -- :: Nodes -> Int
+       , rendezvous     -- :: Nodes -> ByteString -> Int
+       , rendezvousMany -- :: Nodes -> [ByteString] -> [Int]
+       ) where
+import           Data.Word
+import           Foreign.C.Types
+import           Foreign.Marshal.Array     (allocaArray, peekArray, withArray)
+import           Foreign.Ptr
+
+import           System.IO.Unsafe          (unsafePerformIO)
+
+import           Data.ByteString           (ByteString)
+import qualified Data.ByteString           as S
+import qualified Data.ByteString.Unsafe    as SU
+
+import           Crypto.Key
+import           Crypto.NaCl.Array         (DigestArray)
+import qualified Crypto.NaCl.Array         as A
+import           System.Crypto.Random
+
+-- $setup
+-- >>> :set -XOverloadedStrings
+
+-- | A phantom type for representing types related to shard
+-- placement.
+data Placement
+
+-- | A set of nodes for rendezvous hashing, prepared under a placement
+-- key. Nodes are numbered from zero, in the order they were given.
+data Nodes = Nodes !ByteString  -- Placement key
+                   !DigestArray -- Hash of every node's name
+
+-- | Generate a random placement key. Everything placed with the same
+-- key must use the same placement key.
+randomKey :: IO (SecretKey Placement)
+randomKey = SecretKey `fmap` randombytes placementKEYBYTES
+
+--------------------------------------------------------------------------------
+-- Jump consistent hashing
+
+-- | @'jump' k n key@ places @key@ into one of @n@ buckets, numbered
+-- @0@ to @n-1@. If @n@ is not positive, it is treated as @1@.
+--
+-- >>> key <- randomKey
+-- >>> let b = jump key 10 "user:1234"
+-- >>> b >= 0 && b < 10
+-- True
+-- >>> jump key 11 "user:1234" `elem` [b, 10]
+-- True
+jump :: SecretKey Placement
+     -- ^ Placement key
+     -> Int
+     -- ^ Number of buckets
+     -> ByteString
+     -- ^ Key
+     -> Int
+     -- ^ Bucket
+jump k n key = head (jumpMany k n [key])
+
+-- | Place many keys at once with @'jump'@.
+jumpMany :: SecretKey Placement
+         -- ^ Placement key
+         -> Int
+         -- ^ Number of buckets
+         -> [ByteString]
+         -- ^ Keys
+         -> [Int]
+         -- ^ Buckets
+jumpMany (SecretKey k) n keys =
+  placeMany keys $ \pout pm plens cnt ->
+    SU.unsafeUseAsCString k $ \pk ->
+      c_jump_many pout pm plens cnt (fromIntegral (max 1 n)) pk
+
+--------------------------------------------------------------------------------
+-- Rendezvous hashing
+
+-- | Prepare a set of nodes, given their names. Returns @'Nothing'@ if
+-- there are none.
+nodes :: SecretKey Placement
+      -- ^ Placement key
+      -> [ByteString]
+      -- ^ Node names
+      -> Maybe Nodes
+nodes _ [] = Nothing
+nodes (SecretKey k) names = Just $ Nodes k seeds
+  where
+    seeds = unsafePerformIO . A.create 8 (length names) $ \out ->
+      SU.unsafeUseAsCString (S.concat names) $ \pm ->
+        withArray (map (fromIntegral . S.length) names) $ \plens ->
+          SU.unsafeUseAsCString k $ \pk ->
+            c_node_seeds out pm plens (fromIntegral (length names)) pk
+
+-- | The number of nodes in a set.
+nodeCount :: Nodes -> Int
+nodeCount (Nodes _ seeds) = A.length seeds
+
+-- | @'rendezvous' ns key@ places @key@ onto one of the nodes @ns@,
+-- returning its number.
+--
+-- >>> key <- randomKey
+-- >>> let Just ns  = nodes key ["a", "b", "c"]
+-- >>> let Just ns' = nodes key ["a", "b"]
+-- >>> let n = rendezvous ns "user:1234"
+-- >>> n == 2 || rendezvous ns' "user:1234" == n
+-- True
+rendezvous :: Nodes
+           -- ^ Nodes
+           -> ByteString
+           -- ^ Key
+           -> Int
+           -- ^ Node
+rendezvous ns key = head (rendezvousMany ns [key])
+
+-- | Place many keys at once with @'rendezvous'@.
+rendezvousMany :: Nodes
+               -- ^ Nodes
+               -> [ByteString]
+               -- ^ Keys
+               -> [Int]
+               -- ^ Nodes
+rendezvousMany ns@(Nodes k seeds) keys =
+  placeMany keys $ \pout pm plens cnt ->
+    A.withArrayPtr seeds $ \ps _ ->
+      SU.unsafeUseAsCString k $ \pk ->
+        c_rendezvous_many pout pm plens cnt ps (fromIntegral (nodeCount ns)) pk
+
+--------------------------------------------------------------------------------
+-- Utilities
+
+-- Pass a batch of keys to C as one buffer and an array of lengths,
+-- and read back one placement per key.
+placeMany :: [ByteString]
+          -> (Ptr CUInt -> Ptr CChar -> Ptr CULLong -> CULLong -> IO ())
+          -> [Int]
+placeMany [] _ = []
+placeMany keys f = unsafePerformIO $
+  allocaArray n $ \pout ->
+    SU.unsafeUseAsCString (S.concat keys) $ \pm ->
+      withArray (map (fromIntegral . S.length) keys) $ \plens -> do
+        f pout pm plens (fromIntegral n)
+        map fromIntegral `fmap` peekArray n pout
+  where n = length keys
+
+placementKEYBYTES :: Int
+placementKEYBYTES = 16
+
+foreign import ccall unsafe "siphash24_jump_many"
+  c_jump_many :: Ptr CUInt -> Ptr CChar -> Ptr CULLong -> CULLong ->
+                 CUInt -> Ptr CChar -> IO ()
+
+foreign import ccall unsafe "siphash24_node_seeds"
+  c_node_seeds :: Ptr Word8 -> Ptr CChar -> Ptr CULLong -> CULLong ->
+                  Ptr CChar -> IO ()
+
+foreign import ccall unsafe "siphash24_rendezvous_many"
+  c_rendezvous_many :: Ptr CUInt -> Ptr CChar -> Ptr CULLong -> CULLong ->
+                       Ptr Word8 -> CUInt -> Ptr CChar -> IO ()
@@ -0,0 +1,65 @@
+{-# LANGUAGE RankNTypes #-}
+-- |
+-- Module      : Crypto.Internal.Builder
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : GHC
+--
+-- Running a cipher or MAC over a @'Builder'@'s output, in the
+-- builder's own buffers.
+module Crypto.Internal.Builder
+       ( Filter(..)    -- :: *
+       , filterBuilder -- :: Int -> IO Filter -> Builder -> Builder
+       ) where
+import           Data.Word
+import           Foreign.Ptr
+
+import           Data.ByteString.Builder          (Builder)
+import           Data.ByteString.Builder.Internal
+
+-- | What to do with the bytes a builder writes.
+data Filter = Filter
+  { filterBytes   :: Ptr Word8 -> Int -> IO ()
+    -- ^ Called on every run of freshly written bytes, in order,
+    -- before they are handed on. It may rewrite them in place.
+  , filterTrailer :: Ptr Word8 -> IO ()
+    -- ^ Called once at the end, to write the trailer.
+  }
+
+-- | @'filterBuilder' n new b@ writes what @b@ writes, passed through
+-- a @'Filter'@, followed by an @n@ byte trailer. @new@ is run every
+-- time the result is executed, so the builder can be run more than
+-- once.
+--
+-- Chunks which @b@ inserts directly (e.g. with
+-- @'Data.ByteString.Builder.byteStringInsert'@) are copied into the
+-- buffer, as they have to be filtered too.
+filterBuilder :: Int -> IO Filter -> Builder -> Builder
+filterBuilder n new b = builder $ \k range0 -> do
+    f <- new
+    let go step range@(BufferRange op ope) =
+          fillWithBuildStep step finished full insert range
+          where
+            finished op' _ = do
+              filtered op'
+              trailer (BufferRange op' ope)
+            full op' minSize next = do
+              filtered op'
+              return $ bufferFull minSize op' (go next)
+            insert op' bs next = do
+              filtered op'
+              go (runBuilderWith (byteStringCopy bs) next) (BufferRange op' ope)
+            filtered op'
+              | op' == op = return ()
+              | otherwise = filterBytes f op (op' `minusPtr` op)
+
+        trailer (BufferRange op ope)
+          | ope `minusPtr` op < n = return $ bufferFull n op trailer
+          | otherwise = do
+              filterTrailer f op
+              k (BufferRange (op `plusPtr` n) ope)
+
+    go (runBuilder b) range0
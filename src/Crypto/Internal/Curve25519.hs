@@ -0,0 +1,28 @@
+-- |
+-- Module      : Crypto.Internal.Curve25519
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- The representation of prepared Curve25519 peer keys, shared by
+-- "Crypto.DH.Curve25519" and "Crypto.Encrypt.Box". The table is read
+-- by C code which trusts its length, so the constructor must not
+-- escape the package.
+module Crypto.Internal.Curve25519
+       ( PreparedPeerKey(..)   -- :: * -> *
+       , cryptoDhPREPAREDBYTES -- :: Int
+       ) where
+import           Data.ByteString (ByteString)
+
+import           Crypto.Key
+
+-- | A peer public key, together with its precomputed table of
+-- multiples, if it has one.
+data PreparedPeerKey t = PreparedPeerKey !(PublicKey t) !(Maybe ByteString)
+
+-- | The size of a table of multiples.
+cryptoDhPREPAREDBYTES :: Int
+cryptoDhPREPAREDBYTES = 30720
@@ -0,0 +1,45 @@
+-- |
+-- Module      : Crypto.Internal.Parallel
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : GHC
+--
+-- Splitting batch operations across capabilities.
+module Crypto.Internal.Parallel
+       ( parChunks -- :: Int -> ([a] -> IO [b]) -> [a] -> IO [b]
+       ) where
+import           Control.Concurrent      (forkOn, getNumCapabilities)
+import           Control.Concurrent.MVar
+import           Control.Exception       (SomeException, evaluate, throwIO, try)
+
+-- | @'parChunks' m f xs@ splits @xs@ into one chunk per capability,
+-- but no smaller than @m@ elements, runs @f@ on every chunk on its
+-- own capability and concatenates the results, in order. Exceptions
+-- are rethrown in the calling thread.
+--
+-- When @f@ is a single @safe@ foreign call, the chunks run on
+-- separate OS threads in parallel with the threaded runtime.
+parChunks :: Int -> ([a] -> IO [b]) -> [a] -> IO [b]
+parChunks _ _ [] = return []
+parChunks m f xs = do
+  caps <- getNumCapabilities
+  let size = max m ((length xs + caps - 1) `quot` caps)
+  case chunksOf size xs of
+    [c] -> f c
+    cs  -> do
+      vars <- sequence
+        [ do v <- newEmptyMVar
+             _ <- forkOn i (try (f c >>= evaluate) >>= putMVar v)
+             return v
+        | (i, c) <- zip [0..] cs ]
+      fmap concat . mapM (\v -> takeMVar v >>= either rethrow return) $ vars
+  where
+    rethrow :: SomeException -> IO a
+    rethrow = throwIO
+
+chunksOf :: Int -> [a] -> [[a]]
+chunksOf _ [] = []
+chunksOf m xs = let (a, b) = splitAt m xs in a : chunksOf m b
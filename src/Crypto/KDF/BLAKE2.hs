@@ -0,0 +1,162 @@
+{-# LANGUAGE ForeignFunctionInterface #-}
+-- |
+-- Module      : Crypto.KDF.BLAKE2
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- Subkey derivation with keyed BLAKE2b.
+--
+-- Given a single high-entropy @'MasterKey'@, @'deriveKey'@ produces
+-- any number of independent subkeys, each identified by a 64-bit
+-- subkey id and an 8-byte @'Context'@ describing what it is for
+-- (e.g. @\"sessions\"@ or @\"snapshot\"@). Knowing some subkeys
+-- reveals nothing about the master key or about any other subkey.
+--
+-- The id and context go into the salt and personalization fields of
+-- the BLAKE2b parameter block rather than being hashed as a message,
+-- so each subkey costs exactly one BLAKE2b compression. The
+-- construction is the same as libsodium's @crypto_kdf@, and produces
+-- identical keys.
+--
+-- This is /not/ a password hash: the master key must already be
+-- uniformly random. To turn a password into a key, see
+-- "Crypto.KDF.Scrypt".
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with other cryptographic primitives, e.g.
+--
+-- > import qualified Crypto.KDF.BLAKE2 as KDF
+--
+module Crypto.KDF.BLAKE2
+       ( -- * Types
+         MasterKey         -- :: *
+       , masterKey         -- :: ByteString -> Maybe MasterKey
+       , randomMasterKey   -- :: IO MasterKey
+       , Context           -- :: *
+       , context           -- :: ByteString -> Maybe Context
+
+         -- * Deriving subkeys
+       , deriveKey         -- :: MasterKey -> Word64 -> Context -> SecretKey t
+       , deriveKeys        -- :: MasterKey -> [Word64] -> Context -> [SecretKey t]
+       , deriveKeyArray    -- :: MasterKey -> [Word64] -> Context -> KeyArray t
+       ) where
+import           Data.Word
+import           Foreign.C.Types
+import           Foreign.Marshal.Array    (withArrayLen)
+import           Foreign.Ptr
+
+import           System.IO.Unsafe         (unsafePerformIO)
+
+import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as S
+import qualified Data.ByteString.Unsafe   as SU
+
+import           Crypto.Key
+import           Crypto.NaCl.Array        (KeyArray)
+import qualified Crypto.NaCl.Array        as A
+import           System.Crypto.Random     (randombytes)
+
+-- $setup
+-- >>> :set -XOverloadedStrings
+-- >>> import Data.Maybe
+-- >>> import qualified Data.ByteString as S
+
+-- | A master key for subkey derivation.
+newtype MasterKey = MasterKey ByteString deriving (Eq)
+
+instance Show MasterKey where
+  showsPrec _ (MasterKey xs) = showsHex xs
+
+-- | Use an existing key as a @'MasterKey'@. It must be between 16
+-- and 64 uniformly random bytes (32 is recommended); returns
+-- @'Nothing'@ otherwise.
+--
+-- >>> isJust (masterKey (S.replicate 32 0))
+-- True
+-- >>> isJust (masterKey "short")
+-- False
+masterKey :: ByteString -> Maybe MasterKey
+masterKey xs
+  | l < kdfKEYBYTESMIN || l > kdfKEYBYTESMAX = Nothing
+  | otherwise = Just (MasterKey xs)
+  where l = S.length xs
+
+-- | An 8-byte label describing what a family of subkeys is used
+-- for. Different contexts give unrelated subkeys even for the same
+-- subkey id.
+newtype Context = Context ByteString deriving (Eq, Show)
+
+-- | Create a @'Context'@ from a label of at most 8 bytes. Shorter
+-- labels are padded with zeros. Returns @'Nothing'@ for longer
+-- labels.
+--
+-- >>> isJust (context "sessions")
+-- True
+-- >>> isJust (context "too long!")
+-- False
+context :: ByteString -> Maybe Context
+context xs
+  | S.length xs > kdfCONTEXTBYTES = Nothing
+  | otherwise = Just . Context $
+      xs `S.append` S.replicate (kdfCONTEXTBYTES - S.length xs) 0
+{-# INLINE context #-}
+
+-- | Generate a random 32-byte @'MasterKey'@.
+randomMasterKey :: IO MasterKey
+randomMasterKey = MasterKey `fmap` randombytes kdfKEYBYTES
+
+-- | Derive the 32-byte subkey with the given id and context.
+--
+-- >>> let Just master = masterKey (S.pack [0..31])
+-- >>> let Just ctx = context "Examples"
+-- >>> deriveKey master 0 ctx
+-- d676d6d54480f13ed75c930629f21919bf7126656e4b7f9ef045ee34ac288161
+deriveKey :: MasterKey -> Word64 -> Context -> SecretKey t
+deriveKey master i ctx = head (deriveKeys master [i] ctx)
+{-# INLINE deriveKey #-}
+
+-- | Derive many 32-byte subkeys at once. This makes a single foreign
+-- call, and all of the keys share a single buffer.
+--
+-- prop> \ids -> let { Just m = masterKey (S.pack [0..31]); Just c = context "prop" } in deriveKeys m ids c == map (\i -> deriveKey m i c) ids
+deriveKeys :: MasterKey -> [Word64] -> Context -> [SecretKey t]
+deriveKeys master ids ctx = A.toList (deriveKeyArray master ids ctx)
+
+-- | Like @'deriveKeys'@, but returns the subkeys as a packed array.
+deriveKeyArray :: MasterKey -> [Word64] -> Context -> KeyArray t
+deriveKeyArray (MasterKey key) ids (Context ctx)
+  | null ids  = A.empty kdfBYTES
+  | otherwise = unsafePerformIO $
+      A.create kdfBYTES (length ids) $ \pout ->
+        SU.unsafeUseAsCStringLen key $ \(pkey, klen) ->
+          SU.unsafeUseAsCString ctx $ \pctx ->
+            withArrayLen ids $ \len pids ->
+              c_blake2b_kdf pout (fromIntegral kdfBYTES) pkey
+                (fromIntegral klen) pctx pids (fromIntegral len) >> return ()
+
+--
+-- FFI KDF binding
+--
+
+kdfBYTES :: Int
+kdfBYTES = 32
+
+kdfKEYBYTES :: Int
+kdfKEYBYTES = 32
+
+kdfKEYBYTESMIN :: Int
+kdfKEYBYTESMIN = 16
+
+kdfKEYBYTESMAX :: Int
+kdfKEYBYTESMAX = 64
+
+kdfCONTEXTBYTES :: Int
+kdfCONTEXTBYTES = 8
+
+foreign import ccall unsafe "blake2b_kdf"
+  c_blake2b_kdf :: Ptr Word8 -> Word8 -> Ptr CChar -> Word8
+                -> Ptr CChar -> Ptr Word64 -> CSize -> IO CInt
@@ -0,0 +1,187 @@
+{-# LANGUAGE ForeignFunctionInterface #-}
+-- |
+-- Module      : Crypto.KDF.ScryptJane
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- Key stretching with @scrypt-jane@, a variant of scrypt with a
+-- choice of block mix and PBKDF2 hash function.
+--
+-- The output is /not/ compatible with standard (Tarsnap) scrypt, as
+-- provided by "Crypto.KDF.Scrypt"; use this module only where you
+-- control both ends, such as deriving keys for your own storage. In
+-- exchange, the 128-byte @'Salsa64_8'@ mix does more memory-hard work
+-- per millisecond than Salsa20/8. The fastest implementation of the
+-- chosen mix (AVX2, AVX, SSSE3, SSE2 or portable C) is picked at
+-- runtime.
+--
+-- For further information see
+-- <https://github.com/floodyberry/scrypt-jane>.
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with other cryptographic primitives, e.g.
+--
+-- > import qualified Crypto.KDF.ScryptJane as Jane
+--
+module Crypto.KDF.ScryptJane
+       ( -- * Types
+         Salt(..)         -- :: *
+       , newSalt          -- :: IO Salt
+       , Mix(..)          -- :: *
+       , Hash(..)         -- :: *
+
+         -- * Parameters
+         -- $params
+       , JaneParams       -- :: *
+       , janeMix          -- :: JaneParams -> Mix
+       , janeHash         -- :: JaneParams -> Hash
+       , nFactor          -- :: JaneParams -> Word8
+       , rFactor          -- :: JaneParams -> Word8
+       , pFactor          -- :: JaneParams -> Word8
+       , janeParams       -- :: Mix -> Hash -> Int -> Int -> Int -> Maybe JaneParams
+       , defaultJaneParams -- :: JaneParams
+       , janeMemory       -- :: JaneParams -> Integer
+
+         -- * Stretching
+       , stretch          -- :: JaneParams -> Int -> Salt -> ByteString -> ByteString
+       , stretch'         -- :: Int -> Salt -> ByteString -> ByteString
+       ) where
+import           Control.Monad            (when)
+import           Data.Bits                (shiftL)
+import           Data.Maybe               (fromJust)
+import           Data.Word
+import           Foreign.C.Types
+import           Foreign.Ptr
+
+import           System.IO.Unsafe         (unsafePerformIO)
+
+import           Data.ByteString          (ByteString)
+import qualified Data.ByteString.Internal as SI
+import qualified Data.ByteString.Unsafe   as SU
+
+import           Crypto.KDF.Scrypt        (Salt (..), newSalt)
+
+-- $setup
+-- >>> :set -XOverloadedStrings
+-- >>> import qualified Data.ByteString as S
+
+-- | The function used to mix blocks in ROMix.
+data Mix
+  = ChaCha20_8 -- ^ ChaCha20/8 over 64-byte blocks
+  | Salsa64_8  -- ^ Salsa6420/8, a 64-bit Salsa20/8 over 128-byte blocks
+  deriving (Eq, Ord, Show, Enum, Bounded)
+
+-- | The hash function used in the two PBKDF2 stages.
+data Hash = SHA512 | BLAKE512 | Skein512 | Keccak512
+  deriving (Eq, Ord, Show, Enum, Bounded)
+
+-- $params
+--
+-- scrypt-jane takes its tuning parameters as base-2 logarithms:
+--
+--  * @Nfactor@: @N = 2^(Nfactor+1)@ chunks are mixed and stored,
+--    which scales both time and memory.
+--
+--  * @rfactor@: a chunk is @2 * 2^rfactor@ blocks, which scales
+--    memory per chunk.
+--
+--  * @pfactor@: ROMix is run @2^pfactor@ times, which scales time
+--    only.
+--
+-- Memory usage is about @2^(Nfactor+1) * 2 * 2^rfactor@ blocks, see
+-- @'janeMemory'@.
+
+-- | Parameters for @'stretch'@.
+data JaneParams = JaneParams
+  { janeMix  :: !Mix  -- ^ The block mix
+  , janeHash :: !Hash -- ^ The PBKDF2 hash
+  , nFactor  :: !Word8 -- ^ @Nfactor@
+  , rFactor  :: !Word8 -- ^ @rfactor@
+  , pFactor  :: !Word8 -- ^ @pfactor@
+  } deriving (Eq, Show)
+
+-- | Construct a @'JaneParams'@ from a mix, hash, and the @Nfactor@,
+-- @rfactor@ and @pfactor@ parameters. Returns @'Nothing'@ if any
+-- parameter is out of range: @Nfactor@ must be at most 30,
+-- @pfactor@ at most 25, chunks (@'janeMemory'@ divided by @N@) at
+-- most 32KB, and @2^pfactor + 1@ chunks must fit in 4GB.
+--
+-- >>> janeParams Salsa64_8 BLAKE512 13 2 0 == Just defaultJaneParams
+-- True
+-- >>> janeParams ChaCha20_8 SHA512 31 3 0
+-- Nothing
+-- >>> janeParams Salsa64_8 SHA512 10 7 17
+-- Nothing
+janeParams :: Mix -> Hash -> Int -> Int -> Int -> Maybe JaneParams
+janeParams mix hash n r p
+  | n < 0 || n > 30 = Nothing
+  | r < 0 || r > maxR = Nothing
+  | p < 0 || p > 25 = Nothing
+  | (2^p + 1) * chunk >= (2^(32 :: Int) :: Integer) = Nothing
+  | otherwise = Just $! JaneParams mix hash (fromIntegral n)
+                                   (fromIntegral r) (fromIntegral p)
+  where maxR = case mix of ChaCha20_8 -> 8
+                           Salsa64_8  -> 7
+        chunk = 2 * 2^r * blockBytes mix
+
+-- | @Salsa64_8@ and @BLAKE512@, with @Nfactor = 13@, @rfactor = 2@
+-- and @pfactor = 0@. This uses 16MB, the same as scrypt's
+-- recommended interactive parameters.
+defaultJaneParams :: JaneParams
+defaultJaneParams = fromJust (janeParams Salsa64_8 BLAKE512 13 2 0)
+
+-- | The number of bytes of memory @'stretch'@ needs for the given
+-- parameters.
+--
+-- >>> janeMemory defaultJaneParams
+-- 16777216
+janeMemory :: JaneParams -> Integer
+janeMemory (JaneParams mix _ n r _) =
+  (1 `shiftL` (fromIntegral n + 1)) * 2 * (1 `shiftL` fromIntegral r) * blockBytes mix
+
+blockBytes :: Mix -> Integer
+blockBytes ChaCha20_8 = 64
+blockBytes Salsa64_8  = 128
+
+-- | @'stretch' params n salt buf@ stretches @buf@ into an @n@ byte
+-- key with the given @salt@.
+--
+-- If the @'janeMemory'@ the parameters call for can't be allocated,
+-- an @'IOError'@ is thrown when the result is evaluated.
+--
+-- >>> let Just params = janeParams ChaCha20_8 SHA512 3 0 0
+-- >>> let key = stretch params 32 (Salt "salt") "password"
+-- >>> S.length key
+-- 32
+stretch :: JaneParams -- ^ Parameters
+        -> Int        -- ^ Length of resulting buffer
+        -> Salt       -- ^ The salt to use
+        -> ByteString -- ^ Input buffer
+        -> ByteString -- ^ Resulting key
+stretch (JaneParams mix hash n r p) len (Salt salt) pass =
+  unsafePerformIO . SU.unsafeUseAsCStringLen pass $ \(ppass, passlen) ->
+    SU.unsafeUseAsCStringLen salt $ \(psalt, saltlen) ->
+      SI.create len $ \out -> do
+        rc <- c_scrypt_jane (fromIntegral $ fromEnum mix) (fromIntegral $ fromEnum hash)
+                ppass (fromIntegral passlen) psalt (fromIntegral saltlen)
+                n r p out (fromIntegral len)
+        when (rc /= 0) $
+          ioError (userError "Crypto.KDF.ScryptJane.stretch: out of memory")
+
+-- | Equivalent to @'stretch' 'defaultJaneParams'@.
+stretch' :: Int -> Salt -> ByteString -> ByteString
+stretch' = stretch defaultJaneParams
+
+--
+-- FFI scrypt-jane binding
+--
+
+-- Parameters are validated by janeParams, so the call only fails if
+-- scrypt-jane runs out of memory (or fails its self test)
+foreign import ccall unsafe "nacl_scrypt_jane"
+  c_scrypt_jane :: CInt -> CInt -> Ptr CChar -> CSize -> Ptr CChar -> CSize
+                -> Word8 -> Word8 -> Word8 -> Ptr Word8 -> CSize -> IO CInt
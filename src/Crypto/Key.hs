@@ -1,3 +1,4 @@
+{-# LANGUAGE ForeignFunctionInterface #-}
 -- |
 -- Module      : Crypto.Key
 -- Copyright   : (c) Austin Seipp 2011-2013
@@ -12,12 +13,29 @@
 module Crypto.Key
        ( SecretKey(..)        -- :: *
        , PublicKey(..)        -- :: *
+
+         -- * Hex encoding
+       , encodeHex            -- :: ByteString -> ByteString
+       , decodeHex            -- :: ByteString -> Maybe ByteString
+       , showsHex             -- :: ByteString -> ShowS
+       , readsHex             -- :: ReadS ByteString
        ) where
-import           Data.ByteString (ByteString)
-import qualified Data.ByteString as B
+import           Data.Char                (isSpace, isHexDigit)
 import           Data.Word
-import           Numeric         (readHex)
-import           Text.Printf     (printf)
+import           Foreign.C.Types
+import           Foreign.ForeignPtr       (withForeignPtr)
+import           Foreign.Ptr
+
+import           System.IO.Unsafe         (unsafePerformIO)
+
+import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as B
+import qualified Data.ByteString.Char8    as B8
+import qualified Data.ByteString.Internal as BI
+import qualified Data.ByteString.Unsafe   as BU
+
+-- $setup
+-- >>> :set -XOverloadedStrings
 
 -- | A @'SecretKey'@ created by @'createKeypair'@. Be sure to keep
 -- this safe!
@@ -25,36 +43,74 @@ newtype SecretKey t = SecretKey { unSecretKey :: ByteString }
         deriving (Eq, Ord)
 
 instance Show (SecretKey t) where
-  show (SecretKey xs) = writeBytes xs
+  showsPrec _ (SecretKey xs) = showsHex xs
 
 instance Read (SecretKey t) where
-  readsPrec _ xs = [(SecretKey $ readBytes xs, "")]
+  readsPrec _ xs = [ (SecretKey k, r) | (k, r) <- readsHex xs ]
 
 -- | A @'PublicKey'@ created by @'createKeypair'@.
 newtype PublicKey t = PublicKey { unPublicKey :: ByteString }
         deriving (Eq, Ord)
 
 instance Show (PublicKey t) where
-  show (PublicKey xs) = writeBytes xs
+  showsPrec _ (PublicKey xs) = showsHex xs
 
 instance Read (PublicKey t) where
-  readsPrec _ xs = [(PublicKey $ readBytes xs, "")]
+  readsPrec _ xs = [ (PublicKey k, r) | (k, r) <- readsHex xs ]
+
+--------------------------------------------------------------------------------
+-- Hex encoding
 
+-- | Encode a @'ByteString'@ as lowercase hexadecimal.
 --
--- Utilities
+-- >>> encodeHex "\x01\xab\xff"
+-- "01abff"
+encodeHex :: ByteString -> ByteString
+encodeHex xs =
+  unsafePerformIO . BU.unsafeUseAsCStringLen xs $ \(pxs,l) ->
+    BI.create (2*l) $ \out ->
+      c_hex_encode out pxs (fromIntegral l)
+{-# INLINE encodeHex #-}
+
+-- | Decode a hexadecimal @'ByteString'@ (in either case.) Returns
+-- @'Nothing'@ if the input has an odd length or contains anything
+-- other than hex digits.
 --
+-- >>> decodeHex "01ABff"
+-- Just "\SOH\171\255"
+-- >>> decodeHex "0g"
+-- Nothing
+decodeHex :: ByteString -> Maybe ByteString
+decodeHex xs
+  | odd l     = Nothing
+  | otherwise = unsafePerformIO . BU.unsafeUseAsCString xs $ \pxs -> do
+      out <- BI.mallocByteString (l `div` 2)
+      r <- withForeignPtr out $ \pout ->
+             c_hex_decode pout pxs (fromIntegral l)
+      return $! if r /= 0 then Nothing
+                else Just (BI.fromForeignPtr out 0 (l `div` 2))
+  where l = B.length xs
+{-# INLINE decodeHex #-}
+
+-- | Render a @'ByteString'@ in hex, for use in @'Show'@ instances.
+showsHex :: ByteString -> ShowS
+showsHex xs = showString (B8.unpack $ encodeHex xs)
+{-# INLINE showsHex #-}
+
+-- | Parse a run of hex digits (after any leading whitespace), for use
+-- in @'Read'@ instances.
+readsHex :: ReadS ByteString
+readsHex xs = case decodeHex (B8.pack hex) of
+  Just k  -> [(k, rest)]
+  Nothing -> []
+  where (hex, rest) = span isHexDigit (dropWhile isSpace xs)
 
-writeBytes :: ByteString -> String
-writeBytes = concatMap (printf "%02x") . B.unpack
+--
+-- FFI hex binding
+--
 
-readBytes :: String -> ByteString
-readBytes = B.pack . map reader . chunk 2
-  where reader :: String -> Word8
-        reader x = case readHex x of
-          [(a, "")] -> a
-          _         -> error "invalid key bytes in readBytes"
+foreign import ccall unsafe "nacl_hex_encode"
+  c_hex_encode :: Ptr Word8 -> Ptr CChar -> CSize -> IO ()
 
-        chunk :: Int -> [a] -> [[a]]
-        chunk _ [] = []
-        chunk n xs = y1 : chunk n y2
-          where (y1, y2) = splitAt n xs
+foreign import ccall unsafe "nacl_hex_decode"
+  c_hex_decode :: Ptr Word8 -> Ptr CChar -> CSize -> IO CInt
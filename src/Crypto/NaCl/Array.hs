@@ -0,0 +1,235 @@
+-- |
+-- Module      : Crypto.NaCl.Array
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- Packed arrays of fixed-size records: keys, nonces, digests and
+-- signatures.
+--
+-- An @'Array'@ keeps all of its records back to back in a single
+-- pinned buffer, so a batch of @n@ keys costs one allocation instead
+-- of @n@, indexing and slicing are O(1) and never copy, and the
+-- library's batch functions hand the buffer straight to C without
+-- marshalling anything.
+--
+-- Arrays interoperate with anything built on @'ForeignPtr'@ through
+-- @'toForeignPtr'@ and @'fromForeignPtr'@. For example, the contents
+-- of a storable @Vector Word8@ can be used without copying:
+--
+-- > import qualified Data.Vector.Storable as V
+-- >
+-- > toVector   :: Array a -> V.Vector Word8
+-- > toVector arr = let (fp, o, l) = toForeignPtr arr in V.unsafeFromForeignPtr fp o l
+-- >
+-- > fromVector :: Int -> V.Vector Word8 -> Maybe (Array a)
+-- > fromVector sz v = let (fp, o, l) = V.unsafeToForeignPtr v in fromForeignPtr sz fp o l
+--
+-- Other modules provide @'Packed'@ instances and array synonyms for
+-- their own record types, e.g. @SignatureArray@ in
+-- "Crypto.Sign.Ed25519".
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with the Prelude, e.g.
+--
+-- > import qualified Crypto.NaCl.Array as A
+--
+module Crypto.NaCl.Array
+       ( -- * Types
+         Array            -- :: * -> *
+       , Packed(..)       -- :: class
+       , KeyArray         -- :: * -> *
+       , PublicKeyArray   -- :: * -> *
+       , NonceArray       -- :: * -> *
+       , DigestArray      -- :: *
+
+         -- * Construction
+       , empty            -- :: Int -> Array a
+       , fromList         -- :: Packed a => Int -> [a] -> Maybe (Array a)
+       , fromBytes        -- :: Int -> ByteString -> Maybe (Array a)
+       , create           -- :: Int -> Int -> (Ptr Word8 -> IO ()) -> IO (Array a)
+
+         -- * Queries
+       , recordSize       -- :: Array a -> Int
+       , length           -- :: Array a -> Int
+       , null             -- :: Array a -> Bool
+       , index            -- :: Packed a => Array a -> Int -> Maybe a
+       , unsafeIndex      -- :: Packed a => Array a -> Int -> a
+       , slice            -- :: Int -> Int -> Array a -> Array a
+
+         -- * Conversion
+       , toList           -- :: Packed a => Array a -> [a]
+       , toBytes          -- :: Array a -> ByteString
+       , toForeignPtr     -- :: Array a -> (ForeignPtr Word8, Int, Int)
+       , fromForeignPtr   -- :: Int -> ForeignPtr Word8 -> Int -> Int -> Maybe (Array a)
+       , withArrayPtr     -- :: Array a -> (Ptr Word8 -> Int -> IO b) -> IO b
+       ) where
+import           Prelude                  hiding (length, null)
+
+import           Data.Word
+import           Foreign.ForeignPtr       (ForeignPtr, withForeignPtr)
+import           Foreign.Ptr
+
+import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as S
+import qualified Data.ByteString.Internal as SI
+import qualified Data.ByteString.Unsafe   as SU
+
+import           Crypto.Key
+import           Crypto.Nonce
+
+-- $setup
+-- >>> :set -XOverloadedStrings
+-- >>> import qualified Data.ByteString as S
+
+-- | A packed array of records of type @a@, all of the same size.
+data Array a = Array !Int        -- Record size
+                     !ByteString -- Contents; a multiple of the record size
+  deriving Eq
+
+instance Show (Array a) where
+  showsPrec d (Array sz xs) = showParen (d > 10) $
+    showString "fromBytes " . shows sz . showString " " . showsHex xs
+
+-- | Types which can be stored in an @'Array'@, by converting to and
+-- from their raw bytes.
+class Packed a where
+  packRecord   :: a -> ByteString
+  unpackRecord :: ByteString -> a
+
+instance Packed ByteString where
+  packRecord   = id
+  unpackRecord = id
+
+instance Packed (SecretKey t) where
+  packRecord   = unSecretKey
+  unpackRecord = SecretKey
+
+instance Packed (PublicKey t) where
+  packRecord   = unPublicKey
+  unpackRecord = PublicKey
+
+instance Packed (Nonce t) where
+  packRecord   = unNonce
+  unpackRecord = Nonce
+
+-- | A packed array of secret keys.
+type KeyArray t = Array (SecretKey t)
+
+-- | A packed array of public keys.
+type PublicKeyArray t = Array (PublicKey t)
+
+-- | A packed array of nonces.
+type NonceArray t = Array (Nonce t)
+
+-- | A packed array of hashes or authenticators.
+type DigestArray = Array ByteString
+
+--------------------------------------------------------------------------------
+-- Construction
+
+-- | An empty array of records of the given size.
+empty :: Int -> Array a
+empty sz = Array (max 1 sz) S.empty
+
+-- | Pack a list of records of the given size. Returns @'Nothing'@ if
+-- any record has a different size.
+--
+-- >>> fmap length (fromList 2 ["ab", "cd" :: ByteString])
+-- Just 2
+-- >>> fromList 2 ["ab", "c" :: ByteString]
+-- Nothing
+fromList :: Packed a => Int -> [a] -> Maybe (Array a)
+fromList sz xs
+  | sz <= 0                          = Nothing
+  | all ((== sz) . S.length) records = Just (Array sz (S.concat records))
+  | otherwise                        = Nothing
+  where records = map packRecord xs
+
+-- | View a buffer as an array of records of the given size, without
+-- copying. Returns @'Nothing'@ if its length is not a multiple of the
+-- record size.
+fromBytes :: Int -> ByteString -> Maybe (Array a)
+fromBytes sz xs
+  | sz <= 0                   = Nothing
+  | S.length xs `rem` sz /= 0 = Nothing
+  | otherwise                 = Just (Array sz xs)
+
+-- | @'create' sz n f@ allocates room for @n@ records of @sz@ bytes
+-- each and fills it in with @f@. This is how batch functions return
+-- their results.
+create :: Int -> Int -> (Ptr Word8 -> IO ()) -> IO (Array a)
+create sz n f = Array sz' `fmap` SI.create (sz' * max 0 n) f
+  where sz' = max 1 sz
+
+--------------------------------------------------------------------------------
+-- Queries
+
+-- | The size of every record, in bytes.
+recordSize :: Array a -> Int
+recordSize (Array sz _) = sz
+
+-- | The number of records.
+length :: Array a -> Int
+length (Array sz xs) = S.length xs `quot` sz
+{-# INLINE length #-}
+
+-- | Whether the array has no records.
+null :: Array a -> Bool
+null (Array _ xs) = S.null xs
+
+-- | The record at the given position, if there is one. O(1), and
+-- the result shares the array's buffer.
+index :: Packed a => Array a -> Int -> Maybe a
+index arr i
+  | i < 0 || i >= length arr = Nothing
+  | otherwise                = Just (unsafeIndex arr i)
+{-# INLINE index #-}
+
+-- | Like @'index'@, without the bounds check.
+unsafeIndex :: Packed a => Array a -> Int -> a
+unsafeIndex (Array sz xs) i =
+  unpackRecord (SU.unsafeTake sz (SU.unsafeDrop (i*sz) xs))
+{-# INLINE unsafeIndex #-}
+
+-- | @'slice' i n arr@ is the (at most) @n@ records starting at
+-- position @i@. O(1), and the result shares the array's buffer.
+--
+-- >>> let Just arr = fromList 1 ["a", "b", "c", "d" :: ByteString]
+-- >>> toList (slice 1 2 arr)
+-- ["b","c"]
+slice :: Int -> Int -> Array a -> Array a
+slice i n (Array sz xs) = Array sz (S.take (max 0 n * sz) (S.drop (max 0 i * sz) xs))
+{-# INLINE slice #-}
+
+--------------------------------------------------------------------------------
+-- Conversion
+
+-- | Unpack all of the records. None of them are copied.
+toList :: Packed a => Array a -> [a]
+toList arr = map (unsafeIndex arr) [0 .. length arr - 1]
+
+-- | The underlying buffer.
+toBytes :: Array a -> ByteString
+toBytes (Array _ xs) = xs
+
+-- | The underlying buffer, as a pointer, offset and length in bytes.
+toForeignPtr :: Array a -> (ForeignPtr Word8, Int, Int)
+toForeignPtr (Array _ xs) = SI.toForeignPtr xs
+
+-- | View @len@ bytes at offset @off@ of a pointer as an array of
+-- records of the given size. Returns @'Nothing'@ if @len@ is not a
+-- multiple of the record size. The memory must not be modified
+-- afterwards.
+fromForeignPtr :: Int -> ForeignPtr Word8 -> Int -> Int -> Maybe (Array a)
+fromForeignPtr sz fp off len = fromBytes sz (SI.fromForeignPtr fp off len)
+
+-- | Run an action with a pointer to the first record and the number
+-- of records. The pointer must not be used after the action returns.
+withArrayPtr :: Array a -> (Ptr Word8 -> Int -> IO b) -> IO b
+withArrayPtr arr k = withForeignPtr fp $ \p -> k (p `plusPtr` off) (length arr)
+  where (fp, off, _) = toForeignPtr arr
+{-# INLINE withArrayPtr #-}
@@ -29,9 +29,9 @@ import           Foreign.Ptr
 import           Data.ByteString          as S
 import           Data.ByteString.Internal as SI
 import           Data.ByteString.Unsafe   as SU
-import           Numeric
+
+import           Crypto.Key               (readsHex, showsHex)
 import           System.Crypto.Random
-import           Text.Printf              (printf)
 
 -- | A @'Nonce' t@ is a @'ByteString'@ parameterized by some type @t@,
 -- which designates what interface the @'Nonce'@ is used for. This
@@ -41,10 +41,10 @@ newtype Nonce t = Nonce { unNonce :: ByteString }
   deriving Eq
 
 instance Show (Nonce t) where
-  show (Nonce xs) = writeBytes xs
+  showsPrec _ (Nonce xs) = showsHex xs
 
 instance Read (Nonce t) where
-  readsPrec _ xs = [(Nonce $ readBytes xs, "")]
+  readsPrec _ xs = [ (Nonce n, r) | (n, r) <- readsHex xs ]
 
 -- | A common interface for different nonces.
 class Nonces t where
@@ -79,25 +79,6 @@ incBS n =
     c_incnonce out (fromIntegral (S.length n))
 {-# INLINE incBS #-}
 
---
--- Utilities
---
-
-writeBytes :: ByteString -> String
-writeBytes = Prelude.concatMap (printf "%02x") . S.unpack
-
-readBytes :: String -> ByteString
-readBytes = S.pack . Prelude.map reader . chunk 2
-  where reader :: String -> Word8
-        reader x = case readHex x of
-          [(a, "")] -> a
-          _         -> error "invalid key bytes in readBytes"
-
-        chunk :: Int -> [a] -> [[a]]
-        chunk _ [] = []
-        chunk n xs = y1 : chunk n y2
-          where (y1, y2) = Prelude.splitAt n xs
-
 --
 -- FFI
 --
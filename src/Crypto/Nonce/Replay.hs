@@ -0,0 +1,121 @@
+{-# LANGUAGE ForeignFunctionInterface #-}
+-- |
+-- Module      : Crypto.Nonce.Replay
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- Rejecting replayed messages on the receiving end, for senders which
+-- use counter nonces (e.g. with @'incNonce'@).
+--
+-- A @'ReplayWindow'@ is a sliding bitmap over the 64-bit counter in
+-- the last 8 bytes of each nonce, in the style of IPsec and
+-- WireGuard: a counter is accepted once, and only if it is no more
+-- than the window size behind the highest counter accepted so far, so
+-- messages may arrive somewhat out of order. Memory use is fixed by
+-- the window size.
+--
+-- Any number of threads may check nonces against the same window at
+-- once. Checks take no locks: every one is a couple of atomic
+-- compare-and-swaps on the bitmap.
+--
+-- Only check a nonce after its message has been authenticated (e.g.
+-- once @'Crypto.Encrypt.SecretBox.decrypt'@ has succeeded), or
+-- forged messages can use up counters.
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with other cryptographic primitives, e.g.
+--
+-- > import qualified Crypto.Nonce.Replay as Replay
+--
+module Crypto.Nonce.Replay
+       ( -- * Replay windows
+         ReplayWindow     -- :: *
+       , newReplayWindow  -- :: Int -> IO ReplayWindow
+       , windowSize       -- :: ReplayWindow -> Int
+
+         -- * Checking nonces
+       , checkAndMark     -- :: ReplayWindow -> Nonce t -> IO Bool
+       , checkAndMarkMany -- :: ReplayWindow -> [Nonce t] -> IO [Bool]
+       , nonceCounter     -- :: Nonce t -> Word64
+       ) where
+import           Data.Word
+import           Foreign.C.Types
+import           Foreign.ForeignPtr
+import           Foreign.Marshal.Array (allocaArray, peekArray, withArray)
+import           Foreign.Ptr
+
+import qualified Data.ByteString       as S
+
+import           Crypto.Nonce
+
+-- $setup
+-- >>> import Crypto.Encrypt.SecretBox (SecretBox)
+
+-- | A sliding window of recently seen nonce counters.
+data ReplayWindow = ReplayWindow !Int !(ForeignPtr Word8)
+
+-- | Create a window which accepts counters up to the given number
+-- behind the highest one seen (at least one).
+newReplayWindow :: Int -> IO ReplayWindow
+newReplayWindow n = do
+  fp <- mallocForeignPtrBytes (fromIntegral (c_replay_bytes w))
+  withForeignPtr fp $ \p -> c_replay_init p w
+  return (ReplayWindow n' fp)
+  where n' = max 1 n
+        w  = fromIntegral n'
+
+-- | The size of a window, as given to @'newReplayWindow'@.
+windowSize :: ReplayWindow -> Int
+windowSize (ReplayWindow n _) = n
+
+-- | Check that a nonce has not been seen before and is not too old,
+-- and if so, mark it as seen. Returns whether the nonce was accepted;
+-- it is accepted at most once, however many threads check it.
+--
+-- >>> w <- newReplayWindow 64
+-- >>> let n = Nonce (S.replicate 24 0) :: Nonce SecretBox
+-- >>> mapM (checkAndMark w) [incNonce n, n, incNonce n]
+-- [True,True,False]
+checkAndMark :: ReplayWindow -> Nonce t -> IO Bool
+checkAndMark (ReplayWindow _ fp) n =
+  withForeignPtr fp $ \p ->
+    (== 0) `fmap` c_replay_check p (fromIntegral (nonceCounter n))
+
+-- | Check a batch of nonces, as if with @'checkAndMark'@ in order,
+-- in one foreign call.
+checkAndMarkMany :: ReplayWindow -> [Nonce t] -> IO [Bool]
+checkAndMarkMany _ [] = return []
+checkAndMarkMany (ReplayWindow _ fp) ns =
+  withForeignPtr fp $ \p ->
+    allocaArray len $ \pok ->
+      withArray (map (fromIntegral . nonceCounter) ns) $ \pc -> do
+        c_replay_check_many p pok pc (fromIntegral len)
+        map (/= 0) `fmap` peekArray len pok
+  where len = length ns
+
+-- | The counter in a nonce: its last 8 bytes, big-endian, as
+-- incremented by @'incNonce'@.
+nonceCounter :: Nonce t -> Word64
+nonceCounter (Nonce xs) = S.foldl' step 0 (S.drop (S.length xs - 8) xs)
+  where step acc b = acc * 256 + fromIntegral b
+
+--
+-- FFI
+--
+
+foreign import ccall unsafe "nacl_replay_bytes"
+  c_replay_bytes :: CULLong -> CSize
+
+foreign import ccall unsafe "nacl_replay_init"
+  c_replay_init :: Ptr Word8 -> CULLong -> IO ()
+
+foreign import ccall unsafe "nacl_replay_check"
+  c_replay_check :: Ptr Word8 -> CULLong -> IO CInt
+
+foreign import ccall unsafe "nacl_replay_check_many"
+  c_replay_check_many :: Ptr Word8 -> Ptr CUChar -> Ptr CULLong -> CSize ->
+                         IO ()
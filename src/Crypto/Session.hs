@@ -0,0 +1,341 @@
+{-# LANGUAGE ForeignFunctionInterface #-}
+-- |
+-- Module      : Crypto.Session
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : GHC
+--
+-- Encrypted, authenticated record channels over a @'Handle'@.
+--
+-- A @'Session'@ performs a single Curve25519 key exchange when it is
+-- opened and from then on seals every record with the precomputed
+-- @'NM'@ from "Crypto.Encrypt.Box" and a per-direction counter nonce,
+-- so no nonces are ever sent on the wire. When the session is opened,
+-- each end sends its public key and 32 random bytes. Both ends'
+-- random bytes go into the nonces, so no two sessions share a (key,
+-- nonce) pair. Records are framed as
+--
+-- > length (4 bytes, big endian) || tag (16 bytes) || ciphertext
+--
+-- Outbound records handed to @'sendMany'@ are sealed into a single
+-- buffer and written with one write, by a dedicated writer thread, so
+-- sealing the next batch overlaps with writing the previous
+-- one. Inbound data is read in large chunks, and every complete
+-- record in a chunk is opened with one foreign call.
+--
+-- Any authentication failure, truncated record or out-of-order record
+-- is fatal to the session and is raised as an @'IOError'@.
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with other cryptographic primitives, e.g.
+--
+-- > import qualified Crypto.Session as Session
+--
+module Crypto.Session
+       ( -- * Security model
+         -- $securitymodel
+
+         -- * Sessions
+         Session     -- :: *
+       , handshake   -- :: Handle -> (PublicKey Box, SecretKey Box) -> IO Session
+       , sessionPeer -- :: Session -> PublicKey Box
+
+         -- * Sending and receiving records
+       , send        -- :: Session -> ByteString -> IO ()
+       , sendMany    -- :: Session -> [ByteString] -> IO ()
+       , recv        -- :: Session -> IO (Maybe ByteString)
+       , recvMany    -- :: Session -> IO [ByteString]
+       , flush       -- :: Session -> IO ()
+       , close       -- :: Session -> IO ()
+       ) where
+import           Control.Concurrent       (forkIO)
+import           Control.Concurrent.MVar
+import           Control.Exception        (SomeException, throwIO, try)
+import           Control.Monad            (unless, when)
+import           Data.Bits                (shiftL, (.|.))
+import           Data.IORef
+import           Data.Word
+import           Foreign.C.Types
+import           Foreign.ForeignPtr
+import           Foreign.Marshal.Alloc    (alloca)
+import           Foreign.Marshal.Array    (allocaArray, peekArray, withArray)
+import           Foreign.Ptr
+import           Foreign.Storable
+import           System.IO
+
+import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as S
+import qualified Data.ByteString.Internal as SI
+import qualified Data.ByteString.Unsafe   as SU
+
+import           Crypto.Encrypt.Box       (Box, createNM, nmToBytes)
+import           Crypto.Hash.BLAKE2       (blake2b)
+import           Crypto.Key
+import           System.Crypto.Random     (randombytes)
+
+-- $securitymodel
+--
+-- Records are sealed with @crypto_box_afternm@, so each record gets
+-- the privacy and authenticity guarantees of "Crypto.Encrypt.Box";
+-- the implicit record counter additionally makes replayed, dropped
+-- or reordered records fail to open. Since both ends' handshake
+-- randomness is part of every nonce, records from one session will
+-- not open in another, even between the same two keys.
+--
+-- @'handshake'@ only exchanges public keys. It does /not/ check who is
+-- on the other end: callers must check @'sessionPeer'@ against the key
+-- they expect before trusting anything received on the session.
+
+-- | An open, encrypted channel.
+data Session = Session
+  { sHandle   :: Handle
+  , sPeer     :: PublicKey Box
+  , sKey      :: ByteString
+  , sSend     :: MVar (ForeignPtr Word8)
+  , sRecv     :: MVar RecvState
+  , sOutbox   :: MVar Outbound
+  , sWriteErr :: IORef (Maybe SomeException)
+  }
+
+data RecvState = RecvState
+  { rsNonce   :: ForeignPtr Word8
+  , rsBuffer  :: ByteString
+  , rsPending :: [ByteString]
+  , rsEOF     :: Bool
+  }
+
+data Outbound = Frames ByteString
+              | Flush (MVar ())
+              | Stop (MVar ())
+
+-- | Open a @'Session'@ over a @'Handle'@, by sending our
+-- @'PublicKey'@ and some fresh randomness, and reading the peer's.
+-- Both ends must call @'handshake'@.
+handshake :: Handle -> (PublicKey Box, SecretKey Box) -> IO Session
+handshake h (PublicKey pk, sk) = do
+  r <- randombytes sessionRANDOMBYTES
+  S.hPut h (pk `S.append` r) >> hFlush h
+  hello <- S.hGet h (boxPUBLICKEYBYTES + sessionRANDOMBYTES)
+  let (peer, r') = S.splitAt boxPUBLICKEYBYTES hello
+  when (S.length r' /= sessionRANDOMBYTES || peer == pk) $
+    ioError (userError "Crypto.Session: handshake failed")
+
+  -- The first 16 bytes of each direction's nonce are a hash of which
+  -- direction it is and both ends' randomness, in a fixed order; the
+  -- last 8 are the record counter.
+  let nm = nmToBytes (createNM (PublicKey peer) sk)
+      (ours, theirs) = if pk < peer then (0, 1) else (1, 0)
+      rs = if pk < peer then [r, r'] else [r', r]
+      prefix dir = S.take 16 (blake2b (S.concat (S.singleton dir : rs)))
+  sendNonce <- newNonce (prefix ours)
+  recvNonce <- newNonce (prefix theirs)
+
+  outbox <- newEmptyMVar
+  err    <- newIORef Nothing
+  _ <- forkIO (writer h outbox err)
+
+  sendLock <- newMVar sendNonce
+  recvLock <- newMVar (RecvState recvNonce S.empty [] False)
+  return $! Session h (PublicKey peer) nm sendLock recvLock outbox err
+
+-- | The @'PublicKey'@ the other end presented during the
+-- @'handshake'@.
+sessionPeer :: Session -> PublicKey Box
+sessionPeer = sPeer
+
+-- | Send a single record.
+send :: Session -> ByteString -> IO ()
+send s x = sendMany s [x]
+
+-- | Send several records at once. They are sealed into one buffer
+-- and handed to the writer thread, which writes them with a single
+-- call. This returns as soon as the batch is queued; use @'flush'@ to
+-- wait for it to reach the @'Handle'@.
+sendMany :: Session -> [ByteString] -> IO ()
+sendMany _ [] = return ()
+sendMany s msgs = do
+  checkWriter s
+  withMVar (sSend s) $ \nonce -> do
+    frames <- seal s nonce msgs
+    putMVar (sOutbox s) (Frames frames)
+
+-- | Receive the next record, or @'Nothing'@ once the peer has closed
+-- the connection.
+recv :: Session -> IO (Maybe ByteString)
+recv s = modifyMVar (sRecv s) $ \st ->
+  case rsPending st of
+    (x:xs) -> return (st { rsPending = xs }, Just x)
+    []     -> do
+      (st', msgs) <- fill s st
+      case msgs of
+        []     -> return (st', Nothing)
+        (x:xs) -> return (st' { rsPending = xs }, Just x)
+
+-- | Receive every record that is currently available, reading from
+-- the @'Handle'@ only if none are buffered. Returns @[]@ once the peer
+-- has closed the connection.
+recvMany :: Session -> IO [ByteString]
+recvMany s = modifyMVar (sRecv s) $ \st ->
+  case rsPending st of
+    [] -> fill s st
+    xs -> return (st { rsPending = [] }, xs)
+
+-- | Wait until every record sent so far has been written to the
+-- @'Handle'@ and flushed.
+flush :: Session -> IO ()
+flush s = do
+  ack <- newEmptyMVar
+  putMVar (sOutbox s) (Flush ack)
+  takeMVar ack
+  checkWriter s
+
+-- | Flush any outstanding records, stop the writer thread and close
+-- the underlying @'Handle'@.
+close :: Session -> IO ()
+close s = do
+  ack <- newEmptyMVar
+  putMVar (sOutbox s) (Stop ack)
+  takeMVar ack
+  hClose (sHandle s)
+  checkWriter s
+
+--
+-- Utilities
+--
+
+newNonce :: ByteString -> IO (ForeignPtr Word8)
+newNonce prefix = do
+  fp <- mallocForeignPtrBytes sessionNONCEBYTES
+  withForeignPtr fp $ \p -> do
+    _ <- SI.memset p 0 (fromIntegral sessionNONCEBYTES)
+    SU.unsafeUseAsCStringLen prefix $ \(pp, l) ->
+      SI.memcpy p (castPtr pp) (fromIntegral l)
+  return fp
+
+writer :: Handle -> MVar Outbound -> IORef (Maybe SomeException) -> IO ()
+writer h outbox err = loop
+  where
+    loop = do
+      x <- takeMVar outbox
+      case x of
+        Frames bs -> put bs >> loop
+        Flush ack -> putMVar ack () >> loop
+        Stop ack  -> putMVar ack ()
+
+    -- once a write fails the session is dead, but keep draining the
+    -- outbox so senders never block
+    put bs = do
+      failed <- readIORef err
+      case failed of
+        Just _  -> return ()
+        Nothing -> do
+          r <- try (S.hPut h bs >> hFlush h)
+          either (writeIORef err . Just) return r
+
+checkWriter :: Session -> IO ()
+checkWriter s = readIORef (sWriteErr s) >>= maybe (return ()) throwIO
+
+seal :: Session -> ForeignPtr Word8 -> [ByteString] -> IO ByteString
+seal s nonce msgs = do
+  let m      = S.concat msgs
+      n      = length msgs
+      outlen = S.length m + n*sessionHEADERBYTES
+  out <- SI.mallocByteString outlen
+  r <- withForeignPtr out $ \pout ->
+    SU.unsafeUseAsCString m $ \pm ->
+      withArray (map (fromIntegral . S.length) msgs) $ \plens ->
+        withForeignPtr nonce $ \pn ->
+          SU.unsafeUseAsCString (sKey s) $ \pk ->
+            c_session_seal pout pm plens (fromIntegral n) pn pk
+  when (r /= 0) $ ioError (userError "Crypto.Session: record too large")
+  return $! SI.fromForeignPtr out 0 outlen
+
+-- Open every complete record in the buffer, reading more input until
+-- there is at least one (or the peer has gone away.)
+fill :: Session -> RecvState -> IO (RecvState, [ByteString])
+fill s st = do
+  (msgs, rest) <- open s (rsNonce st) (rsBuffer st)
+  let st' = st { rsBuffer = rest }
+  if not (null msgs) then return (st', msgs) else
+    if rsEOF st
+      then do unless (S.null rest) $
+                ioError (userError "Crypto.Session: truncated record")
+              return (st', [])
+      else do
+        when (frameLength rest > sessionMAXFRAME) $
+          ioError (userError "Crypto.Session: record too large")
+        chunk <- if want rest > recvCHUNK
+                   then S.hGet (sHandle s) (want rest)
+                   else S.hGetSome (sHandle s) recvCHUNK
+        if S.null chunk
+          then fill s st' { rsEOF = True }
+          else fill s st' { rsBuffer = rest `S.append` chunk }
+  where
+    want buf = frameLength buf - S.length buf
+
+open :: Session -> ForeignPtr Word8 -> ByteString -> IO ([ByteString], ByteString)
+open s nonce buf
+  | S.length buf < frameLength buf = return ([], buf)
+  | otherwise = do
+      let inlen = S.length buf
+          maxn  = inlen `div` sessionHEADERBYTES + 1
+      out <- SI.mallocByteString inlen
+      (r, used, lens) <- withForeignPtr out $ \pout ->
+        allocaArray maxn $ \plens ->
+          alloca $ \pused ->
+            SU.unsafeUseAsCString buf $ \pin ->
+              withForeignPtr nonce $ \pn ->
+                SU.unsafeUseAsCString (sKey s) $ \pk -> do
+                  r <- c_session_open pout plens (fromIntegral maxn)
+                                      pin (fromIntegral inlen) pused pn pk
+                  u <- peek pused
+                  l <- if r > 0 then peekArray (fromIntegral r) plens
+                                else return []
+                  return (r, u, l)
+      when (r < 0) $ ioError (userError "Crypto.Session: authentication failure")
+      return ( slices (SI.fromForeignPtr out 0 inlen) (map fromIntegral lens)
+             , S.drop (fromIntegral used) buf )
+  where
+    slices _  []     = []
+    slices bs (l:ls) = let (x, rest) = S.splitAt l bs in x : slices rest ls
+
+-- The number of bytes needed for the first frame in the buffer to be
+-- complete.
+frameLength :: ByteString -> Int
+frameLength buf
+  | S.length buf < 4 = 4
+  | otherwise = 4 + foldl (\a i -> a `shiftL` 8 .|. fromIntegral (SU.unsafeIndex buf i)) 0 [0..3]
+
+--
+-- FFI session binding
+--
+
+boxPUBLICKEYBYTES :: Int
+boxPUBLICKEYBYTES = 32
+
+sessionNONCEBYTES :: Int
+sessionNONCEBYTES = 24
+
+sessionRANDOMBYTES :: Int
+sessionRANDOMBYTES = 32
+
+sessionHEADERBYTES :: Int
+sessionHEADERBYTES = 20
+
+sessionMAXFRAME :: Int
+sessionMAXFRAME = sessionHEADERBYTES + 16*1024*1024
+
+recvCHUNK :: Int
+recvCHUNK = 65536
+
+foreign import ccall unsafe "nacl_session_seal"
+  c_session_seal :: Ptr Word8 -> Ptr CChar -> Ptr CULLong -> CULLong ->
+                    Ptr Word8 -> Ptr CChar -> IO CInt
+
+foreign import ccall unsafe "nacl_session_open"
+  c_session_open :: Ptr Word8 -> Ptr CULLong -> CULLong ->
+                    Ptr CChar -> CULLong -> Ptr CULLong ->
+                    Ptr Word8 -> Ptr CChar -> IO CLLong
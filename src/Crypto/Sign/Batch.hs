@@ -0,0 +1,224 @@
+-- |
+-- Module      : Crypto.Sign.Batch
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- Signing many messages with a single ed25519 signature.
+--
+-- @'signBatch'@ builds a BLAKE2b Merkle tree over a batch of
+-- messages and signs only its root. Every message gets a
+-- @'BatchProof'@: the root signature, plus the sibling hashes needed
+-- to recompute the root from that message. Signing @n@ messages
+-- costs one signature and about @2n@ small hashes.
+--
+-- @'verifyInBatch'@ checks a message against its proof with a
+-- @'VerifyCache'@, which remembers verified roots: the first
+-- message from a batch costs one signature verification, and every
+-- other one only the @log2 n@ hashes along its path.
+--
+-- A proof is @72 + 32 * ceiling (log2 n)@ bytes long once encoded,
+-- so this only saves space over @'sign''@ for small batches; the
+-- main saving is in signing and verification time.
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with other cryptographic primitives, e.g.
+--
+-- > import qualified Crypto.Sign.Batch as Batch
+--
+module Crypto.Sign.Batch
+       ( -- * Proofs
+         BatchProof        -- :: *
+       , proofIndex        -- :: BatchProof -> Int
+       , proofSize         -- :: BatchProof -> Int
+       , proofSignature    -- :: BatchProof -> Signature
+       , proofPath         -- :: BatchProof -> [ByteString]
+       , encodeProof       -- :: BatchProof -> ByteString
+       , decodeProof       -- :: ByteString -> Maybe BatchProof
+
+         -- * Signing
+       , signBatch         -- :: SecretKey Ed25519 -> [ByteString] -> [BatchProof]
+
+         -- * Verifying
+       , verifyBatch       -- :: PublicKey Ed25519 -> ByteString -> BatchProof -> Bool
+       , verifyInBatch     -- :: VerifyCache -> PublicKey Ed25519 -> ByteString -> BatchProof -> IO Bool
+       ) where
+import           Data.Bits                 (shiftL, shiftR, xor, (.|.))
+import           Data.Maybe                (fromMaybe)
+
+import           Data.ByteString           (ByteString)
+import qualified Data.ByteString           as S
+
+import           Crypto.Hash.BLAKE2        (blake2b)
+import           Crypto.Key
+import           Crypto.NaCl.Array         (DigestArray)
+import qualified Crypto.NaCl.Array         as A
+import           Crypto.Sign.Ed25519
+import           Crypto.Sign.Ed25519.Cache (VerifyCache, verifyCached)
+
+-- $setup
+-- >>> :set -XOverloadedStrings
+-- >>> import Crypto.Sign.Ed25519.Cache
+-- >>> (pk,sk) <- createKeypair
+
+-- | Proof that a message was part of a signed batch.
+data BatchProof = BatchProof
+  { proofIndex     :: !Int       -- ^ Position of the message in its batch
+  , proofSize      :: !Int       -- ^ Number of messages in the batch
+  , proofPath      :: [ByteString] -- ^ Sibling hashes, from the leaf up
+  , proofSignature :: !Signature -- ^ Signature of the batch's root
+  } deriving (Eq, Show)
+
+-- | Sign a batch of messages, returning one proof for each, in
+-- order.
+--
+-- >>> let proofs = signBatch sk ["a", "b", "c"]
+-- >>> and (zipWith (verifyBatch pk) ["a", "b", "c"] proofs)
+-- True
+-- >>> verifyBatch pk "b" (head proofs)
+-- False
+signBatch :: SecretKey Ed25519 -> [ByteString] -> [BatchProof]
+signBatch _ [] = []
+signBatch sk msgs = [ BatchProof i n (path i) sig | i <- [0 .. n-1] ]
+  where
+    n      = length msgs
+    levels = treeLevels (packDigests (map leafHash msgs))
+    root   = A.unsafeIndex (last levels) 0
+    sig    = sign' sk (rootMessage n root)
+
+    path i = [ A.unsafeIndex lvl (j `xor` 1)
+             | (lvl, j) <- zip (init levels) (iterate (`shiftR` 1) i)
+             , j `xor` 1 < A.length lvl
+             ]
+
+-- | Verify a message against its proof.
+verifyBatch :: PublicKey Ed25519
+            -- ^ Signers public key
+            -> ByteString
+            -- ^ Message
+            -> BatchProof
+            -- ^ Proof for the message
+            -> Bool
+verifyBatch pk xs p = case proofRoot xs p of
+  Nothing   -> False
+  Just root -> verify' pk (rootMessage (proofSize p) root) (proofSignature p)
+
+-- | Like @'verifyBatch'@, but only verifies the root's signature if
+-- it is not already in the cache.
+--
+-- >>> cache <- newVerifyCache 1024
+-- >>> let proofs = signBatch sk ["a", "b", "c"]
+-- >>> fmap and (sequence (zipWith (verifyInBatch cache pk) ["a", "b", "c"] proofs))
+-- True
+-- >>> fmap cacheHits (cacheStats cache)
+-- 2
+verifyInBatch :: VerifyCache
+              -> PublicKey Ed25519
+              -- ^ Signers public key
+              -> ByteString
+              -- ^ Message
+              -> BatchProof
+              -- ^ Proof for the message
+              -> IO Bool
+verifyInBatch vc pk xs p = case proofRoot xs p of
+  Nothing   -> return False
+  Just root -> verifyCached vc pk (rootMessage (proofSize p) root) (proofSignature p)
+
+-- | Serialize a proof: the index and batch size as 32-bit little
+-- endian words, the signature, then the path.
+encodeProof :: BatchProof -> ByteString
+encodeProof (BatchProof i n path (Signature sig)) =
+  S.concat (word32 i : word32 n : sig : path)
+
+-- | Deserialize a proof. Returns @'Nothing'@ if the input is not
+-- exactly as long as a proof for its index and batch size.
+--
+-- >>> let proofs = signBatch sk ["a", "b", "c"]
+-- >>> map (decodeProof . encodeProof) proofs == map Just proofs
+-- True
+decodeProof :: ByteString -> Maybe BatchProof
+decodeProof xs
+  | S.length xs < 8 + sigBytes         = Nothing
+  | n < 1 || i >= n                    = Nothing
+  | S.length rest /= k * digestBytes   = Nothing
+  | otherwise = Just (BatchProof i n (chunks rest) (Signature sig))
+  where
+    i           = unword32 (S.take 4 xs)
+    n           = unword32 (S.take 4 (S.drop 4 xs))
+    (sig, rest) = S.splitAt sigBytes (S.drop 8 xs)
+    k           = pathLength i n
+    chunks ys
+      | S.null ys = []
+      | otherwise = S.take digestBytes ys : chunks (S.drop digestBytes ys)
+
+--------------------------------------------------------------------------------
+-- Trees
+
+-- The tree is built bottom up by hashing adjacent pairs of nodes; an
+-- odd node at the end of a level is carried up to the next level
+-- unchanged. Leaves and inner nodes are hashed with different
+-- prefixes, so one can never be passed off as the other.
+
+digestBytes :: Int
+digestBytes = 32
+
+sigBytes :: Int
+sigBytes = 64
+
+hash :: ByteString -> ByteString
+hash = S.take digestBytes . blake2b
+
+leafHash :: ByteString -> ByteString
+leafHash xs = hash (S.cons 0 xs)
+
+nodeHash :: ByteString -> ByteString -> ByteString
+nodeHash l r = hash (S.concat [S.singleton 1, l, r])
+
+-- The message actually signed: the batch size and the root.
+rootMessage :: Int -> ByteString -> ByteString
+rootMessage n root = S.concat [S.singleton 2, word32 n, root]
+
+packDigests :: [ByteString] -> DigestArray
+packDigests xs = fromMaybe (A.empty digestBytes) (A.fromList digestBytes xs)
+
+-- Every level of the tree, from the leaves up to the root.
+treeLevels :: DigestArray -> [DigestArray]
+treeLevels lvl
+  | A.length lvl <= 1 = [lvl]
+  | otherwise         = lvl : treeLevels (packDigests (pairs (A.toList lvl)))
+  where pairs (l:r:xs) = nodeHash l r : pairs xs
+        pairs xs       = xs
+
+-- The number of hashes in the path of leaf i out of n.
+pathLength :: Int -> Int -> Int
+pathLength i n
+  | n <= 1              = 0
+  | i `xor` 1 < n       = 1 + rest
+  | otherwise           = rest
+  where rest = pathLength (i `shiftR` 1) ((n + 1) `shiftR` 1)
+
+-- Recompute the root from a message and its proof.
+proofRoot :: ByteString -> BatchProof -> Maybe ByteString
+proofRoot xs (BatchProof i0 n0 path0 _)
+  | n0 < 1 || i0 < 0 || i0 >= n0 = Nothing
+  | otherwise                    = go i0 n0 (leafHash xs) path0
+  where
+    go _ 1 h []    = Just h
+    go _ 1 _ _     = Nothing
+    go i n h ps
+      | i `xor` 1 >= n = go (i `shiftR` 1) (up n) h ps
+    go i n h (p:ps)
+      | S.length p /= digestBytes = Nothing
+      | even i    = go (i `shiftR` 1) (up n) (nodeHash h p) ps
+      | otherwise = go (i `shiftR` 1) (up n) (nodeHash p h) ps
+    go _ _ _ []    = Nothing
+    up n = (n + 1) `shiftR` 1
+
+word32 :: Int -> ByteString
+word32 x = S.pack [ fromIntegral (x `shiftR` s) | s <- [0, 8, 16, 24] ]
+
+unword32 :: ByteString -> Int
+unword32 = S.foldr (\b acc -> (acc `shiftL` 8) .|. fromIntegral b) 0
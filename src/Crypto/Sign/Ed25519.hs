@@ -29,6 +29,8 @@ module Crypto.Sign.Ed25519
          -- * Keypair creation
          Ed25519
        , createKeypair       -- :: IO (PublicKey Ed25519, SecretKey Ed25519)
+       , createKeypairs      -- :: Int -> IO [(PublicKey Ed25519, SecretKey Ed25519)]
+       , createKeypairArrays -- :: Int -> IO (PublicKeyArray Ed25519, KeyArray Ed25519)
          -- * Signing and verifying messages
        , sign                -- :: SecretKey Ed25519 -> ByteString -> ByteString
        , verify              -- :: PublicKey Ed25519 -> ByteString -> Bool
@@ -36,10 +38,24 @@ module Crypto.Sign.Ed25519
        , Signature(..)       -- :: *
        , sign'               -- :: SecretKey Ed25519 -> ByteString -> Signature
        , verify'             -- :: PublicKey Ed25519 -> ByteString -> Signature -> Bool
+       , SignatureArray      -- :: *
+       , verifyMany          -- :: [(PublicKey Ed25519, ByteString, Signature)] -> [Bool]
+         -- * Prepared public keys
+         -- $prepared
+       , PreparedKey         -- :: *
+       , PreparedKeyArray    -- :: *
+       , prepareKey          -- :: PublicKey Ed25519 -> Maybe PreparedKey
+       , prepareKeys         -- :: PublicKeyArray Ed25519 -> (PreparedKeyArray, [Bool])
+       , indexPrepared       -- :: PreparedKeyArray -> Int -> Maybe PreparedKey
+       , preparedKeys        -- :: PreparedKeyArray -> [PreparedKey]
+       , verifyPrepared      -- :: PreparedKey -> ByteString -> Bool
+       , verifyPrepared'     -- :: PreparedKey -> ByteString -> Signature -> Bool
        ) where
 import           Foreign.C.Types
 import           Foreign.ForeignPtr       (withForeignPtr)
 import           Foreign.Marshal.Alloc    (alloca)
+import           Foreign.Marshal.Array    (allocaArray, peekArray, withArray)
+import           Foreign.Marshal.Utils    (withMany)
 import           Foreign.Ptr
 import           Foreign.Storable
 
@@ -50,7 +66,11 @@ import           Data.ByteString.Internal as SI
 import           Data.ByteString.Unsafe   as SU
 import           Data.Word
 
+import           Crypto.Internal.Parallel
 import           Crypto.Key
+import           Crypto.NaCl.Array        (Array, KeyArray, Packed (..),
+                                           PublicKeyArray)
+import qualified Crypto.NaCl.Array        as A
 
 -- $setup
 -- >>> import qualified Data.ByteString as B
@@ -83,6 +103,38 @@ createKeypair = do
   return (PublicKey $ SI.fromForeignPtr pk 0 cryptoSignPUBLICKEYBYTES,
           SecretKey $ SI.fromForeignPtr sk 0 cryptoSignSECRETKEYBYTES)
 
+-- | Randomly generate @n@ keypairs at once. This is considerably
+-- faster than calling @'createKeypair'@ @n@ times: all the entropy is
+-- read in one go, and the public key encodings share a single field
+-- inversion across each batch of keys.
+--
+-- >>> kps <- createKeypairs 16
+-- >>> and [ verify pk (sign sk xs) | (pk,sk) <- kps ]
+-- True
+createKeypairs :: Int -> IO [(PublicKey Ed25519, SecretKey Ed25519)]
+createKeypairs n = do
+  (pks, sks) <- createKeypairArrays n
+  return (zip (A.toList pks) (A.toList sks))
+
+-- | Like @'createKeypairs'@, but returns the keys packed into two
+-- arrays.
+createKeypairArrays :: Int -> IO (PublicKeyArray Ed25519, KeyArray Ed25519)
+createKeypairArrays n
+  | n <= 0    = return (A.empty cryptoSignPUBLICKEYBYTES, A.empty cryptoSignSECRETKEYBYTES)
+  | otherwise = do
+      pk <- SI.mallocByteString (n*cryptoSignPUBLICKEYBYTES)
+      sk <- SI.mallocByteString (n*cryptoSignSECRETKEYBYTES)
+
+      _ <- withForeignPtr pk $ \ppk ->
+        withForeignPtr sk $ \psk ->
+          c_crypto_sign_keypair_batch ppk psk (fromIntegral n)
+
+      let pks = A.fromForeignPtr cryptoSignPUBLICKEYBYTES pk 0 (n*cryptoSignPUBLICKEYBYTES)
+          sks = A.fromForeignPtr cryptoSignSECRETKEYBYTES sk 0 (n*cryptoSignSECRETKEYBYTES)
+      case (pks, sks) of
+        (Just p, Just s) -> return (p, s)
+        _                -> ioError (userError "createKeypairArrays: bad key size")
+
 --------------------------------------------------------------------------------
 -- Main API
 
@@ -129,7 +181,20 @@ verify (PublicKey pk) xs =
 
 -- | A @'Signature'@ which is detached from the message it signed.
 newtype Signature = Signature { unSignature :: ByteString }
-        deriving (Eq, Show, Ord)
+        deriving (Eq, Ord)
+
+instance Show Signature where
+  showsPrec _ (Signature xs) = showsHex xs
+
+instance Read Signature where
+  readsPrec _ xs = [ (Signature s, r) | (s, r) <- readsHex xs ]
+
+instance Packed Signature where
+  packRecord   = unSignature
+  unpackRecord = Signature
+
+-- | A packed array of detached signatures.
+type SignatureArray = Array Signature
 
 -- | Sign a message with a particular @'SecretKey'@, only returning
 -- the signature without the message.
@@ -154,9 +219,154 @@ verify' :: PublicKey Ed25519
         -> Signature
         -- ^ Message signature
         -> Bool
-verify' pk xs (Signature sig) = verify pk (sig `S.append` xs)
+verify' (PublicKey pk) xs (Signature sig)
+  | S.length sig /= cryptoSignBYTES = False
+  | otherwise = unsafePerformIO . SU.unsafeUseAsCStringLen xs $ \(mstr,mlen) ->
+      SU.unsafeUseAsCString sig $ \psig ->
+        SU.unsafeUseAsCString pk $ \ppk -> do
+          r <- c_crypto_sign_verify_detached psig mstr (fromIntegral mlen) ppk
+          return (r == 0)
 {-# INLINE verify' #-}
 
+-- | Verify many detached signatures, returning whether each one is
+-- valid, in order. This is the same as
+-- @'map' (\\(pk,m,sig) -> 'verify'' pk m sig)@, but the messages are
+-- never copied, and the work is split into chunks which run on every
+-- capability at once (with the threaded runtime).
+--
+-- >>> (pk,sk) <- createKeypair
+-- >>> verifyMany [(pk, xs, sign' sk xs), (pk, B.reverse xs, sign' sk xs)]
+-- [True,False]
+verifyMany :: [(PublicKey Ed25519, ByteString, Signature)]
+           -- ^ Public key, message and signature
+           -> [Bool]
+           -- ^ Verification checks
+verifyMany xs = unsafePerformIO $ parChunks 64 verifyBatch xs
+
+-- Verify one chunk with a single safe foreign call. Keys and
+-- signatures of the wrong size are replaced with ones that can never
+-- verify, so that every item keeps its slot.
+verifyBatch :: [(PublicKey Ed25519, ByteString, Signature)] -> IO [Bool]
+verifyBatch xs =
+  allocaArray n $ \pok ->
+    SU.unsafeUseAsCString (S.concat (Prelude.map sigOf xs)) $ \psigs ->
+      SU.unsafeUseAsCString (S.concat (Prelude.map keyOf xs)) $ \ppks ->
+        withMany SU.unsafeUseAsCString msgs $ \pms ->
+          withArray pms $ \pm ->
+            withArray (Prelude.map (fromIntegral . S.length) msgs) $ \plens -> do
+              c_crypto_sign_verify_many pok psigs pm plens ppks (fromIntegral n)
+              Prelude.map (/= 0) `fmap` peekArray n pok
+  where
+    n    = Prelude.length xs
+    msgs = [ m | (_, m, _) <- xs ]
+    keyOf (PublicKey pk, _, Signature sig)
+      | S.length pk == cryptoSignPUBLICKEYBYTES
+      , S.length sig == cryptoSignBYTES = pk
+      | otherwise = S.replicate cryptoSignPUBLICKEYBYTES 0
+    sigOf (PublicKey pk, _, Signature sig)
+      | S.length pk == cryptoSignPUBLICKEYBYTES
+      , S.length sig == cryptoSignBYTES = sig
+      | otherwise = S.replicate cryptoSignBYTES 0xff -- rejected by the S < 2^253 check
+
+--------------------------------------------------------------------------------
+-- Prepared public keys
+
+-- $prepared
+--
+-- Verifying a signature starts by decompressing the signer's public
+-- key, which costs about as much as a field inversion. When the same
+-- keys are used over and over (e.g. a directory of known signers),
+-- they can be decompressed and validated once, up front, with
+-- @'prepareKeys'@. This is also about twice as fast per key as the
+-- decompression in @'verify'@.
+
+-- | A public key which has been decompressed and validated, for use
+-- with @'verifyPrepared'@. Its contents are an implementation detail
+-- of this version of the library, and it can only be made with
+-- @'prepareKey'@ or @'prepareKeys'@.
+newtype PreparedKey = PreparedKey ByteString
+        deriving (Eq)
+
+-- | A packed array of prepared public keys. Unlike the other arrays,
+-- it has no @'Packed'@ instance, so it can't be built from arbitrary
+-- bytes.
+newtype PreparedKeyArray = PreparedKeyArray ByteString
+        deriving (Eq)
+
+-- | Prepare a single public key. Returns @'Nothing'@ if it is not a
+-- valid key.
+--
+-- >>> (pk,sk) <- createKeypair
+-- >>> fmap (\k -> verifyPrepared k (sign sk xs)) (prepareKey pk)
+-- Just True
+prepareKey :: PublicKey Ed25519 -> Maybe PreparedKey
+prepareKey pk = do
+  pks <- A.fromList cryptoSignPUBLICKEYBYTES [pk]
+  case prepareKeys pks of
+    (arr, [True]) -> indexPrepared arr 0
+    _             -> Nothing
+
+-- | Prepare many public keys with a single foreign call. Also
+-- returns, for every key, whether it was valid; an invalid key is
+-- still given a slot in the array, but nothing verifies against it.
+prepareKeys :: PublicKeyArray Ed25519 -> (PreparedKeyArray, [Bool])
+prepareKeys pks
+  | A.recordSize pks /= cryptoSignPUBLICKEYBYTES
+  = (PreparedKeyArray S.empty, Prelude.replicate n False)
+  | otherwise = unsafePerformIO $ do
+      ok <- SI.mallocByteString n
+      arr <- SI.create (cryptoSignPREPAREDBYTES * n) $ \pout ->
+        withForeignPtr ok $ \pok ->
+          A.withArrayPtr pks $ \ppk _ ->
+            c_crypto_sign_prepare_keys pout pok ppk (fromIntegral n) >> return ()
+      return (PreparedKeyArray arr, Prelude.map (/= 0) (S.unpack (SI.fromForeignPtr ok 0 n)))
+  where n = A.length pks
+
+-- | The prepared key at the given position, if there is one. O(1),
+-- and the result shares the array's buffer.
+indexPrepared :: PreparedKeyArray -> Int -> Maybe PreparedKey
+indexPrepared (PreparedKeyArray xs) i
+  | i < 0 || i >= S.length xs `quot` cryptoSignPREPAREDBYTES = Nothing
+  | otherwise = Just $ PreparedKey $
+      SU.unsafeTake cryptoSignPREPAREDBYTES (SU.unsafeDrop (i * cryptoSignPREPAREDBYTES) xs)
+
+-- | All of the prepared keys, in order.
+preparedKeys :: PreparedKeyArray -> [PreparedKey]
+preparedKeys arr@(PreparedKeyArray xs) =
+  [ k | i <- [0 .. S.length xs `quot` cryptoSignPREPAREDBYTES - 1]
+      , Just k <- [indexPrepared arr i] ]
+
+-- | Like @'verify'@, with a prepared public key.
+verifyPrepared :: PreparedKey
+               -- ^ Signers prepared key
+               -> ByteString
+               -- ^ Signed message
+               -> Bool
+               -- ^ Verification check
+verifyPrepared pk xs
+  | S.length xs < cryptoSignBYTES = False
+  | otherwise = verifyPrepared' pk (SU.unsafeDrop cryptoSignBYTES xs)
+                  (Signature (SU.unsafeTake cryptoSignBYTES xs))
+
+-- | Like @'verify''@, with a prepared public key. The message is
+-- never copied.
+verifyPrepared' :: PreparedKey
+                -- ^ Signers prepared key
+                -> ByteString
+                -- ^ Input message, without signature
+                -> Signature
+                -- ^ Message signature
+                -> Bool
+verifyPrepared' (PreparedKey pk) xs (Signature sig)
+  | S.length pk /= cryptoSignPREPAREDBYTES = False
+  | S.length sig /= cryptoSignBYTES = False
+  | otherwise = unsafePerformIO . SU.unsafeUseAsCStringLen xs $ \(mstr,mlen) ->
+      SU.unsafeUseAsCString sig $ \psig ->
+        SU.unsafeUseAsCString pk $ \ppk -> do
+          r <- c_crypto_sign_verify_detached_prepared psig mstr (fromIntegral mlen) ppk
+          return (r == 0)
+{-# INLINE verifyPrepared' #-}
+
 --
 -- FFI signature binding
 --
@@ -170,9 +380,15 @@ cryptoSignPUBLICKEYBYTES = 32
 cryptoSignBYTES :: Int
 cryptoSignBYTES = 64
 
+cryptoSignPREPAREDBYTES :: Int
+cryptoSignPREPAREDBYTES = 192
+
 foreign import ccall unsafe "ed25519_sign_keypair"
   c_crypto_sign_keypair :: Ptr Word8 -> Ptr Word8 -> IO CInt
 
+foreign import ccall unsafe "ed25519_sign_keypair_batch"
+  c_crypto_sign_keypair_batch :: Ptr Word8 -> Ptr Word8 -> CULLong -> IO CInt
+
 foreign import ccall unsafe "ed25519_sign"
   c_crypto_sign :: Ptr Word8 -> Ptr CULLong ->
                    Ptr CChar -> CULLong -> Ptr CChar -> IO CULLong
@@ -180,3 +396,19 @@ foreign import ccall unsafe "ed25519_sign"
 foreign import ccall unsafe "ed25519_sign_open"
   c_crypto_sign_open :: Ptr Word8 -> Ptr CULLong ->
                         Ptr CChar -> CULLong -> Ptr CChar -> IO CInt
+
+foreign import ccall unsafe "ed25519_verify_detached"
+  c_crypto_sign_verify_detached :: Ptr CChar -> Ptr CChar -> CULLong ->
+                                   Ptr CChar -> IO CInt
+
+foreign import ccall safe "ed25519_verify_many"
+  c_crypto_sign_verify_many :: Ptr Word8 -> Ptr CChar -> Ptr (Ptr CChar) ->
+                               Ptr CULLong -> Ptr CChar -> CULLong -> IO ()
+
+foreign import ccall unsafe "ed25519_prepare_keys"
+  c_crypto_sign_prepare_keys :: Ptr Word8 -> Ptr Word8 ->
+                                Ptr Word8 -> CULLong -> IO CULLong
+
+foreign import ccall unsafe "ed25519_verify_detached_prepared"
+  c_crypto_sign_verify_detached_prepared :: Ptr CChar -> Ptr CChar -> CULLong ->
+                                            Ptr CChar -> IO CInt
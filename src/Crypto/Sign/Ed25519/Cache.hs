@@ -0,0 +1,230 @@
+-- |
+-- Module      : Crypto.Sign.Ed25519.Cache
+-- Copyright   : (c) Austin Seipp 2013
+-- License     : BSD3
+--
+-- Maintainer  : aseipp@pobox.com
+-- Stability   : experimental
+-- Portability : portable
+--
+-- A bounded cache of successful ed25519 signature verifications.
+--
+-- Protocols which gossip signed messages tend to verify the same
+-- @(public key, message, signature)@ triple many times over. A
+-- @'VerifyCache'@ remembers the BLAKE2b digest of every triple which
+-- verified successfully, so repeated checks only cost a hash and a
+-- lookup instead of a double scalar multiplication. Failed
+-- verifications are never cached.
+--
+-- The cache is split into independently locked shards, each of which
+-- evicts its least recently used entry once it is full.
+--
+-- This module is intended to be imported @qualified@ to avoid name
+-- clashes with other cryptographic primitives, e.g.
+--
+-- > import qualified Crypto.Sign.Ed25519.Cache as Cache
+--
+module Crypto.Sign.Ed25519.Cache
+       ( -- * Creating caches
+         VerifyCache          -- :: *
+       , newVerifyCache       -- :: Int -> IO VerifyCache
+       , newVerifyCacheShards -- :: Int -> Int -> IO VerifyCache
+       , clearVerifyCache     -- :: VerifyCache -> IO ()
+
+         -- * Verification
+       , verifyCached         -- :: VerifyCache -> PublicKey Ed25519 -> ByteString -> Signature -> IO Bool
+
+         -- * Statistics
+       , CacheStats(..)       -- :: *
+       , cacheStats           -- :: VerifyCache -> IO CacheStats
+       , hitRate              -- :: CacheStats -> Double
+       ) where
+import           Control.Concurrent.MVar
+import           Control.Monad            (forM, forM_)
+import           Data.Bits                ((.|.), shiftL)
+import           Data.IORef
+import           Data.Word
+
+import           Data.Array               (Array, bounds, elems, listArray, (!))
+import           Data.Map                 (Map)
+import qualified Data.Map                 as M
+
+import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as S
+import qualified Data.ByteString.Unsafe   as SU
+
+import           Crypto.Hash.BLAKE2       (blake2b)
+import           Crypto.Key
+import           Crypto.Sign.Ed25519
+
+-- $setup
+-- >>> :set -XOverloadedStrings
+-- >>> (pk,sk) <- createKeypair
+
+-- | A bounded, concurrent cache of verified signatures.
+data VerifyCache = VerifyCache
+  { vcShards   :: Array Int (MVar Shard)
+  , vcCapacity :: !Int   -- ^ Per-shard capacity
+  , vcHits     :: IORef Word64
+  , vcMisses   :: IORef Word64
+  }
+
+-- A single shard: the digest of every cached triple mapped to the
+-- time it was last used, and the inverse mapping so the least
+-- recently used entry can be found quickly.
+data Shard = Shard
+  { shEntries :: !(Map ByteString Word64)
+  , shLRU     :: !(Map Word64 ByteString)
+  , shClock   :: !Word64
+  , shEvicted :: !Word64
+  }
+
+emptyShard :: Shard
+emptyShard = Shard M.empty M.empty 0 0
+
+-- | Snapshot of the counters of a @'VerifyCache'@.
+data CacheStats = CacheStats
+  { cacheHits      :: !Word64 -- ^ Lookups answered from the cache
+  , cacheMisses    :: !Word64 -- ^ Lookups that had to verify
+  , cacheEvictions :: !Word64 -- ^ Entries dropped to stay in bounds
+  , cacheSize      :: !Int    -- ^ Number of entries currently cached
+  } deriving (Eq, Show)
+
+-- | Create a cache holding at most (roughly) @n@ verified signatures,
+-- split over 16 shards.
+newVerifyCache :: Int -> IO VerifyCache
+newVerifyCache = newVerifyCacheShards 16
+
+-- | Create a cache holding at most (roughly) @n@ verified signatures,
+-- split over @s@ independently locked shards. More shards reduce
+-- contention between threads verifying at the same time.
+newVerifyCacheShards :: Int -- ^ Number of shards
+                     -> Int -- ^ Total capacity
+                     -> IO VerifyCache
+newVerifyCacheShards s n = do
+  let s' = max 1 s
+  shards <- forM [1..s'] $ \_ -> newMVar emptyShard
+  hits   <- newIORef 0
+  misses <- newIORef 0
+  return $! VerifyCache
+    { vcShards   = listArray (0, s'-1) shards
+    , vcCapacity = max 1 ((n + s' - 1) `div` s')
+    , vcHits     = hits
+    , vcMisses   = misses
+    }
+
+-- | Drop every cached entry. The statistics are left untouched.
+clearVerifyCache :: VerifyCache -> IO ()
+clearVerifyCache vc = forM_ (elems $ vcShards vc) $ \m ->
+  modifyMVar_ m $ \sh -> return $! emptyShard { shEvicted = shEvicted sh }
+
+-- | Verify a detached signature like @'verify''@, consulting the
+-- cache first. Only successful verifications are remembered.
+--
+-- >>> cache <- newVerifyCache 1024
+-- >>> let sig = sign' sk "Hello"
+-- >>> verifyCached cache pk "Hello" sig
+-- True
+-- >>> verifyCached cache pk "Hello" sig
+-- True
+-- >>> fmap cacheHits (cacheStats cache)
+-- 1
+verifyCached :: VerifyCache
+             -> PublicKey Ed25519
+             -- ^ Signers public key
+             -> ByteString
+             -- ^ Input message, without signature
+             -> Signature
+             -- ^ Message signature
+             -> IO Bool
+verifyCached vc pk@(PublicKey pkb) xs sig@(Signature sigb)
+  -- The key is a hash of the three fields back to back, which is only
+  -- unambiguous if the key and signature have their proper lengths.
+  -- Anything else can never verify, so it never touches the cache.
+  | S.length pkb /= publicKeyBYTES || S.length sigb /= signatureBYTES
+  = return (verify' pk xs sig)
+  | otherwise = do
+      let digest = blake2b (S.concat [pkb, sigb, xs])
+          shard  = vcShards vc ! shardIndex (vcShards vc) digest
+      hit <- modifyMVar shard $ \sh ->
+        case M.lookup digest (shEntries sh) of
+          Nothing -> return (sh, False)
+          Just t  -> return (touch digest t sh, True)
+      if hit
+        then bump (vcHits vc) >> return True
+        else do
+          bump (vcMisses vc)
+          let ok = verify' pk xs sig
+          if ok
+            then modifyMVar_ shard (return . insert (vcCapacity vc) digest)
+                 >> return True
+            else return False
+
+publicKeyBYTES :: Int
+publicKeyBYTES = 32
+
+signatureBYTES :: Int
+signatureBYTES = 64
+
+-- | Read the current counters of a @'VerifyCache'@.
+cacheStats :: VerifyCache -> IO CacheStats
+cacheStats vc = do
+  hits   <- readIORef (vcHits vc)
+  misses <- readIORef (vcMisses vc)
+  shards <- mapM readMVar (elems $ vcShards vc)
+  return $! CacheStats
+    { cacheHits      = hits
+    , cacheMisses    = misses
+    , cacheEvictions = sum (map shEvicted shards)
+    , cacheSize      = sum (map (M.size . shEntries) shards)
+    }
+
+-- | The fraction of lookups answered from the cache.
+hitRate :: CacheStats -> Double
+hitRate st
+  | total == 0 = 0
+  | otherwise  = fromIntegral (cacheHits st) / fromIntegral total
+  where total = cacheHits st + cacheMisses st
+
+--
+-- Utilities
+--
+
+-- Pick a shard from the first 8 bytes of the digest, so that keys
+-- stay evenly spread however many shards there are.
+shardIndex :: Array Int (MVar Shard) -> ByteString -> Int
+shardIndex arr digest = fromIntegral (w `mod` fromIntegral n)
+  where n = snd (bounds arr) + 1
+        w = S.foldl' (\acc b -> acc `shiftL` 8 .|. fromIntegral b) 0
+              (SU.unsafeTake 8 digest) :: Word64
+
+bump :: IORef Word64 -> IO ()
+bump r = atomicModifyIORef r $ \x -> let x' = x+1 in x' `seq` (x', ())
+
+-- Mark an entry as most recently used.
+touch :: ByteString -> Word64 -> Shard -> Shard
+touch digest t sh =
+  sh { shEntries = M.insert digest now (shEntries sh)
+     , shLRU     = M.insert now digest (M.delete t (shLRU sh))
+     , shClock   = now
+     }
+  where now = shClock sh + 1
+
+-- Add an entry, evicting the least recently used one if the shard
+-- is full.
+insert :: Int -> ByteString -> Shard -> Shard
+insert cap digest sh
+  | M.member digest (shEntries sh) = sh
+  | M.size (shEntries sh) < cap    = sh'
+  | otherwise = case M.minViewWithKey (shLRU sh') of
+      Nothing              -> sh'
+      Just ((_, old), lru) ->
+        sh' { shEntries = M.delete old (shEntries sh')
+            , shLRU     = lru
+            , shEvicted = shEvicted sh' + 1
+            }
+  where now = shClock sh + 1
+        sh' = sh { shEntries = M.insert digest now (shEntries sh)
+                 , shLRU     = M.insert now digest (shLRU sh)
+                 , shClock   = now
+                 }
@@ -3,6 +3,7 @@
 #include "crypto_uint64.h"
 #include "crypto_uint32.h"
 #include "crypto_uint8.h"
+#include "probes.h"
 
 #define CRYPTO_UINT8TO32(p)					\
   (((crypto_uint32)((p)[0]) << 24) | ((crypto_uint32)((p)[1]) << 16) |	\
@@ -181,8 +182,10 @@ static inline void blake256_final( state *S, crypto_uint8 *digest ) {
 
 int blake256( unsigned char *out, const unsigned char *in, unsigned long long inlen ) {
   state S;
+  NACL_PROBE_ENTRY(blake256,inlen);
   blake256_init( &S );
   blake256_update( &S, in, inlen*8 );
   blake256_final( &S, out );
+  NACL_PROBE_RETURN(blake256,inlen,0);
   return 0;
 }
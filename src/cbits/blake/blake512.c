@@ -3,6 +3,7 @@
 #include "crypto_uint64.h"
 #include "crypto_uint32.h"
 #include "crypto_uint8.h"
+#include "probes.h"
 
 #define CRYPTO_UINT8TO32(p) \
   (((crypto_uint32)((p)[0]) << 24) | ((crypto_uint32)((p)[1]) << 16) | \
@@ -196,8 +197,10 @@ static inline void blake512_final( state * S, crypto_uint8 * digest ) {
 
 int blake512( unsigned char *out, const unsigned char *in, unsigned long long inlen ) {
   state S;
+  NACL_PROBE_ENTRY(blake512,inlen);
   blake512_init( &S );
   blake512_update( &S, in, inlen*8 );
   blake512_final( &S, out );
+  NACL_PROBE_RETURN(blake512,inlen,0);
   return 0;
 }
@@ -143,6 +143,10 @@ extern "C" {
   int blake2sp( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen );
   int blake2bp( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen );
 
+  // Key derivation
+  int blake2b_kdf( uint8_t *out, const uint8_t outlen, const uint8_t *key, const uint8_t keylen,
+                   const uint8_t ctx[8], const uint64_t *ids, size_t n );
+
   static inline int blake2( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen )
   {
     return blake2b( out, in, key, outlen, inlen, keylen );
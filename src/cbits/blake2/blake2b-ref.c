@@ -17,6 +17,7 @@
 
 #include "blake2.h"
 #include "blake2-impl.h"
+#include "probes.h"
 
 static const uint64_t blake2b_IV[8] =
 {
@@ -333,7 +334,7 @@ int blake2b_final( blake2b_state *S, uint8_t *out, uint8_t outlen )
 }
 
 /* inlen, at least, should be uint64_t. Others can be size_t. */
-int blake2b( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen )
+static int blake2b_hash( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen )
 {
   blake2b_state S[1];
 
@@ -358,6 +359,95 @@ int blake2b( uint8_t *out, const void *in, const void *key, const uint8_t outlen
   return 0;
 }
 
+int blake2b( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen )
+{
+  int r;
+  NACL_PROBE_ENTRY(blake2b,inlen);
+  r = blake2b_hash( out, in, key, outlen, inlen, keylen );
+  NACL_PROBE_RETURN(blake2b,inlen,r);
+  return r;
+}
+
+/*
+   Key derivation: subkey i is
+
+     BLAKE2b( key = master, salt = LE64(ids[i]) || 0^8, personal = ctx || 0^8 )
+
+   of an empty message, as in libsodium's crypto_kdf_blake2b. With no
+   message the padded key block is both the first and the last block,
+   so once it and the parameter block have been set up, every subkey
+   costs exactly one compression. ctx is 8 bytes; the n subkeys of
+   outlen bytes each are written contiguously to out.
+*/
+static int kdf( uint8_t *out, const uint8_t outlen, const uint8_t *key, const uint8_t keylen,
+                const uint8_t ctx[8], const uint64_t *ids, size_t n )
+{
+  blake2b_param P[1];
+  blake2b_state S[1];
+  uint64_t h0[8];
+  uint8_t block[BLAKE2B_BLOCKBYTES];
+  uint8_t buffer[BLAKE2B_OUTBYTES];
+  uint8_t salt[8];
+
+  if ( ( !outlen ) || ( outlen > BLAKE2B_OUTBYTES ) ) return -1;
+
+  if ( !key || !keylen || keylen > BLAKE2B_KEYBYTES ) return -1;
+
+  P->digest_length = outlen;
+  P->key_length    = keylen;
+  P->fanout        = 1;
+  P->depth         = 1;
+  store32( &P->leaf_length, 0 );
+  store64( &P->node_offset, 0 );
+  P->node_depth    = 0;
+  P->inner_length  = 0;
+  memset( P->reserved, 0, sizeof( P->reserved ) );
+  memset( P->salt,     0, sizeof( P->salt ) );
+  memset( P->personal, 0, sizeof( P->personal ) );
+  memcpy( P->personal, ctx, 8 );
+
+  /* Everything but the salt is the same for every subkey */
+  blake2b_init_param( S, P );
+  memcpy( h0, S->h, sizeof( h0 ) );
+
+  memset( block, 0, BLAKE2B_BLOCKBYTES );
+  memcpy( block, key, keylen );
+
+  for( size_t i = 0; i < n; ++i )
+  {
+    memcpy( S->h, h0, sizeof( h0 ) );
+    /* salt[0..7] is the id, little endian; XOR it in as
+       blake2b_init_param does the rest of the parameter block */
+    store64( salt, ids[i] );
+    S->h[4] ^= load64( salt );
+    S->t[0] = BLAKE2B_BLOCKBYTES;
+    S->t[1] = 0;
+    S->f[0] = ~0ULL;
+    S->f[1] = 0;
+    blake2b_compress( S, block );
+
+    for( int j = 0; j < 8; ++j )
+      store64( buffer + sizeof( S->h[j] ) * j, S->h[j] );
+
+    memcpy( out + i * outlen, buffer, outlen );
+  }
+
+  secure_zero_memory( block, BLAKE2B_BLOCKBYTES );
+  secure_zero_memory( buffer, BLAKE2B_OUTBYTES );
+  secure_zero_memory( S, sizeof( S ) );
+  return 0;
+}
+
+int blake2b_kdf( uint8_t *out, const uint8_t outlen, const uint8_t *key, const uint8_t keylen,
+                 const uint8_t ctx[8], const uint64_t *ids, size_t n )
+{
+  int r;
+  NACL_PROBE_ENTRY(blake2b_kdf,n);
+  r = kdf( out, outlen, key, keylen, ctx, ids, n );
+  NACL_PROBE_RETURN(blake2b_kdf,n,r);
+  return r;
+}
+
 #if defined(BLAKE2B_SELFTEST)
 #include <string.h>
 #include "blake2-kat.h"
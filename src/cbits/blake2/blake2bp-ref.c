@@ -22,6 +22,7 @@
 
 #include "blake2.h"
 #include "blake2-impl.h"
+#include "probes.h"
 
 #define PARALLELISM_DEGREE 4
 
@@ -183,7 +184,7 @@ int blake2bp_final( blake2bp_state *S, uint8_t *out, const uint8_t outlen )
   return 0;
 }
 
-int blake2bp( uint8_t *out, const void *in, const void *key, uint8_t outlen, uint64_t inlen, uint8_t keylen )
+static int blake2bp_hash( uint8_t *out, const void *in, const void *key, uint8_t outlen, uint64_t inlen, uint8_t keylen )
 {
   uint8_t hash[PARALLELISM_DEGREE][BLAKE2B_OUTBYTES];
   blake2b_state S[PARALLELISM_DEGREE][1];
@@ -256,6 +257,15 @@ int blake2bp( uint8_t *out, const void *in, const void *key, uint8_t outlen, uin
   return 0;
 }
 
+int blake2bp( uint8_t *out, const void *in, const void *key, uint8_t outlen, uint64_t inlen, uint8_t keylen )
+{
+  int r;
+  NACL_PROBE_ENTRY(blake2bp,inlen);
+  r = blake2bp_hash( out, in, key, outlen, inlen, keylen );
+  NACL_PROBE_RETURN(blake2bp,inlen,r);
+  return r;
+}
+
 #if defined(BLAKE2BP_SELFTEST)
 #include <string.h>
 #include "blake2-kat.h"
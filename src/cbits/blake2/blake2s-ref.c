@@ -17,6 +17,7 @@
 
 #include "blake2.h"
 #include "blake2-impl.h"
+#include "probes.h"
 
 static const uint32_t blake2s_IV[8] =
 {
@@ -321,7 +322,7 @@ int blake2s_final( blake2s_state *S, uint8_t *out, uint8_t outlen )
   return 0;
 }
 
-int blake2s( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen )
+static int blake2s_hash( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen )
 {
   blake2s_state S[1];
 
@@ -346,6 +347,15 @@ int blake2s( uint8_t *out, const void *in, const void *key, const uint8_t outlen
   return 0;
 }
 
+int blake2s( uint8_t *out, const void *in, const void *key, const uint8_t outlen, const uint64_t inlen, uint8_t keylen )
+{
+  int r;
+  NACL_PROBE_ENTRY(blake2s,inlen);
+  r = blake2s_hash( out, in, key, outlen, inlen, keylen );
+  NACL_PROBE_RETURN(blake2s,inlen,r);
+  return r;
+}
+
 #if defined(BLAKE2S_SELFTEST)
 #include <string.h>
 #include "blake2-kat.h"
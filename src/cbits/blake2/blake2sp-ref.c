@@ -21,6 +21,7 @@
 
 #include "blake2.h"
 #include "blake2-impl.h"
+#include "probes.h"
 
 #define PARALLELISM_DEGREE 8
 
@@ -182,7 +183,7 @@ int blake2sp_final( blake2sp_state *S, uint8_t *out, const uint8_t outlen )
 }
 
 
-int blake2sp( uint8_t *out, const void *in, const void *key, uint8_t outlen, uint64_t inlen, uint8_t keylen )
+static int blake2sp_hash( uint8_t *out, const void *in, const void *key, uint8_t outlen, uint64_t inlen, uint8_t keylen )
 {
   uint8_t hash[PARALLELISM_DEGREE][BLAKE2S_OUTBYTES];
   blake2s_state S[PARALLELISM_DEGREE][1];
@@ -255,6 +256,15 @@ int blake2sp( uint8_t *out, const void *in, const void *key, uint8_t outlen, uin
   return 0;
 }
 
+int blake2sp( uint8_t *out, const void *in, const void *key, uint8_t outlen, uint64_t inlen, uint8_t keylen )
+{
+  int r;
+  NACL_PROBE_ENTRY(blake2sp,inlen);
+  r = blake2sp_hash( out, in, key, outlen, inlen, keylen );
+  NACL_PROBE_RETURN(blake2sp,inlen,r);
+  return r;
+}
+
 
 
 #if defined(BLAKE2SP_SELFTEST)
@@ -4,6 +4,7 @@
  * http://cr.yp.to/papers.html#chacha
  */
 #include <string.h>
+#include "probes.h"
 
 #ifndef CHACHA_RNDS
 #define CHACHA_RNDS 20    /* 8 (high speed), 20 (conservative), 12 (middle) */
@@ -119,7 +120,7 @@ typedef unsigned vec __attribute__ ((vector_size (16)));
 *(vec *)(op + d +  8) = REVV_BE(v2);    \
 *(vec *)(op + d + 12) = REVV_BE(v3);
 
-int crypto_stream_chacha20_xor(
+static int chacha20_xor(
         unsigned char *out,
         const unsigned char *in,
         unsigned long long inlen,
@@ -261,6 +262,21 @@ int crypto_stream_chacha20_xor(
     return 0;
 }
 
+int crypto_stream_chacha20_xor(
+        unsigned char *out,
+        const unsigned char *in,
+        unsigned long long inlen,
+        const unsigned char *n,
+        const unsigned char *k
+)
+{
+    int r;
+    NACL_PROBE_ENTRY(crypto_stream_chacha20_xor,inlen);
+    r = chacha20_xor(out,in,inlen,n,k);
+    NACL_PROBE_RETURN(crypto_stream_chacha20_xor,inlen,r);
+    return r;
+}
+
 int crypto_stream_chacha20(
                                   unsigned char *out,
                                   unsigned long long outlen,
@@ -268,6 +284,10 @@ int crypto_stream_chacha20(
                                   const unsigned char *k
                                   )
 {
+    int r;
+    NACL_PROBE_ENTRY(crypto_stream_chacha20,outlen);
     memset(out,0,outlen);
-    return crypto_stream_chacha20_xor(out,out,outlen,n,k);
+    r = chacha20_xor(out,out,outlen,n,k);
+    NACL_PROBE_RETURN(crypto_stream_chacha20,outlen,r);
+    return r;
 }
@@ -1,5 +1,6 @@
 #include "curve25519-donna.h"
 #include "randombytes.h"
+#include "probes.h"
 
 #if !defined(CURVE25519_SUFFIX)
 #define CURVE25519_SUFFIX 
@@ -21,7 +22,13 @@ CURVE25519_FN(curve25519_donna) (curve25519_key mypublic, const curve25519_key s
 	e[0] &= 0xf8;
 	e[31] &= 0x7f;
 	e[31] |= 0x40;
+#ifndef PRIVATE_API
+	NACL_PROBE_ENTRY(curve25519_donna,32);
+#endif
 	curve25519_scalarmult_donna(mypublic, e, basepoint);
+#ifndef PRIVATE_API
+	NACL_PROBE_RETURN(curve25519_donna,32,0);
+#endif
 }
 
 #ifdef PRIVATE_API
@@ -39,6 +46,12 @@ static
 void
 CURVE25519_FN(curve25519_donna_keypair) (curve25519_key mypublic, curve25519_key mysecret)
 {
+#ifndef PRIVATE_API
+  NACL_PROBE_ENTRY(curve25519_donna_keypair,32);
+#endif
   randombytes(mysecret, 32);
   curve25519_donna_basepoint(mypublic, mysecret);
+#ifndef PRIVATE_API
+  NACL_PROBE_RETURN(curve25519_donna_keypair,32,0);
+#endif
 }
@@ -1,5 +1,7 @@
 #include "curve25519xsalsa20poly1305.h"
 #include "randombytes.h"
+#include "probes.h"
+#include "../ed25519/ed25519.h"
 
 #define PRIVATE_API
 #include "../curve25519-donna/curve25519.c"
@@ -11,7 +13,9 @@ int curve25519xsalsa20poly1305_box_keypair(
   unsigned char *sk
 )
 {
+  NACL_PROBE_ENTRY(curve25519xsalsa20poly1305_box_keypair,32);
   curve25519_donna_keypair(pk, sk);
+  NACL_PROBE_RETURN(curve25519xsalsa20poly1305_box_keypair,32,0);
   return 0;
 }
 
@@ -24,8 +28,27 @@ int curve25519xsalsa20poly1305_box_beforenm(
 )
 {
   unsigned char s[32];
+  int r;
+  NACL_PROBE_ENTRY(curve25519xsalsa20poly1305_box_beforenm,32);
   curve25519_donna(s,sk,pk);
-  return crypto_core_hsalsa20(k,curve25519xsalsa20poly1305_n,s,sigma);
+  r = crypto_core_hsalsa20(k,curve25519xsalsa20poly1305_n,s,sigma);
+  NACL_PROBE_RETURN(curve25519xsalsa20poly1305_box_beforenm,32,r);
+  return r;
+}
+
+int curve25519xsalsa20poly1305_box_beforenm_prepared(
+  unsigned char *k,
+  const unsigned char *table,
+  const unsigned char *sk
+)
+{
+  unsigned char s[32];
+  int r;
+  NACL_PROBE_ENTRY(curve25519xsalsa20poly1305_box_beforenm_prepared,32);
+  curve25519_prepared(s,sk,table);
+  r = crypto_core_hsalsa20(k,curve25519xsalsa20poly1305_n,s,sigma);
+  NACL_PROBE_RETURN(curve25519xsalsa20poly1305_box_beforenm_prepared,32,r);
+  return r;
 }
 
 int curve25519xsalsa20poly1305_box_afternm(
@@ -35,7 +58,11 @@ int curve25519xsalsa20poly1305_box_afternm(
   const unsigned char *k
 )
 {
-  return xsalsa20poly1305_secretbox(c,m,mlen,n,k);
+  int r;
+  NACL_PROBE_ENTRY(curve25519xsalsa20poly1305_box_afternm,mlen);
+  r = xsalsa20poly1305_secretbox(c,m,mlen,n,k);
+  NACL_PROBE_RETURN(curve25519xsalsa20poly1305_box_afternm,mlen,r);
+  return r;
 }
 
 int curve25519xsalsa20poly1305_box_open_afternm(
@@ -45,7 +72,25 @@ int curve25519xsalsa20poly1305_box_open_afternm(
   const unsigned char *k
 )
 {
-  return xsalsa20poly1305_secretbox_open(m,c,clen,n,k);
+  int r;
+  NACL_PROBE_ENTRY(curve25519xsalsa20poly1305_box_open_afternm,clen);
+  r = xsalsa20poly1305_secretbox_open(m,c,clen,n,k);
+  NACL_PROBE_RETURN(curve25519xsalsa20poly1305_box_open_afternm,clen,r);
+  return r;
+}
+
+int curve25519xsalsa20poly1305_box_trial_open_afternm(
+  unsigned char *m,
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *ks,unsigned long long nks
+)
+{
+  int r;
+  NACL_PROBE_ENTRY(curve25519xsalsa20poly1305_box_trial_open_afternm,clen);
+  r = xsalsa20poly1305_trial_open(m,c,clen,n,ks,nks);
+  NACL_PROBE_RETURN(curve25519xsalsa20poly1305_box_trial_open_afternm,clen,r);
+  return r;
 }
 
 int curve25519xsalsa20poly1305_box(
@@ -57,8 +102,12 @@ int curve25519xsalsa20poly1305_box(
 )
 {
   unsigned char k[32];
+  int r;
+  NACL_PROBE_ENTRY(curve25519xsalsa20poly1305_box,mlen);
   curve25519xsalsa20poly1305_box_beforenm(k,pk,sk);
-  return curve25519xsalsa20poly1305_box_afternm(c,m,mlen,n,k);
+  r = curve25519xsalsa20poly1305_box_afternm(c,m,mlen,n,k);
+  NACL_PROBE_RETURN(curve25519xsalsa20poly1305_box,mlen,r);
+  return r;
 }
 
 int curve25519xsalsa20poly1305_box_open(
@@ -70,6 +119,10 @@ int curve25519xsalsa20poly1305_box_open(
 )
 {
   unsigned char k[32];
+  int r;
+  NACL_PROBE_ENTRY(curve25519xsalsa20poly1305_box_open,clen);
   curve25519xsalsa20poly1305_box_beforenm(k,pk,sk);
-  return curve25519xsalsa20poly1305_box_open_afternm(m,c,clen,n,k);
+  r = curve25519xsalsa20poly1305_box_open_afternm(m,c,clen,n,k);
+  NACL_PROBE_RETURN(curve25519xsalsa20poly1305_box_open,clen,r);
+  return r;
 }
@@ -24,6 +24,11 @@ int curve25519xsalsa20poly1305_box_beforenm(
   const unsigned char *pk,
   const unsigned char *sk);
 
+int curve25519xsalsa20poly1305_box_beforenm_prepared(
+  unsigned char *k,
+  const unsigned char *table,
+  const unsigned char *sk);
+
 int curve25519xsalsa20poly1305_box_afternm(
   unsigned char *c,
   const unsigned char *m,unsigned long long mlen,
@@ -36,4 +41,10 @@ int curve25519xsalsa20poly1305_box_open_afternm(
   const unsigned char *n,
   const unsigned char *k);
 
+int curve25519xsalsa20poly1305_box_trial_open_afternm(
+  unsigned char *m,
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *ks,unsigned long long nks);
+
 #endif /* _CURVE25519XSALSA20POLY1305_H_ */
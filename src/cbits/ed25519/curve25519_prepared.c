@@ -0,0 +1,80 @@
+#include "ed25519.h"
+#include "ge.h"
+#include "probes.h"
+
+/*
+Curve25519 against a fixed peer public key, at fixed-base speed.
+
+The Montgomery u-coordinate of the peer key is mapped to the
+birationally equivalent Edwards point (y = (u-1)/(u+1)), for which a
+table of multiples is precomputed once, in the same form as the base
+point table. Every later scalar multiplication is then a constant-time
+table walk followed by the map back to u = (1+y)/(1-y).
+
+Keys which have no such Edwards point (the point at infinity, u = -1,
+points on the twist, and encodings with the top bit set, which the
+ladder does not ignore) are rejected by curve25519_prepare, and the
+caller falls back to the ordinary Montgomery ladder for them.
+*/
+
+static int prepare_table(unsigned char *table,const unsigned char *pk)
+{
+  ge_p3 P;
+  fe tmp[256];
+  fe u;
+  fe one;
+  fe num;
+  fe den;
+  unsigned char s[32];
+
+  if (pk[31] & 128) return -1;
+
+  fe_frombytes(u,pk);
+  fe_1(one);
+  fe_sub(num,u,one);
+  fe_add(den,u,one);
+  if (!fe_isnonzero(den)) return -1;
+  fe_invert(den,den);
+  fe_mul(num,num,den);
+  fe_tobytes(s,num);
+
+  /* The sign of x is irrelevant, since u only depends on y */
+  if (ge_frombytes_negate_vartime(&P,s) != 0) return -1;
+
+  ge_precomp_table((ge_precomp (*)[8]) table,&P,tmp);
+  return 0;
+}
+
+int curve25519_prepare(unsigned char *table,const unsigned char *pk)
+{
+  int r;
+  NACL_PROBE_ENTRY(curve25519_prepare,32);
+  r = prepare_table(table,pk);
+  NACL_PROBE_RETURN(curve25519_prepare,32,r);
+  return r;
+}
+
+void curve25519_prepared(unsigned char *out,const unsigned char *sk,const unsigned char *table)
+{
+  ge_p3 h;
+  fe num;
+  fe den;
+  unsigned char e[32];
+  int i;
+
+  NACL_PROBE_ENTRY(curve25519_prepared,32);
+  for (i = 0;i < 32;++i) e[i] = sk[i];
+  e[0] &= 248;
+  e[31] &= 127;
+  e[31] |= 64;
+
+  ge_scalarmult_table(&h,e,(const ge_precomp (*)[8]) table);
+
+  /* u = (Z+Y)/(Z-Y); the identity maps to 0, as in the ladder */
+  fe_add(num,h.Z,h.Y);
+  fe_sub(den,h.Z,h.Y);
+  fe_invert(den,den);
+  fe_mul(num,num,den);
+  fe_tobytes(out,num);
+  NACL_PROBE_RETURN(curve25519_prepared,32,0);
+}
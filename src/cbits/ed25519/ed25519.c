@@ -26,6 +26,7 @@
 #include "fe_neg.c"
 #include "ge_frombytes.c"
 #include "ge_p3_tobytes.c"
+#include "ge_p3_batch_tobytes.c"
 #include "ge_double_scalarmult.c"
 #include "ge_p1p1_to_p2.c"
 #include "fe_sq.c"
@@ -39,3 +40,10 @@
 #include "ge_madd.c"
 #include "ge_p2_dbl.c"
 #include "crypto_verify.c"
+#include "ge_precomp_table.c"
+#include "curve25519_prepared.c"
+#include "fe51.c"
+#include "fe4.c"
+#include "ge_frombytes_batch.c"
+#include "prepare.c"
+#include "verify.c"
@@ -9,11 +9,39 @@
 #define crypto_sign_VERSION crypto_sign_ed25519_VERSION
 
 int ed25519_sign_keypair(unsigned char *pk,unsigned char *sk);
+int ed25519_sign_keypair_batch(unsigned char *pk,unsigned char *sk,
+                               unsigned long long n);
 int ed25519_sign(unsigned char *sm,unsigned long long *smlen,
                  const unsigned char *m,unsigned long long mlen,
                  const unsigned char *sk);
 int ed25519_sign_open(unsigned char *m,unsigned long long *mlen,
                       const unsigned char *sm,unsigned long long smlen,
                       const unsigned char *pk);
+int ed25519_verify_detached(const unsigned char *sig,
+                            const unsigned char *m,unsigned long long mlen,
+                            const unsigned char *pk);
+void ed25519_verify_many(unsigned char *ok,const unsigned char *sigs,
+                         const unsigned char * const *m,
+                         const unsigned long long *mlens,
+                         const unsigned char *pks,unsigned long long n);
+
+#define crypto_sign_PREPAREDBYTES 192
+
+unsigned long long ed25519_prepare_keys(unsigned char *out,unsigned char *ok,
+                                        const unsigned char *pk,
+                                        unsigned long long n);
+int ed25519_sign_open_prepared(unsigned char *m,unsigned long long *mlen,
+                               const unsigned char *sm,unsigned long long smlen,
+                               const unsigned char *prepared);
+int ed25519_verify_detached_prepared(const unsigned char *sig,
+                                     const unsigned char *m,
+                                     unsigned long long mlen,
+                                     const unsigned char *prepared);
+
+#define curve25519_PREPAREDBYTES 30720
+
+int curve25519_prepare(unsigned char *table,const unsigned char *pk);
+void curve25519_prepared(unsigned char *out,const unsigned char *sk,
+                         const unsigned char *table);
 
 #endif /* _ED25519_H_ */
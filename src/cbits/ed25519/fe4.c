@@ -0,0 +1,283 @@
+#include "fe4.h"
+
+#ifdef HAVE_FE4
+
+#include <immintrin.h>
+
+/*
+Load limb i of four fe into the low halves of four 64-bit lanes,
+sign extended, with two 4x4 transposes and one 4x2.
+*/
+
+static inline void fe4_load(__m256i v[10],const fe a,const fe b,const fe c,const fe d)
+{
+  int i;
+  for (i = 0;i < 8;i += 4) {
+    __m128i a0 = _mm_loadu_si128((const __m128i *) (a + i));
+    __m128i b0 = _mm_loadu_si128((const __m128i *) (b + i));
+    __m128i c0 = _mm_loadu_si128((const __m128i *) (c + i));
+    __m128i d0 = _mm_loadu_si128((const __m128i *) (d + i));
+    __m128i ab01 = _mm_unpacklo_epi32(a0,b0);
+    __m128i cd01 = _mm_unpacklo_epi32(c0,d0);
+    __m128i ab23 = _mm_unpackhi_epi32(a0,b0);
+    __m128i cd23 = _mm_unpackhi_epi32(c0,d0);
+    v[i + 0] = _mm256_cvtepi32_epi64(_mm_unpacklo_epi64(ab01,cd01));
+    v[i + 1] = _mm256_cvtepi32_epi64(_mm_unpackhi_epi64(ab01,cd01));
+    v[i + 2] = _mm256_cvtepi32_epi64(_mm_unpacklo_epi64(ab23,cd23));
+    v[i + 3] = _mm256_cvtepi32_epi64(_mm_unpackhi_epi64(ab23,cd23));
+  }
+  {
+    __m128i a8 = _mm_loadl_epi64((const __m128i *) (a + 8));
+    __m128i b8 = _mm_loadl_epi64((const __m128i *) (b + 8));
+    __m128i c8 = _mm_loadl_epi64((const __m128i *) (c + 8));
+    __m128i d8 = _mm_loadl_epi64((const __m128i *) (d + 8));
+    __m128i ab = _mm_unpacklo_epi32(a8,b8);
+    __m128i cd = _mm_unpacklo_epi32(c8,d8);
+    v[8] = _mm256_cvtepi32_epi64(_mm_unpacklo_epi64(ab,cd));
+    v[9] = _mm256_cvtepi32_epi64(_mm_unpackhi_epi64(ab,cd));
+  }
+}
+
+/*
+The inverse of fe4_load, once every lane fits in 32 bits.
+*/
+
+static inline void fe4_store(fe a,fe b,fe c,fe d,const __m256i v[10])
+{
+  const __m256i lo = _mm256_setr_epi32(0,2,4,6,1,3,5,7);
+  __m128i w[10];
+  int i;
+
+  for (i = 0;i < 10;++i)
+    w[i] = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v[i],lo));
+
+  for (i = 0;i < 8;i += 4) {
+    __m128i ab01 = _mm_unpacklo_epi32(w[i + 0],w[i + 1]);
+    __m128i cd01 = _mm_unpackhi_epi32(w[i + 0],w[i + 1]);
+    __m128i ab23 = _mm_unpacklo_epi32(w[i + 2],w[i + 3]);
+    __m128i cd23 = _mm_unpackhi_epi32(w[i + 2],w[i + 3]);
+    _mm_storeu_si128((__m128i *) (a + i),_mm_unpacklo_epi64(ab01,ab23));
+    _mm_storeu_si128((__m128i *) (b + i),_mm_unpackhi_epi64(ab01,ab23));
+    _mm_storeu_si128((__m128i *) (c + i),_mm_unpacklo_epi64(cd01,cd23));
+    _mm_storeu_si128((__m128i *) (d + i),_mm_unpackhi_epi64(cd01,cd23));
+  }
+  {
+    __m128i ab = _mm_unpacklo_epi32(w[8],w[9]);
+    __m128i cd = _mm_unpackhi_epi32(w[8],w[9]);
+    _mm_storel_epi64((__m128i *) (a + 8),ab);
+    _mm_storel_epi64((__m128i *) (b + 8),_mm_srli_si128(ab,8));
+    _mm_storel_epi64((__m128i *) (c + 8),cd);
+    _mm_storel_epi64((__m128i *) (d + 8),_mm_srli_si128(cd,8));
+  }
+}
+
+/*
+carry = (h + 2^(s-1)) >> s, as in fe_mul. AVX2 has no 64-bit
+arithmetic shift, so h is biased by 2^62 and shifted logically
+instead; |h| < 2^61 here, even when doubled.
+*/
+
+#define FE4_CARRY(h,hnext,s) do { \
+  __m256i c = _mm256_sub_epi64( \
+    _mm256_srli_epi64(_mm256_add_epi64(h,_mm256_set1_epi64x((1LL << 62) + (1LL << ((s) - 1)))),s), \
+    _mm256_set1_epi64x(1LL << (62 - (s)))); \
+  hnext = _mm256_add_epi64(hnext,c); \
+  h = _mm256_sub_epi64(h,_mm256_slli_epi64(c,s)); \
+} while (0)
+
+#define FE4_CARRY19(h,hnext,s) do { \
+  __m256i c = _mm256_sub_epi64( \
+    _mm256_srli_epi64(_mm256_add_epi64(h,_mm256_set1_epi64x((1LL << 62) + (1LL << ((s) - 1)))),s), \
+    _mm256_set1_epi64x(1LL << (62 - (s)))); \
+  hnext = _mm256_add_epi64(hnext,_mm256_add_epi64( \
+    _mm256_add_epi64(_mm256_slli_epi64(c,4),_mm256_slli_epi64(c,1)),c)); \
+  h = _mm256_sub_epi64(h,_mm256_slli_epi64(c,s)); \
+} while (0)
+
+#define MUL(a,b) _mm256_mul_epi32(a,b)
+#define ADD(a,b) _mm256_add_epi64(a,b)
+
+/*
+Carry h as at the end of fe_mul, after doubling the lanes which
+are set in shift (for fe_sq2).
+*/
+
+static inline void fe4_carry(__m256i h[10],
+                             __m256i h0,__m256i h1,__m256i h2,__m256i h3,__m256i h4,
+                             __m256i h5,__m256i h6,__m256i h7,__m256i h8,__m256i h9,
+                             __m256i shift)
+{
+  h0 = _mm256_sllv_epi64(h0,shift); h1 = _mm256_sllv_epi64(h1,shift);
+  h2 = _mm256_sllv_epi64(h2,shift); h3 = _mm256_sllv_epi64(h3,shift);
+  h4 = _mm256_sllv_epi64(h4,shift); h5 = _mm256_sllv_epi64(h5,shift);
+  h6 = _mm256_sllv_epi64(h6,shift); h7 = _mm256_sllv_epi64(h7,shift);
+  h8 = _mm256_sllv_epi64(h8,shift); h9 = _mm256_sllv_epi64(h9,shift);
+
+  FE4_CARRY(h0,h1,26); FE4_CARRY(h4,h5,26);
+  FE4_CARRY(h1,h2,25); FE4_CARRY(h5,h6,25);
+  FE4_CARRY(h2,h3,26); FE4_CARRY(h6,h7,26);
+  FE4_CARRY(h3,h4,25); FE4_CARRY(h7,h8,25);
+  FE4_CARRY(h4,h5,26); FE4_CARRY(h8,h9,26);
+  FE4_CARRY19(h9,h0,25);
+  FE4_CARRY(h0,h1,26);
+
+  h[0] = h0; h[1] = h1; h[2] = h2; h[3] = h3; h[4] = h4;
+  h[5] = h5; h[6] = h6; h[7] = h7; h[8] = h8; h[9] = h9;
+}
+
+/*
+Schoolbook product of the lanes of f and g, term for term as in
+fe_mul.
+*/
+
+static inline void fe4_mul(__m256i h[10],const __m256i f[10],const __m256i g[10])
+{
+  const __m256i nineteen = _mm256_set1_epi64x(19);
+  __m256i f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  __m256i f5 = f[5], f6 = f[6], f7 = f[7], f8 = f[8], f9 = f[9];
+  __m256i g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+  __m256i g5 = g[5], g6 = g[6], g7 = g[7], g8 = g[8], g9 = g[9];
+  __m256i f1_2 = ADD(f1,f1), f3_2 = ADD(f3,f3), f5_2 = ADD(f5,f5);
+  __m256i f7_2 = ADD(f7,f7), f9_2 = ADD(f9,f9);
+  __m256i g1_19 = MUL(g1,nineteen), g2_19 = MUL(g2,nineteen), g3_19 = MUL(g3,nineteen);
+  __m256i g4_19 = MUL(g4,nineteen), g5_19 = MUL(g5,nineteen), g6_19 = MUL(g6,nineteen);
+  __m256i g7_19 = MUL(g7,nineteen), g8_19 = MUL(g8,nineteen), g9_19 = MUL(g9,nineteen);
+  __m256i h0, h1, h2, h3, h4, h5, h6, h7, h8, h9;
+
+  h0 = MUL(f0,g0);
+  h0 = ADD(h0,ADD(MUL(f1_2,g9_19),ADD(MUL(f2,g8_19),MUL(f3_2,g7_19))));
+  h0 = ADD(h0,ADD(MUL(f4,g6_19),ADD(MUL(f5_2,g5_19),MUL(f6,g4_19))));
+  h0 = ADD(h0,ADD(MUL(f7_2,g3_19),ADD(MUL(f8,g2_19),MUL(f9_2,g1_19))));
+  h1 = MUL(f0,g1);
+  h1 = ADD(h1,ADD(MUL(f1,g0),ADD(MUL(f2,g9_19),MUL(f3,g8_19))));
+  h1 = ADD(h1,ADD(MUL(f4,g7_19),ADD(MUL(f5,g6_19),MUL(f6,g5_19))));
+  h1 = ADD(h1,ADD(MUL(f7,g4_19),ADD(MUL(f8,g3_19),MUL(f9,g2_19))));
+  h2 = MUL(f0,g2);
+  h2 = ADD(h2,ADD(MUL(f1_2,g1),ADD(MUL(f2,g0),MUL(f3_2,g9_19))));
+  h2 = ADD(h2,ADD(MUL(f4,g8_19),ADD(MUL(f5_2,g7_19),MUL(f6,g6_19))));
+  h2 = ADD(h2,ADD(MUL(f7_2,g5_19),ADD(MUL(f8,g4_19),MUL(f9_2,g3_19))));
+  h3 = MUL(f0,g3);
+  h3 = ADD(h3,ADD(MUL(f1,g2),ADD(MUL(f2,g1),MUL(f3,g0))));
+  h3 = ADD(h3,ADD(MUL(f4,g9_19),ADD(MUL(f5,g8_19),MUL(f6,g7_19))));
+  h3 = ADD(h3,ADD(MUL(f7,g6_19),ADD(MUL(f8,g5_19),MUL(f9,g4_19))));
+  h4 = MUL(f0,g4);
+  h4 = ADD(h4,ADD(MUL(f1_2,g3),ADD(MUL(f2,g2),MUL(f3_2,g1))));
+  h4 = ADD(h4,ADD(MUL(f4,g0),ADD(MUL(f5_2,g9_19),MUL(f6,g8_19))));
+  h4 = ADD(h4,ADD(MUL(f7_2,g7_19),ADD(MUL(f8,g6_19),MUL(f9_2,g5_19))));
+  h5 = MUL(f0,g5);
+  h5 = ADD(h5,ADD(MUL(f1,g4),ADD(MUL(f2,g3),MUL(f3,g2))));
+  h5 = ADD(h5,ADD(MUL(f4,g1),ADD(MUL(f5,g0),MUL(f6,g9_19))));
+  h5 = ADD(h5,ADD(MUL(f7,g8_19),ADD(MUL(f8,g7_19),MUL(f9,g6_19))));
+  h6 = MUL(f0,g6);
+  h6 = ADD(h6,ADD(MUL(f1_2,g5),ADD(MUL(f2,g4),MUL(f3_2,g3))));
+  h6 = ADD(h6,ADD(MUL(f4,g2),ADD(MUL(f5_2,g1),MUL(f6,g0))));
+  h6 = ADD(h6,ADD(MUL(f7_2,g9_19),ADD(MUL(f8,g8_19),MUL(f9_2,g7_19))));
+  h7 = MUL(f0,g7);
+  h7 = ADD(h7,ADD(MUL(f1,g6),ADD(MUL(f2,g5),MUL(f3,g4))));
+  h7 = ADD(h7,ADD(MUL(f4,g3),ADD(MUL(f5,g2),MUL(f6,g1))));
+  h7 = ADD(h7,ADD(MUL(f7,g0),ADD(MUL(f8,g9_19),MUL(f9,g8_19))));
+  h8 = MUL(f0,g8);
+  h8 = ADD(h8,ADD(MUL(f1_2,g7),ADD(MUL(f2,g6),MUL(f3_2,g5))));
+  h8 = ADD(h8,ADD(MUL(f4,g4),ADD(MUL(f5_2,g3),MUL(f6,g2))));
+  h8 = ADD(h8,ADD(MUL(f7_2,g1),ADD(MUL(f8,g0),MUL(f9_2,g9_19))));
+  h9 = MUL(f0,g9);
+  h9 = ADD(h9,ADD(MUL(f1,g8),ADD(MUL(f2,g7),MUL(f3,g6))));
+  h9 = ADD(h9,ADD(MUL(f4,g5),ADD(MUL(f5,g4),MUL(f6,g3))));
+  h9 = ADD(h9,ADD(MUL(f7,g2),ADD(MUL(f8,g1),MUL(f9,g0))));
+
+  fe4_carry(h,h0,h1,h2,h3,h4,h5,h6,h7,h8,h9,_mm256_setzero_si256());
+}
+
+/*
+Square the lanes of f, with the products of fe_sq.
+*/
+
+static inline void fe4_sq(__m256i h[10],const __m256i f[10],__m256i shift)
+{
+  const __m256i nineteen = _mm256_set1_epi64x(19);
+  __m256i f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  __m256i f5 = f[5], f6 = f[6], f7 = f[7], f8 = f[8], f9 = f[9];
+  __m256i f0_2 = ADD(f0,f0), f1_2 = ADD(f1,f1), f2_2 = ADD(f2,f2);
+  __m256i f3_2 = ADD(f3,f3), f4_2 = ADD(f4,f4), f5_2 = ADD(f5,f5);
+  __m256i f6_2 = ADD(f6,f6), f7_2 = ADD(f7,f7), f8_2 = ADD(f8,f8);
+  __m256i f6_19 = MUL(f6,nineteen), f7_19 = MUL(f7,nineteen);
+  __m256i f8_19 = MUL(f8,nineteen), f9_19 = MUL(f9,nineteen);
+  __m256i f5_38 = MUL(f5_2,nineteen), f7_38 = ADD(f7_19,f7_19), f9_38 = ADD(f9_19,f9_19);
+  __m256i h0, h1, h2, h3, h4, h5, h6, h7, h8, h9;
+
+  h0 = MUL(f0,f0);
+  h0 = ADD(h0,ADD(MUL(f1_2,f9_38),ADD(MUL(f2_2,f8_19),MUL(f3_2,f7_38))));
+  h0 = ADD(h0,ADD(MUL(f4_2,f6_19),MUL(f5,f5_38)));
+  h1 = MUL(f0_2,f1);
+  h1 = ADD(h1,ADD(MUL(f2_2,f9_19),ADD(MUL(f3_2,f8_19),MUL(f4_2,f7_19))));
+  h1 = ADD(h1,MUL(f5_2,f6_19));
+  h2 = MUL(f0_2,f2);
+  h2 = ADD(h2,ADD(MUL(f1,f1_2),ADD(MUL(f3_2,f9_38),MUL(f4_2,f8_19))));
+  h2 = ADD(h2,ADD(MUL(f5_2,f7_38),MUL(f6,f6_19)));
+  h3 = MUL(f0_2,f3);
+  h3 = ADD(h3,ADD(MUL(f1_2,f2),ADD(MUL(f4_2,f9_19),MUL(f5_2,f8_19))));
+  h3 = ADD(h3,MUL(f6_2,f7_19));
+  h4 = MUL(f0_2,f4);
+  h4 = ADD(h4,ADD(MUL(f1_2,f3_2),ADD(MUL(f2,f2),MUL(f5_2,f9_38))));
+  h4 = ADD(h4,ADD(MUL(f6_2,f8_19),MUL(f7,f7_38)));
+  h5 = MUL(f0_2,f5);
+  h5 = ADD(h5,ADD(MUL(f1_2,f4),ADD(MUL(f2_2,f3),MUL(f6_2,f9_19))));
+  h5 = ADD(h5,MUL(f7_2,f8_19));
+  h6 = MUL(f0_2,f6);
+  h6 = ADD(h6,ADD(MUL(f1_2,f5_2),ADD(MUL(f2_2,f4),MUL(f3,f3_2))));
+  h6 = ADD(h6,ADD(MUL(f7_2,f9_38),MUL(f8,f8_19)));
+  h7 = MUL(f0_2,f7);
+  h7 = ADD(h7,ADD(MUL(f1_2,f6),ADD(MUL(f2_2,f5),MUL(f3_2,f4))));
+  h7 = ADD(h7,MUL(f8_2,f9_19));
+  h8 = MUL(f0_2,f8);
+  h8 = ADD(h8,ADD(MUL(f1_2,f7_2),ADD(MUL(f2_2,f6),MUL(f3_2,f5_2))));
+  h8 = ADD(h8,ADD(MUL(f4,f4),MUL(f9,f9_38)));
+  h9 = MUL(f0_2,f9);
+  h9 = ADD(h9,ADD(MUL(f1_2,f8),ADD(MUL(f2_2,f7),MUL(f3_2,f6))));
+  h9 = ADD(h9,MUL(f4_2,f5));
+
+  fe4_carry(h,h0,h1,h2,h3,h4,h5,h6,h7,h8,h9,shift);
+}
+
+#undef MUL
+#undef ADD
+
+/*
+ha = fa * ga, hb = fb * gb, and so on.
+Any h can overlap any f or g.
+Same bounds as fe_mul.
+*/
+
+static inline void fe_mul4(fe ha,const fe fa,const fe ga,fe hb,const fe fb,const fe gb,
+                           fe hc,const fe fc,const fe gc,fe hd,const fe fd,const fe gd)
+{
+  __m256i f[10], g[10], h[10];
+  fe4_load(f,fa,fb,fc,fd);
+  fe4_load(g,ga,gb,gc,gd);
+  fe4_mul(h,f,g);
+  fe4_store(ha,hb,hc,hd,h);
+}
+
+static inline void fe_mul3(fe ha,const fe fa,const fe ga,fe hb,const fe fb,const fe gb,
+                           fe hc,const fe fc,const fe gc)
+{
+  fe unused;
+  fe_mul4(ha,fa,ga,hb,fb,gb,hc,fc,gc,unused,fc,gc);
+}
+
+/*
+ha = fa^2, ..., hd = fd^2, except that lane k (a = 0 ... d = 3) is
+doubled, as by fe_sq2, if bit k of dbl is set.
+*/
+
+static inline void fe_sq4(fe ha,const fe fa,fe hb,const fe fb,
+                          fe hc,const fe fc,fe hd,const fe fd,int dbl)
+{
+  __m256i f[10], h[10];
+  __m256i shift = _mm256_setr_epi64x(dbl & 1,(dbl >> 1) & 1,(dbl >> 2) & 1,(dbl >> 3) & 1);
+  fe4_load(f,fa,fb,fc,fd);
+  fe4_sq(h,f,shift);
+  fe4_store(ha,hb,hc,hd,h);
+}
+
+#endif /* HAVE_FE4 */
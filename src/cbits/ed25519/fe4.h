@@ -0,0 +1,33 @@
+#ifndef FE4_H
+#define FE4_H
+
+/*
+fe_mul4 computes four independent fe_mul products at once, one per
+64-bit lane of AVX2 vectors: limb i of all four operands lives in
+one vector, so each of the 100 limb products is a single vpmuldq
+for all four. Inputs and outputs are ordinary fe, with the same
+bounds as fe_mul; only the arithmetic in between is vectorized.
+
+The ge_* formulas are written so that their multiplications come in
+groups of four (or three) independent ones; see ge_add.c et al.
+Like fe_mul, it has no secret-dependent branches or memory accesses.
+*/
+
+#if defined(__AVX2__)
+#define HAVE_FE4
+
+#include "fe.h"
+
+#define fe_mul4 crypto_sign_ed25519_ref10_fe_mul4
+#define fe_mul3 crypto_sign_ed25519_ref10_fe_mul3
+#define fe_sq4 crypto_sign_ed25519_ref10_fe_sq4
+
+static inline void fe_mul4(fe,const fe,const fe,fe,const fe,const fe,
+                           fe,const fe,const fe,fe,const fe,const fe);
+static inline void fe_mul3(fe,const fe,const fe,fe,const fe,const fe,
+                           fe,const fe,const fe);
+static inline void fe_sq4(fe,const fe,fe,const fe,fe,const fe,fe,const fe,int);
+
+#endif /* __AVX2__ */
+
+#endif
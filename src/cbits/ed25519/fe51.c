@@ -0,0 +1,227 @@
+#include "fe51.h"
+
+#ifdef HAVE_FE51
+
+typedef unsigned __int128 fe51_uint128;
+
+#define FE51_MASK ((((crypto_uint64) 1) << 51) - 1)
+
+static inline crypto_uint64 fe51_load_8(const unsigned char *in)
+{
+  crypto_uint64 result = 0;
+  int i;
+  for (i = 7;i >= 0;--i) result = (result << 8) | in[i];
+  return result;
+}
+
+static inline void fe51_store_8(unsigned char *out,crypto_uint64 u)
+{
+  int i;
+  for (i = 0;i < 8;++i) { out[i] = u; u >>= 8; }
+}
+
+/*
+Ignores top bit of s, like fe_frombytes.
+*/
+
+static inline void fe51_frombytes(fe51 h,const unsigned char *s)
+{
+  h[0] = fe51_load_8(s) & FE51_MASK;
+  h[1] = (fe51_load_8(s + 6) >> 3) & FE51_MASK;
+  h[2] = (fe51_load_8(s + 12) >> 6) & FE51_MASK;
+  h[3] = (fe51_load_8(s + 19) >> 1) & FE51_MASK;
+  h[4] = (fe51_load_8(s + 24) >> 12) & FE51_MASK;
+}
+
+/*
+Canonical encoding: h is reduced mod 2^255-19 first, as in
+fe_tobytes.
+*/
+
+static inline void fe51_tobytes(unsigned char *s,const fe51 h)
+{
+  crypto_uint64 t0 = h[0], t1 = h[1], t2 = h[2], t3 = h[3], t4 = h[4];
+  crypto_uint64 q;
+  int i;
+
+  for (i = 0;i < 2;++i) {
+    t1 += t0 >> 51; t0 &= FE51_MASK;
+    t2 += t1 >> 51; t1 &= FE51_MASK;
+    t3 += t2 >> 51; t2 &= FE51_MASK;
+    t4 += t3 >> 51; t3 &= FE51_MASK;
+    t0 += 19 * (t4 >> 51); t4 &= FE51_MASK;
+  }
+
+  /* q = 1 if t >= 2^255-19, else 0 */
+  q = (t0 + 19) >> 51;
+  q = (t1 + q) >> 51;
+  q = (t2 + q) >> 51;
+  q = (t3 + q) >> 51;
+  q = (t4 + q) >> 51;
+
+  t0 += 19 * q;
+  t1 += t0 >> 51; t0 &= FE51_MASK;
+  t2 += t1 >> 51; t1 &= FE51_MASK;
+  t3 += t2 >> 51; t2 &= FE51_MASK;
+  t4 += t3 >> 51; t3 &= FE51_MASK;
+  t4 &= FE51_MASK;
+
+  fe51_store_8(s,t0 | (t1 << 51));
+  fe51_store_8(s + 8,(t1 >> 13) | (t2 << 38));
+  fe51_store_8(s + 16,(t2 >> 26) | (t3 << 25));
+  fe51_store_8(s + 24,(t3 >> 39) | (t4 << 12));
+}
+
+static inline void fe51_tofe(fe h,const fe51 f)
+{
+  unsigned char s[32];
+  fe51_tobytes(s,f);
+  fe_frombytes(h,s);
+}
+
+static inline void fe51_1(fe51 h)
+{
+  h[0] = 1; h[1] = 0; h[2] = 0; h[3] = 0; h[4] = 0;
+}
+
+static inline void fe51_add(fe51 h,const fe51 f,const fe51 g)
+{
+  h[0] = f[0] + g[0];
+  h[1] = f[1] + g[1];
+  h[2] = f[2] + g[2];
+  h[3] = f[3] + g[3];
+  h[4] = f[4] + g[4];
+}
+
+/*
+h = f - g + 4p, so that no limb goes negative for g below 2^53.
+*/
+
+static inline void fe51_sub(fe51 h,const fe51 f,const fe51 g)
+{
+  h[0] = (f[0] + 0x1fffffffffffb4) - g[0];
+  h[1] = (f[1] + 0x1ffffffffffffc) - g[1];
+  h[2] = (f[2] + 0x1ffffffffffffc) - g[2];
+  h[3] = (f[3] + 0x1ffffffffffffc) - g[3];
+  h[4] = (f[4] + 0x1ffffffffffffc) - g[4];
+}
+
+static inline void fe51_neg(fe51 h,const fe51 f)
+{
+  fe51 zero = {0,0,0,0,0};
+  fe51_sub(h,zero,f);
+}
+
+static inline void fe51_carry(fe51 h,fe51_uint128 r0,fe51_uint128 r1,
+                              fe51_uint128 r2,fe51_uint128 r3,fe51_uint128 r4)
+{
+  r1 += (crypto_uint64) (r0 >> 51);
+  r2 += (crypto_uint64) (r1 >> 51);
+  r3 += (crypto_uint64) (r2 >> 51);
+  r4 += (crypto_uint64) (r3 >> 51);
+  r0 = ((crypto_uint64) r0 & FE51_MASK) + (r4 >> 51) * 19;
+
+  h[0] = (crypto_uint64) r0 & FE51_MASK;
+  h[1] = ((crypto_uint64) r1 & FE51_MASK) + (crypto_uint64) (r0 >> 51);
+  h[2] = (crypto_uint64) r2 & FE51_MASK;
+  h[3] = (crypto_uint64) r3 & FE51_MASK;
+  h[4] = (crypto_uint64) r4 & FE51_MASK;
+}
+
+static inline void fe51_mul(fe51 h,const fe51 f,const fe51 g)
+{
+  crypto_uint64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  crypto_uint64 g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+  crypto_uint64 g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+  fe51_uint128 r0, r1, r2, r3, r4;
+
+  r0 = (fe51_uint128) f0 * g0 + (fe51_uint128) f1 * g4_19 + (fe51_uint128) f2 * g3_19
+     + (fe51_uint128) f3 * g2_19 + (fe51_uint128) f4 * g1_19;
+  r1 = (fe51_uint128) f0 * g1 + (fe51_uint128) f1 * g0 + (fe51_uint128) f2 * g4_19
+     + (fe51_uint128) f3 * g3_19 + (fe51_uint128) f4 * g2_19;
+  r2 = (fe51_uint128) f0 * g2 + (fe51_uint128) f1 * g1 + (fe51_uint128) f2 * g0
+     + (fe51_uint128) f3 * g4_19 + (fe51_uint128) f4 * g3_19;
+  r3 = (fe51_uint128) f0 * g3 + (fe51_uint128) f1 * g2 + (fe51_uint128) f2 * g1
+     + (fe51_uint128) f3 * g0 + (fe51_uint128) f4 * g4_19;
+  r4 = (fe51_uint128) f0 * g4 + (fe51_uint128) f1 * g3 + (fe51_uint128) f2 * g2
+     + (fe51_uint128) f3 * g1 + (fe51_uint128) f4 * g0;
+
+  fe51_carry(h,r0,r1,r2,r3,r4);
+}
+
+static inline void fe51_sq(fe51 h,const fe51 f)
+{
+  crypto_uint64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  crypto_uint64 f0_2 = 2 * f0, f1_2 = 2 * f1;
+  crypto_uint64 f3_19 = 19 * f3, f4_19 = 19 * f4;
+  crypto_uint64 f3_38 = 2 * f3_19, f4_38 = 2 * f4_19;
+  fe51_uint128 r0, r1, r2, r3, r4;
+
+  r0 = (fe51_uint128) f0 * f0 + (fe51_uint128) f1 * f4_38 + (fe51_uint128) f2 * f3_38;
+  r1 = (fe51_uint128) f0_2 * f1 + (fe51_uint128) f2 * f4_38 + (fe51_uint128) f3 * f3_19;
+  r2 = (fe51_uint128) f0_2 * f2 + (fe51_uint128) f1 * f1 + (fe51_uint128) f3 * f4_38;
+  r3 = (fe51_uint128) f0_2 * f3 + (fe51_uint128) f1_2 * f2 + (fe51_uint128) f4 * f4_19;
+  r4 = (fe51_uint128) f0_2 * f4 + (fe51_uint128) f1_2 * f3 + (fe51_uint128) f2 * f2;
+
+  fe51_carry(h,r0,r1,r2,r3,r4);
+}
+
+static inline int fe51_isnonzero(const fe51 f)
+{
+  unsigned char s[32];
+  unsigned char r = 0;
+  int i;
+  fe51_tobytes(s,f);
+  for (i = 0;i < 32;++i) r |= s[i];
+  return r != 0;
+}
+
+static inline int fe51_isnegative(const fe51 f)
+{
+  unsigned char s[32];
+  fe51_tobytes(s,f);
+  return s[0] & 1;
+}
+
+static inline void fe51_sqn(fe51 h,const fe51 f,int n)
+{
+  int i;
+  fe51_sq(h,f);
+  for (i = 1;i < n;++i) fe51_sq(h,h);
+}
+
+/*
+out = z^(2^252-3), with the same addition chain as fe_pow22523.
+*/
+
+static inline void fe51_pow22523(fe51 out,const fe51 z)
+{
+  fe51 t0;
+  fe51 t1;
+  fe51 t2;
+
+  fe51_sq(t0,z);            /* z^2 */
+  fe51_sqn(t1,t0,2);        /* z^8 */
+  fe51_mul(t1,z,t1);        /* z^9 */
+  fe51_mul(t0,t0,t1);       /* z^11 */
+  fe51_sq(t0,t0);           /* z^22 */
+  fe51_mul(t0,t1,t0);       /* z^(2^5-1) */
+  fe51_sqn(t1,t0,5);
+  fe51_mul(t0,t1,t0);       /* z^(2^10-1) */
+  fe51_sqn(t1,t0,10);
+  fe51_mul(t1,t1,t0);       /* z^(2^20-1) */
+  fe51_sqn(t2,t1,20);
+  fe51_mul(t1,t2,t1);       /* z^(2^40-1) */
+  fe51_sqn(t1,t1,10);
+  fe51_mul(t0,t1,t0);       /* z^(2^50-1) */
+  fe51_sqn(t1,t0,50);
+  fe51_mul(t1,t1,t0);       /* z^(2^100-1) */
+  fe51_sqn(t2,t1,100);
+  fe51_mul(t1,t2,t1);       /* z^(2^200-1) */
+  fe51_sqn(t1,t1,50);
+  fe51_mul(t0,t1,t0);       /* z^(2^250-1) */
+  fe51_sqn(t0,t0,2);
+  fe51_mul(out,t0,z);       /* z^(2^252-3) */
+}
+
+#endif /* HAVE_FE51 */
@@ -0,0 +1,55 @@
+#ifndef FE51_H
+#define FE51_H
+
+/*
+fe51 is a second representation of field elements, for 64-bit
+platforms with a 128-bit multiply: five unsigned 51-bit limbs, with
+t[0]+2^51 t[1]+2^102 t[2]+2^153 t[3]+2^204 t[4]. A multiplication
+takes 25 64x64->128 products instead of fe's 100 32x32->64 products,
+which makes long exponentiations (see fe51_pow22523) over twice as
+fast.
+
+It is only used where a value spends most of its life in such an
+exponentiation; results are converted back to fe with fe51_tofe.
+
+Limbs are kept below 2^54 between operations.
+*/
+
+#if defined(__SIZEOF_INT128__)
+#define HAVE_FE51
+
+#include "fe.h"
+#include "crypto_uint64.h"
+
+typedef crypto_uint64 fe51[5];
+
+#define fe51_frombytes crypto_sign_ed25519_ref10_fe51_frombytes
+#define fe51_tobytes crypto_sign_ed25519_ref10_fe51_tobytes
+#define fe51_tofe crypto_sign_ed25519_ref10_fe51_tofe
+#define fe51_1 crypto_sign_ed25519_ref10_fe51_1
+#define fe51_add crypto_sign_ed25519_ref10_fe51_add
+#define fe51_sub crypto_sign_ed25519_ref10_fe51_sub
+#define fe51_neg crypto_sign_ed25519_ref10_fe51_neg
+#define fe51_mul crypto_sign_ed25519_ref10_fe51_mul
+#define fe51_sq crypto_sign_ed25519_ref10_fe51_sq
+#define fe51_isnonzero crypto_sign_ed25519_ref10_fe51_isnonzero
+#define fe51_isnegative crypto_sign_ed25519_ref10_fe51_isnegative
+#define fe51_pow22523 crypto_sign_ed25519_ref10_fe51_pow22523
+
+static inline void fe51_frombytes(fe51,const unsigned char *);
+static inline void fe51_tobytes(unsigned char *,const fe51);
+static inline void fe51_tofe(fe,const fe51);
+
+static inline void fe51_1(fe51);
+static inline void fe51_add(fe51,const fe51,const fe51);
+static inline void fe51_sub(fe51,const fe51,const fe51);
+static inline void fe51_neg(fe51,const fe51);
+static inline void fe51_mul(fe51,const fe51,const fe51);
+static inline void fe51_sq(fe51,const fe51);
+static inline int  fe51_isnonzero(const fe51);
+static inline int  fe51_isnegative(const fe51);
+static inline void fe51_pow22523(fe51,const fe51);
+
+#endif /* __SIZEOF_INT128__ */
+
+#endif
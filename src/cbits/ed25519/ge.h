@@ -16,6 +16,7 @@ Representations:
 */
 
 #include "fe.h"
+#include "fe4.h"
 
 typedef struct {
   fe X;
@@ -51,8 +52,10 @@ typedef struct {
 } ge_cached;
 
 #define ge_frombytes_negate_vartime crypto_sign_ed25519_ref10_ge_frombytes_negate_vartime
+#define ge_frombytes_batch_negate_vartime crypto_sign_ed25519_ref10_ge_frombytes_batch_negate_vartime
 #define ge_tobytes crypto_sign_ed25519_ref10_ge_tobytes
 #define ge_p3_tobytes crypto_sign_ed25519_ref10_ge_p3_tobytes
+#define ge_p3_batch_tobytes crypto_sign_ed25519_ref10_ge_p3_batch_tobytes
 
 #define ge_p2_0 crypto_sign_ed25519_ref10_ge_p2_0
 #define ge_p3_0 crypto_sign_ed25519_ref10_ge_p3_0
@@ -69,11 +72,15 @@ typedef struct {
 #define ge_add crypto_sign_ed25519_ref10_ge_add
 #define ge_sub crypto_sign_ed25519_ref10_ge_sub
 #define ge_scalarmult_base crypto_sign_ed25519_ref10_ge_scalarmult_base
+#define ge_scalarmult_table crypto_sign_ed25519_ref10_ge_scalarmult_table
+#define ge_precomp_table crypto_sign_ed25519_ref10_ge_precomp_table
 #define ge_double_scalarmult_vartime crypto_sign_ed25519_ref10_ge_double_scalarmult_vartime
 
 static inline void ge_tobytes(unsigned char *,const ge_p2 *);
 static inline void ge_p3_tobytes(unsigned char *,const ge_p3 *);
+static inline void ge_p3_batch_tobytes(unsigned char *,const ge_p3 *,fe *,unsigned long long);
 static inline int  ge_frombytes_negate_vartime(ge_p3 *,const unsigned char *);
+static inline unsigned long long ge_frombytes_batch_negate_vartime(ge_p3 *,unsigned char *,const unsigned char *,unsigned long long);
 
 static inline void ge_p2_0(ge_p2 *);
 static inline void ge_p3_0(ge_p3 *);
@@ -90,6 +97,8 @@ static inline void ge_msub(ge_p1p1 *,const ge_p3 *,const ge_precomp *);
 static inline void ge_add(ge_p1p1 *,const ge_p3 *,const ge_cached *);
 static inline void ge_sub(ge_p1p1 *,const ge_p3 *,const ge_cached *);
 static inline void ge_scalarmult_base(ge_p3 *,const unsigned char *);
+static inline void ge_scalarmult_table(ge_p3 *,const unsigned char *,const ge_precomp [32][8]);
+static inline void ge_precomp_table(ge_precomp [32][8],const ge_p3 *,fe *);
 static inline void ge_double_scalarmult_vartime(ge_p2 *,const unsigned char *,const ge_p3 *,const unsigned char *);
 
 #endif
@@ -7,5 +7,19 @@ r = p + q
 static inline void ge_add(ge_p1p1 *r,const ge_p3 *p,const ge_cached *q)
 {
   fe t0;
+#ifdef HAVE_FE4
+  fe_add(r->X,p->Y,p->X);
+  fe_sub(r->Y,p->Y,p->X);
+  fe_mul4(r->Z,r->X,q->YplusX,
+          r->Y,r->Y,q->YminusX,
+          r->T,q->T2d,p->T,
+          r->X,p->Z,q->Z);
+  fe_add(t0,r->X,r->X);
+  fe_sub(r->X,r->Z,r->Y);
+  fe_add(r->Y,r->Z,r->Y);
+  fe_add(r->Z,t0,r->T);
+  fe_sub(r->T,t0,r->T);
+#else
 #include "ge_add.h"
+#endif
 }
@@ -7,5 +7,18 @@ r = p + q
 static inline void ge_madd(ge_p1p1 *r,const ge_p3 *p,const ge_precomp *q)
 {
   fe t0;
+#ifdef HAVE_FE4
+  fe_add(r->X,p->Y,p->X);
+  fe_sub(r->Y,p->Y,p->X);
+  fe_mul3(r->Z,r->X,q->yplusx,
+          r->Y,r->Y,q->yminusx,
+          r->T,q->xy2d,p->T);
+  fe_add(t0,p->Z,p->Z);
+  fe_sub(r->X,r->Z,r->Y);
+  fe_add(r->Y,r->Z,r->Y);
+  fe_add(r->Z,t0,r->T);
+  fe_sub(r->T,t0,r->T);
+#else
 #include "ge_madd.h"
+#endif
 }
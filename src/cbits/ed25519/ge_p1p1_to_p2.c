@@ -6,7 +6,13 @@ r = p
 
 static inline void ge_p1p1_to_p2(ge_p2 *r,const ge_p1p1 *p)
 {
+#ifdef HAVE_FE4
+  fe_mul3(r->X,p->X,p->T,
+          r->Y,p->Y,p->Z,
+          r->Z,p->Z,p->T);
+#else
   fe_mul(r->X,p->X,p->T);
   fe_mul(r->Y,p->Y,p->Z);
   fe_mul(r->Z,p->Z,p->T);
+#endif
 }
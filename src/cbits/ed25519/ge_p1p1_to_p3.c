@@ -6,8 +6,15 @@ r = p
 
 static inline void ge_p1p1_to_p3(ge_p3 *r,const ge_p1p1 *p)
 {
+#ifdef HAVE_FE4
+  fe_mul4(r->X,p->X,p->T,
+          r->Y,p->Y,p->Z,
+          r->Z,p->Z,p->T,
+          r->T,p->X,p->Y);
+#else
   fe_mul(r->X,p->X,p->T);
   fe_mul(r->Y,p->Y,p->Z);
   fe_mul(r->Z,p->Z,p->T);
   fe_mul(r->T,p->X,p->Y);
+#endif
 }
@@ -7,5 +7,17 @@ r = 2 * p
 static inline void ge_p2_dbl(ge_p1p1 *r,const ge_p2 *p)
 {
   fe t0;
+#ifdef HAVE_FE4
+  fe_add(r->Y,p->X,p->Y);
+  fe_sq4(r->X,p->X,       /* XX */
+         r->Z,p->Y,       /* YY */
+         r->T,p->Z,       /* B = 2*Z^2 */
+         t0,r->Y,4);      /* AA */
+  fe_add(r->Y,r->Z,r->X);
+  fe_sub(r->Z,r->Z,r->X);
+  fe_sub(r->X,t0,r->Y);
+  fe_sub(r->T,r->T,r->Z);
+#else
 #include "ge_p2_dbl.h"
+#endif
 }
@@ -0,0 +1,38 @@
+#include "ge.h"
+
+/*
+Encode n points at once, sharing a single field inversion between
+them (Montgomery's trick): with acc[i] = Z[0]*...*Z[i], one inversion
+of acc[n-1] recovers every 1/Z[i] for three extra multiplications per
+point. tmp must have room for n field elements.
+*/
+
+static inline void ge_p3_batch_tobytes(unsigned char *s,const ge_p3 *h,fe *tmp,unsigned long long n)
+{
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  unsigned long long i;
+
+  if (n == 0) return;
+
+  fe_copy(tmp[0],h[0].Z);
+  for (i = 1;i < n;++i) fe_mul(tmp[i],tmp[i - 1],h[i].Z);
+
+  fe_invert(inv,tmp[n - 1]);
+
+  for (i = n - 1;i > 0;--i) {
+    fe_mul(recip,inv,tmp[i - 1]);   /* recip = 1/Z[i] */
+    fe_mul(inv,inv,h[i].Z);         /* inv = 1/(Z[0]*...*Z[i-1]) */
+    fe_mul(x,h[i].X,recip);
+    fe_mul(y,h[i].Y,recip);
+    fe_tobytes(s + 32 * i,y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+
+  fe_mul(x,h[0].X,inv);
+  fe_mul(y,h[0].Y,inv);
+  fe_tobytes(s,y);
+  s[31] ^= fe_isnegative(x) << 7;
+}
@@ -0,0 +1,65 @@
+#include "ge.h"
+
+/*
+table[i][j] = (j+1)*256^i*p
+
+This is the same layout as the base point table used by
+ge_scalarmult_base, so ge_scalarmult_table can multiply p by a secret
+scalar at fixed-base speed. The 256 points are computed in projective
+form, stored in the table itself as (X,Y,Z), and then made affine
+with a single field inversion (Montgomery's trick, as in
+ge_p3_batch_tobytes). tmp must have room for 256 field elements.
+*/
+
+static inline void ge_precomp_table(ge_precomp table[32][8],const ge_p3 *p,fe *tmp)
+{
+  ge_p3 q;
+  ge_p3 r;
+  ge_p2 s;
+  ge_p1p1 t;
+  ge_cached c;
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  int i;
+  int j;
+  int k;
+
+  q = *p;
+  for (i = 0;i < 32;++i) {
+    ge_p3_to_cached(&c,&q);
+    r = q;
+    for (j = 0;j < 8;++j) {
+      if (j > 0) { ge_add(&t,&r,&c); ge_p1p1_to_p3(&r,&t); }
+      fe_copy(table[i][j].yplusx,r.X);
+      fe_copy(table[i][j].yminusx,r.Y);
+      fe_copy(table[i][j].xy2d,r.Z);
+    }
+    /* q = 256*q = 32*(8*q) */
+    ge_p3_dbl(&t,&r);  ge_p1p1_to_p2(&s,&t);
+    for (k = 0;k < 3;++k) { ge_p2_dbl(&t,&s); ge_p1p1_to_p2(&s,&t); }
+    ge_p2_dbl(&t,&s);  ge_p1p1_to_p3(&q,&t);
+  }
+
+  fe_copy(tmp[0],table[0][0].xy2d);
+  for (k = 1;k < 256;++k) fe_mul(tmp[k],tmp[k - 1],table[k / 8][k % 8].xy2d);
+
+  fe_invert(inv,tmp[255]);
+
+  for (k = 255;k >= 0;--k) {
+    ge_precomp *h = &table[k / 8][k % 8];
+    if (k > 0) {
+      fe_mul(recip,inv,tmp[k - 1]);  /* recip = 1/Z[k] */
+      fe_mul(inv,inv,h->xy2d);       /* inv = 1/(Z[0]*...*Z[k-1]) */
+    } else {
+      fe_copy(recip,inv);
+    }
+    fe_mul(x,h->yplusx,recip);
+    fe_mul(y,h->yminusx,recip);
+    fe_add(h->yplusx,y,x);
+    fe_sub(h->yminusx,y,x);
+    fe_mul(h->xy2d,x,y);
+    fe_mul(h->xy2d,h->xy2d,d2);
+  }
+}
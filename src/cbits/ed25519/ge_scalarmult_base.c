@@ -19,7 +19,7 @@ static inline unsigned char negative(signed char b)
   return x;
 }
 
-static inline void cmov(ge_precomp *t,ge_precomp *u,unsigned char b)
+static inline void cmov(ge_precomp *t,const ge_precomp *u,unsigned char b)
 {
   fe_cmov(t->yplusx,u->yplusx,b);
   fe_cmov(t->yminusx,u->yminusx,b);
@@ -31,21 +31,21 @@ static ge_precomp base[32][8] = {
 #include "base.h"
 } ;
 
-static inline void select_ed25519(ge_precomp *t,int pos,signed char b)
+static inline void select_ed25519(ge_precomp *t,const ge_precomp *row,signed char b)
 {
   ge_precomp minust;
   unsigned char bnegative = negative(b);
   unsigned char babs = b - (((-bnegative) & b) << 1);
 
   ge_precomp_0(t);
-  cmov(t,&base[pos][0],equal(babs,1));
-  cmov(t,&base[pos][1],equal(babs,2));
-  cmov(t,&base[pos][2],equal(babs,3));
-  cmov(t,&base[pos][3],equal(babs,4));
-  cmov(t,&base[pos][4],equal(babs,5));
-  cmov(t,&base[pos][5],equal(babs,6));
-  cmov(t,&base[pos][6],equal(babs,7));
-  cmov(t,&base[pos][7],equal(babs,8));
+  cmov(t,&row[0],equal(babs,1));
+  cmov(t,&row[1],equal(babs,2));
+  cmov(t,&row[2],equal(babs,3));
+  cmov(t,&row[3],equal(babs,4));
+  cmov(t,&row[4],equal(babs,5));
+  cmov(t,&row[5],equal(babs,6));
+  cmov(t,&row[6],equal(babs,7));
+  cmov(t,&row[7],equal(babs,8));
   fe_copy(minust.yplusx,t->yminusx);
   fe_copy(minust.yminusx,t->yplusx);
   fe_neg(minust.xy2d,t->xy2d);
@@ -53,15 +53,15 @@ static inline void select_ed25519(ge_precomp *t,int pos,signed char b)
 }
 
 /*
-h = a * B
+h = a * P
 where a = a[0]+256*a[1]+...+256^31 a[31]
-B is the Ed25519 base point (x,4/5) with x positive.
+and table[i][j] = (j+1)*256^i*P, as built by ge_precomp_table.
 
 Preconditions:
   a[31] <= 127
 */
 
-static inline void ge_scalarmult_base(ge_p3 *h,const unsigned char *a)
+static inline void ge_scalarmult_table(ge_p3 *h,const unsigned char *a,const ge_precomp table[32][8])
 {
   signed char e[64];
   signed char carry;
@@ -89,7 +89,7 @@ static inline void ge_scalarmult_base(ge_p3 *h,const unsigned char *a)
 
   ge_p3_0(h);
   for (i = 1;i < 64;i += 2) {
-    select_ed25519(&t,i / 2,e[i]);
+    select_ed25519(&t,table[i / 2],e[i]);
     ge_madd(&r,h,&t); ge_p1p1_to_p3(h,&r);
   }
 
@@ -99,7 +99,21 @@ static inline void ge_scalarmult_base(ge_p3 *h,const unsigned char *a)
   ge_p2_dbl(&r,&s); ge_p1p1_to_p3(h,&r);
 
   for (i = 0;i < 64;i += 2) {
-    select_ed25519(&t,i / 2,e[i]);
+    select_ed25519(&t,table[i / 2],e[i]);
     ge_madd(&r,h,&t); ge_p1p1_to_p3(h,&r);
   }
 }
+
+/*
+h = a * B
+where a = a[0]+256*a[1]+...+256^31 a[31]
+B is the Ed25519 base point (x,4/5) with x positive.
+
+Preconditions:
+  a[31] <= 127
+*/
+
+static inline void ge_scalarmult_base(ge_p3 *h,const unsigned char *a)
+{
+  ge_scalarmult_table(h,a,(const ge_precomp (*)[8]) base);
+}
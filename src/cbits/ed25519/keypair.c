@@ -2,6 +2,7 @@
 #include "ed25519.h"
 #include "sha512.h"
 #include "ge.h"
+#include "probes.h"
 
 int ed25519_sign_keypair(unsigned char *pk,unsigned char *sk)
 {
@@ -9,6 +10,7 @@ int ed25519_sign_keypair(unsigned char *pk,unsigned char *sk)
   ge_p3 A;
   int i;
 
+  NACL_PROBE_ENTRY(ed25519_sign_keypair,32);
   randombytes(sk,32);
   crypto_hash_sha512(h,sk,32);
   h[0] &= 248;
@@ -19,5 +21,52 @@ int ed25519_sign_keypair(unsigned char *pk,unsigned char *sk)
   ge_p3_tobytes(pk,&A);
 
   for (i = 0;i < 32;++i) sk[32 + i] = pk[i];
+  NACL_PROBE_RETURN(ed25519_sign_keypair,32,0);
+  return 0;
+}
+
+/*
+Generate n keypairs into pk[32*n] and sk[64*n]. All the entropy is
+read with a single randombytes call, and the point encodings share one
+field inversion per KEYPAIR_BATCH keys (see ge_p3_batch_tobytes).
+*/
+
+#define KEYPAIR_BATCH 64
+
+int ed25519_sign_keypair_batch(unsigned char *pk,unsigned char *sk,
+                               unsigned long long n)
+{
+  unsigned char h[64];
+  ge_p3 A[KEYPAIR_BATCH];
+  fe tmp[KEYPAIR_BATCH];
+  unsigned long long i,j,k;
+
+  NACL_PROBE_ENTRY(ed25519_sign_keypair_batch,n);
+  if (n == 0) goto done;
+
+  /* read all the seeds into the front of sk, then spread them out */
+  randombytes(sk,32 * n);
+  for (i = n - 1;i > 0;--i)
+    for (j = 0;j < 32;++j) sk[64 * i + j] = sk[32 * i + j];
+
+  for (i = 0;i < n;i += KEYPAIR_BATCH) {
+    k = n - i < KEYPAIR_BATCH ? n - i : KEYPAIR_BATCH;
+
+    for (j = 0;j < k;++j) {
+      crypto_hash_sha512(h,sk + 64 * (i + j),32);
+      h[0] &= 248;
+      h[31] &= 63;
+      h[31] |= 64;
+      ge_scalarmult_base(&A[j],h);
+    }
+
+    ge_p3_batch_tobytes(pk + 32 * i,A,tmp,k);
+  }
+
+  for (i = 0;i < n;++i)
+    for (j = 0;j < 32;++j) sk[64 * i + 32 + j] = pk[32 * i + j];
+
+done:
+  NACL_PROBE_RETURN(ed25519_sign_keypair_batch,n,0);
   return 0;
 }
@@ -1,32 +1,33 @@
+#include <string.h>
 #include "ed25519.h"
 #include "sha512.h"
 #include "crypto_verify.h"
 #include "ge.h"
 #include "sc.h"
+#include "probes.h"
 
-int ed25519_sign_open(
+/*
+Verify sm against -A, the already decompressed and negated public key
+pk.
+*/
+
+static int sign_open(
   unsigned char *m,unsigned long long *mlen,
   const unsigned char *sm,unsigned long long smlen,
-  const unsigned char *pk
+  const ge_p3 *A,const unsigned char *pk
 )
 {
   unsigned char h[64];
   unsigned char checkr[32];
-  ge_p3 A;
   ge_p2 R;
   unsigned long long i;
 
-  *mlen = -1;
-  if (smlen < 64) return -1;
-  if (sm[63] & 224) return -1;
-  if (ge_frombytes_negate_vartime(&A,pk) != 0) return -1;
-
   for (i = 0;i < smlen;++i) m[i] = sm[i];
   for (i = 0;i < 32;++i) m[32 + i] = pk[i];
   crypto_hash_sha512(h,m,smlen);
   sc_reduce(h);
 
-  ge_double_scalarmult_vartime(&R,h,&A,sm + 32);
+  ge_double_scalarmult_vartime(&R,h,A,sm + 32);
   ge_tobytes(checkr,&R);
   if (crypto_verify_32(checkr,sm) != 0) {
     for (i = 0;i < smlen;++i) m[i] = 0;
@@ -38,3 +39,45 @@ int ed25519_sign_open(
   *mlen = smlen - 64;
   return 0;
 }
+
+int ed25519_sign_open(
+  unsigned char *m,unsigned long long *mlen,
+  const unsigned char *sm,unsigned long long smlen,
+  const unsigned char *pk
+)
+{
+  ge_p3 A;
+  int r = -1;
+
+  NACL_PROBE_ENTRY(ed25519_sign_open,smlen);
+  *mlen = -1;
+  if (smlen >= 64 && !(sm[63] & 224) &&
+      ge_frombytes_negate_vartime(&A,pk) == 0)
+    r = sign_open(m,mlen,sm,smlen,&A,pk);
+  NACL_PROBE_RETURN(ed25519_sign_open,smlen,r);
+  return r;
+}
+
+/*
+Like ed25519_sign_open, with a public key from ed25519_prepare_keys.
+A prepared key is -A followed by the 32-byte encoding of A; a key
+which failed to decompress is all zeros, and never verifies.
+*/
+
+int ed25519_sign_open_prepared(
+  unsigned char *m,unsigned long long *mlen,
+  const unsigned char *sm,unsigned long long smlen,
+  const unsigned char *prepared
+)
+{
+  ge_p3 A;
+  int r = -1;
+
+  NACL_PROBE_ENTRY(ed25519_sign_open_prepared,smlen);
+  *mlen = -1;
+  memcpy(&A,prepared,sizeof A);
+  if (smlen >= 64 && !(sm[63] & 224) && fe_isnonzero(A.Z))
+    r = sign_open(m,mlen,sm,smlen,&A,prepared + sizeof A);
+  NACL_PROBE_RETURN(ed25519_sign_open_prepared,smlen,r);
+  return r;
+}
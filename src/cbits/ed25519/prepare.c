@@ -0,0 +1,42 @@
+#include <string.h>
+#include "ed25519.h"
+#include "ge.h"
+#include "probes.h"
+
+typedef char prepared_size_check[sizeof(ge_p3) + 32 == crypto_sign_PREPAREDBYTES ? 1 : -1];
+
+/*
+Decompress and validate n public keys pk[32*n] into prepared keys
+out[crypto_sign_PREPAREDBYTES*n] for ed25519_sign_open_prepared and
+ed25519_verify_detached_prepared. ok[i] is set to 1 for valid keys
+and 0 for invalid ones, whose prepared keys are all zeros. Returns the
+number of valid keys.
+
+Keys are decompressed PREPARE_BATCH at a time, into a stack buffer.
+*/
+
+#define PREPARE_BATCH 64
+
+unsigned long long ed25519_prepare_keys(unsigned char *out,unsigned char *ok,
+                                        const unsigned char *pk,
+                                        unsigned long long n)
+{
+  ge_p3 A[PREPARE_BATCH];
+  unsigned long long i,j,k;
+  unsigned long long good = 0;
+
+  NACL_PROBE_ENTRY(ed25519_prepare_keys,n);
+  for (i = 0;i < n;i += PREPARE_BATCH) {
+    k = n - i < PREPARE_BATCH ? n - i : PREPARE_BATCH;
+    good += ge_frombytes_batch_negate_vartime(A,ok + i,pk + 32 * i,k);
+
+    for (j = 0;j < k;++j) {
+      unsigned char *p = out + crypto_sign_PREPAREDBYTES * (i + j);
+      memcpy(p,&A[j],sizeof(ge_p3));
+      if (ok[i + j]) memcpy(p + sizeof(ge_p3),pk + 32 * (i + j),32);
+      else memset(p + sizeof(ge_p3),0,32);
+    }
+  }
+  NACL_PROBE_RETURN(ed25519_prepare_keys,n,good);
+  return good;
+}
@@ -250,19 +250,15 @@ static const unsigned char iv[64] = {
   0x5b,0xe0,0xcd,0x19,0x13,0x7e,0x21,0x79
 } ;
 
-static inline int crypto_hash_sha512(unsigned char *out,const unsigned char *in,unsigned long long inlen)
+/*
+Pads the last inlen (< 128) bytes of a message of the given total
+length, hashes them into the state h and writes the result.
+*/
+
+static inline void crypto_hash_sha512_finish(unsigned char *out,unsigned char *h,const unsigned char *in,unsigned long long inlen,unsigned long long bytes)
 {
-  unsigned char h[64];
   unsigned char padded[256];
   int i;
-  unsigned long long bytes = inlen;
-
-  for (i = 0;i < 64;++i) h[i] = iv[i];
-
-  blocks(h,in,inlen);
-  in += inlen;
-  inlen &= 127;
-  in -= inlen;
 
   for (i = 0;i < inlen;++i) padded[i] = in[i];
   padded[inlen] = 0x80;
@@ -294,6 +290,55 @@ static inline int crypto_hash_sha512(unsigned char *out,const unsigned char *in,
   }
 
   for (i = 0;i < 64;++i) out[i] = h[i];
+}
+
+static inline int crypto_hash_sha512(unsigned char *out,const unsigned char *in,unsigned long long inlen)
+{
+  unsigned char h[64];
+  int i;
+  unsigned long long bytes = inlen;
+
+  for (i = 0;i < 64;++i) h[i] = iv[i];
+
+  blocks(h,in,inlen);
+  in += inlen;
+  inlen &= 127;
+  in -= inlen;
+
+  crypto_hash_sha512_finish(out,h,in,inlen,bytes);
+  return 0;
+}
+
+/*
+The hash of a (at most 128 bytes) followed by b, without copying b.
+*/
+
+static inline int crypto_hash_sha512_2(unsigned char *out,const unsigned char *a,unsigned long long alen,const unsigned char *b,unsigned long long blen)
+{
+  unsigned char h[64];
+  unsigned char block[128];
+  unsigned long long bytes = alen + blen;
+  unsigned long long i;
+
+  for (i = 0;i < 64;++i) h[i] = iv[i];
+  for (i = 0;i < alen;++i) block[i] = a[i];
+
+  if (bytes < 128) {
+    for (i = 0;i < blen;++i) block[alen + i] = b[i];
+    crypto_hash_sha512_finish(out,h,block,bytes,bytes);
+    return 0;
+  }
+
+  for (i = alen;i < 128;++i) block[i] = b[i - alen];
+  blocks(h,block,128);
+  b += 128 - alen;
+  blen -= 128 - alen;
+
+  blocks(h,b,blen);
+  b += blen;
+  blen &= 127;
+  b -= blen;
 
+  crypto_hash_sha512_finish(out,h,b,blen,bytes);
   return 0;
 }
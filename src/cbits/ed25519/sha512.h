@@ -8,5 +8,10 @@
 static inline int crypto_hash_sha512(unsigned char *out,
                                      const unsigned char *in,
                                      unsigned long long inlen);
+static inline int crypto_hash_sha512_2(unsigned char *out,
+                                       const unsigned char *a,
+                                       unsigned long long alen,
+                                       const unsigned char *b,
+                                       unsigned long long blen);
 
 #endif /* SHA512_H */
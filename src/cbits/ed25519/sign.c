@@ -2,6 +2,7 @@
 #include "sha512.h"
 #include "ge.h"
 #include "sc.h"
+#include "probes.h"
 
 int ed25519_sign(
   unsigned char *sm,unsigned long long *smlen,
@@ -15,6 +16,7 @@ int ed25519_sign(
   ge_p3 R;
   unsigned long long i;
 
+  NACL_PROBE_ENTRY(ed25519_sign,mlen);
   crypto_hash_sha512(az,sk,32);
   az[0] &= 248;
   az[31] &= 63;
@@ -34,5 +36,6 @@ int ed25519_sign(
   sc_reduce(hram);
   sc_muladd(sm + 32,hram,az,r);
 
+  NACL_PROBE_RETURN(ed25519_sign,mlen,0);
   return 0;
 }
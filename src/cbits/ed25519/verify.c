@@ -0,0 +1,95 @@
+#include <string.h>
+#include "ed25519.h"
+#include "sha512.h"
+#include "crypto_verify.h"
+#include "ge.h"
+#include "sc.h"
+#include "probes.h"
+
+/*
+Verify a detached signature sig of the mlen bytes at m against -A, the
+already decompressed and negated public key pk. Unlike sign_open in
+open.c, this needs no copy of the message: R || A is hashed from a
+small buffer, and the message straight from m.
+*/
+
+static int verify_detached(
+  const unsigned char *sig,
+  const unsigned char *m,unsigned long long mlen,
+  const ge_p3 *A,const unsigned char *pk
+)
+{
+  unsigned char ra[64];
+  unsigned char h[64];
+  unsigned char checkr[32];
+  ge_p2 R;
+
+  memcpy(ra,sig,32);
+  memcpy(ra + 32,pk,32);
+  crypto_hash_sha512_2(h,ra,64,m,mlen);
+  sc_reduce(h);
+
+  ge_double_scalarmult_vartime(&R,h,A,sig + 32);
+  ge_tobytes(checkr,&R);
+  return crypto_verify_32(checkr,sig);
+}
+
+int ed25519_verify_detached(
+  const unsigned char *sig,
+  const unsigned char *m,unsigned long long mlen,
+  const unsigned char *pk
+)
+{
+  ge_p3 A;
+  int r = -1;
+
+  NACL_PROBE_ENTRY(ed25519_verify_detached,mlen);
+  if (!(sig[63] & 224) && ge_frombytes_negate_vartime(&A,pk) == 0)
+    r = verify_detached(sig,m,mlen,&A,pk);
+  NACL_PROBE_RETURN(ed25519_verify_detached,mlen,r);
+  return r;
+}
+
+/*
+Like ed25519_verify_detached, with a public key from
+ed25519_prepare_keys (see ed25519_sign_open_prepared).
+*/
+
+int ed25519_verify_detached_prepared(
+  const unsigned char *sig,
+  const unsigned char *m,unsigned long long mlen,
+  const unsigned char *prepared
+)
+{
+  ge_p3 A;
+  int r = -1;
+
+  NACL_PROBE_ENTRY(ed25519_verify_detached_prepared,mlen);
+  memcpy(&A,prepared,sizeof A);
+  if (!(sig[63] & 224) && fe_isnonzero(A.Z))
+    r = verify_detached(sig,m,mlen,&A,prepared + sizeof A);
+  NACL_PROBE_RETURN(ed25519_verify_detached_prepared,mlen,r);
+  return r;
+}
+
+/*
+Verify n detached signatures: sigs[64*i] of the mlens[i] bytes at
+m[i] under pks[32*i]. ok[i] is set to 1 if the ith is valid, and 0
+otherwise.
+*/
+
+void ed25519_verify_many(
+  unsigned char *ok,
+  const unsigned char *sigs,
+  const unsigned char * const *m,const unsigned long long *mlens,
+  const unsigned char *pks,
+  unsigned long long n
+)
+{
+  unsigned long long i;
+
+  NACL_PROBE_ENTRY(ed25519_verify_many,n);
+  for (i = 0;i < n;++i)
+    ok[i] = ed25519_verify_detached(sigs + 64*i,m[i],mlens[i],pks + 32*i) == 0;
+  NACL_PROBE_RETURN(ed25519_verify_many,n,0);
+}
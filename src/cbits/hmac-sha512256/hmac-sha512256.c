@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include "hmac-sha512256.h"
+#include "probes.h"
 
 #define VERIFY_F(i) differentbits |= x[i] ^ y[i];
 
@@ -310,7 +311,7 @@ static const unsigned char iv[64] = {
   0x5b,0xe0,0xcd,0x19,0x13,0x7e,0x21,0x79
 } ;
 
-int sha512256_hmac(unsigned char *out,const unsigned char *in,unsigned long long inlen,const unsigned char *k)
+static int hmac(unsigned char *out,const unsigned char *in,unsigned long long inlen,const unsigned char *k)
 {
   unsigned char h[64];
   unsigned char padded[256];
@@ -373,9 +374,118 @@ int sha512256_hmac(unsigned char *out,const unsigned char *in,unsigned long long
   return 0;
 }
 
+int sha512256_hmac(unsigned char *out,const unsigned char *in,unsigned long long inlen,const unsigned char *k)
+{
+  int r;
+  NACL_PROBE_ENTRY(sha512256_hmac,inlen);
+  r = hmac(out,in,inlen,k);
+  NACL_PROBE_RETURN(sha512256_hmac,inlen,r);
+  return r;
+}
+
 int sha512256_hmac_verify(const unsigned char *h,const unsigned char *in,unsigned long long inlen,const unsigned char *k)
 {
   unsigned char correct[32];
-  sha512256_hmac(correct,in,inlen,k);
-  return crypto_verify_32(h,correct);
+  int r;
+  NACL_PROBE_ENTRY(sha512256_hmac_verify,inlen);
+  hmac(correct,in,inlen,k);
+  r = crypto_verify_32(h,correct);
+  NACL_PROBE_RETURN(sha512256_hmac_verify,inlen,r);
+  return r;
+}
+
+/*
+ * Incremental HMAC, for messages which arrive in pieces. Both pads
+ * are hashed up front, so the key is not kept in the state.
+ */
+
+struct sha512256_hmac_state {
+  unsigned char h[64];          /* inner hash, after the key block */
+  unsigned char hout[64];       /* outer hash, after the key block */
+  unsigned char buf[128];       /* inner message bytes not yet hashed */
+  unsigned long long bytes;     /* inner message bytes so far */
+};
+
+unsigned long sha512256_hmac_statebytes(void)
+{
+  return sizeof(struct sha512256_hmac_state);
+}
+
+void sha512256_hmac_init(struct sha512256_hmac_state *st,const unsigned char *k)
+{
+  unsigned char padded[128];
+  int i;
+
+  for (i = 0;i < 64;++i) st->h[i] = st->hout[i] = iv[i];
+
+  for (i = 0;i < 32;++i) padded[i] = k[i] ^ 0x36;
+  for (i = 32;i < 128;++i) padded[i] = 0x36;
+  blocks(st->h,padded,128);
+
+  for (i = 0;i < 32;++i) padded[i] = k[i] ^ 0x5c;
+  for (i = 32;i < 128;++i) padded[i] = 0x5c;
+  blocks(st->hout,padded,128);
+
+  for (i = 0;i < 128;++i) padded[i] = 0;
+  st->bytes = 0;
+}
+
+static void hmac_update(struct sha512256_hmac_state *st,const unsigned char *in,unsigned long long inlen)
+{
+  unsigned long long have = st->bytes & 127;
+  unsigned long long i;
+
+  st->bytes += inlen;
+  if (have) {
+    for (;have < 128 && inlen;++have, ++in, --inlen) st->buf[have] = *in;
+    if (have < 128) return;
+    blocks(st->h,st->buf,128);
+  }
+  blocks(st->h,in,inlen);
+  in += inlen;
+  inlen &= 127;
+  in -= inlen;
+  for (i = 0;i < inlen;++i) st->buf[i] = in[i];
+}
+
+void sha512256_hmac_update(struct sha512256_hmac_state *st,const unsigned char *in,unsigned long long inlen)
+{
+  NACL_PROBE_ENTRY(sha512256_hmac_update,inlen);
+  hmac_update(st,in,inlen);
+  NACL_PROBE_RETURN(sha512256_hmac_update,inlen,0);
+}
+
+void sha512256_hmac_final(struct sha512256_hmac_state *st,unsigned char *out)
+{
+  unsigned char padded[256];
+  unsigned long long bytes = 128 + st->bytes;
+  unsigned long long inlen = st->bytes & 127;
+  unsigned long long n;
+  int i;
+
+  for (i = 0;i < inlen;++i) padded[i] = st->buf[i];
+  padded[inlen] = 0x80;
+  n = inlen < 112 ? 128 : 256;
+  for (i = inlen + 1;i < n - 9;++i) padded[i] = 0;
+  padded[n - 9] = bytes >> 61;
+  padded[n - 8] = bytes >> 53;
+  padded[n - 7] = bytes >> 45;
+  padded[n - 6] = bytes >> 37;
+  padded[n - 5] = bytes >> 29;
+  padded[n - 4] = bytes >> 21;
+  padded[n - 3] = bytes >> 13;
+  padded[n - 2] = bytes >> 5;
+  padded[n - 1] = bytes << 3;
+  blocks(st->h,padded,n);
+
+  for (i = 0;i < 64;++i) padded[i] = st->h[i];
+  padded[64] = 0x80;
+  for (i = 65;i < 128;++i) padded[i] = 0;
+  padded[126] = 6;
+  blocks(st->hout,padded,128);
+  for (i = 0;i < 32;++i) out[i] = st->hout[i];
+
+  for (i = 0;i < 256;++i) padded[i] = 0;
+  for (i = 0;i < 128;++i) st->buf[i] = 0;
+  for (i = 0;i < 64;++i) st->h[i] = st->hout[i] = 0;
 }
@@ -6,4 +6,12 @@ int hmacsha512256_hmac(unsigned char *out,const unsigned char *in,
 int hmacsha512256_hmac_verify(const unsigned char *h,const unsigned char *in,
                               unsigned long long inlen,const unsigned char *k);
 
+/* Incremental HMAC; allocate sha512256_hmac_statebytes() bytes. */
+struct sha512256_hmac_state;
+unsigned long sha512256_hmac_statebytes(void);
+void sha512256_hmac_init(struct sha512256_hmac_state *st,const unsigned char *k);
+void sha512256_hmac_update(struct sha512256_hmac_state *st,
+                           const unsigned char *in,unsigned long long inlen);
+void sha512256_hmac_final(struct sha512256_hmac_state *st,unsigned char *out);
+
 #endif /* _HMAC_SHA512256_H_ */
@@ -0,0 +1,484 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <pthread.h>
+#include <fcntl.h>
+#endif
+
+#include "pipe.h"
+#include "probes.h"
+
+#define PRIVATE_API
+#include "../xsalsa20poly1305/xsalsa20poly1305.c"
+#undef PRIVATE_API
+
+/*
+ * fd to fd encryption, for Crypto.Encrypt.Stream and
+ * Crypto.Encrypt.SecretBox.
+ *
+ * Data moves through a ring of PIPE_NBUFS buffers in three stages:
+ * a reader thread fills buffers from in_fd, the calling thread
+ * encrypts or decrypts them in place, and a writer thread drains them
+ * to out_fd. So reading, encryption and writing of consecutive
+ * buffers all overlap, and no byte is ever copied between buffers.
+ * Where threads are not available, the same stages simply run one
+ * after the other on a single buffer.
+ *
+ * A sealed stream is a sequence of records
+ *
+ *   length (4 bytes, big endian) || tag (16 bytes) || ciphertext
+ *
+ * as in Crypto.Session, where length counts the tag and ciphertext,
+ * and every record is a crypto_secretbox of its plaintext under the
+ * key. The last 8 bytes of the nonce are a big endian record counter,
+ * bumped after every record. Every record holds PIPE_BUFBYTES of
+ * plaintext except the last, which holds less (possibly none), so a
+ * stream which is cut short at a record boundary fails to open.
+ *
+ * All functions return the number of bytes written to out_fd, or -1
+ * with errno set. A sealed stream which fails to authenticate, or is
+ * truncated or malformed, fails with EBADMSG; every record written
+ * before that point was authentic, but the caller should still
+ * discard the output.
+ */
+
+#define PIPE_STREAM 0
+#define PIPE_SEAL   1
+#define PIPE_OPEN   2
+
+#define PIPE_SLOTBYTES (PIPE_HEADERBYTES + PIPE_BUFBYTES)
+
+struct pipe_slot {
+  unsigned char *buf;
+  size_t len;     /* bytes read; then bytes to write */
+  size_t off;     /* offset of the bytes to write */
+  int last;
+};
+
+struct pipe {
+  int in_fd,out_fd,mode;
+  unsigned char nonce[24];
+  unsigned char key[32];        /* the subkey, for PIPE_STREAM */
+  unsigned long long ic;        /* next salsa20 block, for PIPE_STREAM */
+  long long total;
+
+  struct pipe_slot slot[PIPE_NBUFS];
+  unsigned char *mem;
+
+  /* Sequence numbers of the next buffer each stage will process, and
+     one past the last buffer, once the reader has found it. */
+  unsigned long long nread,ncrypt,nwrite,end;
+  int err;
+#ifndef _WIN32
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+};
+
+/* ------------------------------------------------------------------ */
+/* I/O */
+
+#ifndef _WIN32
+static int
+pipe_poll(int fd,short events)
+{
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = events;
+  return poll(&pfd,1,-1) < 0 && errno != EINTR ? -1 : 0;
+}
+#endif
+
+/* Read until len bytes or end of file. Returns the number of bytes
+   read, or -1. */
+static long long
+pipe_readall(int fd,unsigned char *buf,size_t len)
+{
+  size_t done = 0;
+  ssize_t r;
+
+  while (done < len) {
+    r = read(fd,buf + done,len - done);
+    if (r == 0) break;
+    if (r < 0) {
+      if (errno == EINTR) continue;
+#ifndef _WIN32
+      if ((errno == EAGAIN || errno == EWOULDBLOCK) &&
+          pipe_poll(fd,POLLIN) == 0) continue;
+#endif
+      return -1;
+    }
+    done += r;
+  }
+  return done;
+}
+
+static int
+pipe_writeall(int fd,const unsigned char *buf,size_t len)
+{
+  ssize_t r;
+
+  while (len > 0) {
+    r = write(fd,buf,len);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+#ifndef _WIN32
+      if ((errno == EAGAIN || errno == EWOULDBLOCK) &&
+          pipe_poll(fd,POLLOUT) == 0) continue;
+#endif
+      return -1;
+    }
+    buf += r;
+    len -= r;
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Stages; each returns 0 or an errno value. */
+
+static int
+pipe_read(struct pipe *p,struct pipe_slot *s)
+{
+  unsigned char c;
+  unsigned long long flen;
+  long long r;
+
+  if (p->mode != PIPE_OPEN) {
+    r = pipe_readall(p->in_fd,s->buf + PIPE_HEADERBYTES,PIPE_BUFBYTES);
+    if (r < 0) return errno;
+    s->len  = r;
+    s->last = r < PIPE_BUFBYTES;
+    return 0;
+  }
+
+  r = pipe_readall(p->in_fd,s->buf,4);
+  if (r < 0) return errno;
+  if (r < 4) return EBADMSG;
+  flen = ((unsigned long long)s->buf[0] << 24) |
+         ((unsigned long long)s->buf[1] << 16) |
+         ((unsigned long long)s->buf[2] << 8)  |
+          (unsigned long long)s->buf[3];
+  if (flen < 16 || flen > PIPE_BUFBYTES + 16) return EBADMSG;
+
+  r = pipe_readall(p->in_fd,s->buf + 4,flen);
+  if (r < 0) return errno;
+  if ((unsigned long long)r < flen) return EBADMSG;
+  s->len  = flen - 16;
+  s->last = s->len < PIPE_BUFBYTES;
+
+  /* Nothing may follow the last record. */
+  if (s->last) {
+    r = pipe_readall(p->in_fd,&c,1);
+    if (r < 0) return errno;
+    if (r > 0) return EBADMSG;
+  }
+  return 0;
+}
+
+static void
+pipe_incnonce(unsigned char *nonce)
+{
+  int i;
+  for (i = 23; i >= 16; --i)
+    if (++nonce[i] != 0) break;
+}
+
+static int
+pipe_crypt(struct pipe *p,struct pipe_slot *s)
+{
+  unsigned char *m = s->buf + PIPE_HEADERBYTES;
+  unsigned long long flen;
+
+  switch (p->mode) {
+  case PIPE_STREAM:
+    crypto_stream_salsa20_xor_ic(m,m,s->len,p->nonce + 16,p->ic,p->key);
+    p->ic += s->len / 64;
+    s->off = PIPE_HEADERBYTES;
+    break;
+
+  case PIPE_SEAL:
+    flen = s->len + 16;
+    s->buf[0] = flen >> 24;
+    s->buf[1] = flen >> 16;
+    s->buf[2] = flen >> 8;
+    s->buf[3] = flen;
+    xsalsa20poly1305_seal_detached(m,s->buf + 4,m,s->len,p->nonce,p->key);
+    pipe_incnonce(p->nonce);
+    s->off = 0;
+    s->len += PIPE_HEADERBYTES;
+    break;
+
+  case PIPE_OPEN:
+    if (xsalsa20poly1305_open_detached(m,m,s->buf + 4,s->len,
+                                       p->nonce,p->key) != 0)
+      return EBADMSG;
+    pipe_incnonce(p->nonce);
+    s->off = PIPE_HEADERBYTES;
+    break;
+  }
+  return 0;
+}
+
+static int
+pipe_write(struct pipe *p,struct pipe_slot *s)
+{
+  if (pipe_writeall(p->out_fd,s->buf + s->off,s->len) != 0) return errno;
+  p->total += s->len;
+  return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Driving the stages */
+
+static int
+pipe_serial(struct pipe *p)
+{
+  struct pipe_slot *s = &p->slot[0];
+  int r;
+
+  do {
+    if ((r = pipe_read(p,s)) != 0)  return r;
+    if ((r = pipe_crypt(p,s)) != 0) return r;
+    if ((r = pipe_write(p,s)) != 0) return r;
+  } while (!s->last);
+  return 0;
+}
+
+#ifndef _WIN32
+/* Buffer number seq can be reused once the writer is past it. The
+   threads can only be cancelled while they are blocked in I/O, never
+   while they hold the lock. */
+#define SLOT(p,seq)  (&(p)->slot[(seq) % PIPE_NBUFS])
+#define DONE(p,next) ((next) == (p)->end)
+
+static int
+pipe_cancellable(int (*stage)(struct pipe *,struct pipe_slot *),
+                 struct pipe *p,struct pipe_slot *s)
+{
+  int r,old;
+  pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,&old);
+  r = stage(p,s);
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,&old);
+  return r;
+}
+
+static void *
+pipe_reader(void *arg)
+{
+  struct pipe *p = arg;
+  struct pipe_slot *s;
+  int r,old;
+
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,&old);
+  pthread_mutex_lock(&p->lock);
+  while (!p->err && !DONE(p,p->nread)) {
+    if (p->nread - p->nwrite == PIPE_NBUFS) {
+      pthread_cond_wait(&p->cond,&p->lock);
+      continue;
+    }
+    s = SLOT(p,p->nread);
+    pthread_mutex_unlock(&p->lock);
+    r = pipe_cancellable(pipe_read,p,s);
+    pthread_mutex_lock(&p->lock);
+    if (r != 0) {
+      if (!p->err) p->err = r;
+    } else if (s->last) {
+      p->end = ++p->nread;
+    } else {
+      p->nread++;
+    }
+    pthread_cond_broadcast(&p->cond);
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+static void *
+pipe_writer(void *arg)
+{
+  struct pipe *p = arg;
+  struct pipe_slot *s;
+  int r,old;
+
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,&old);
+  pthread_mutex_lock(&p->lock);
+  while (!p->err && !DONE(p,p->nwrite)) {
+    if (p->nwrite == p->ncrypt) {
+      pthread_cond_wait(&p->cond,&p->lock);
+      continue;
+    }
+    s = SLOT(p,p->nwrite);
+    pthread_mutex_unlock(&p->lock);
+    r = pipe_cancellable(pipe_write,p,s);
+    pthread_mutex_lock(&p->lock);
+    if (r != 0) {
+      if (!p->err) p->err = r;
+    } else {
+      p->nwrite++;
+    }
+    pthread_cond_broadcast(&p->cond);
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+static int
+pipe_threaded(struct pipe *p)
+{
+  pthread_t reader,writer;
+  struct pipe_slot *s;
+  int r;
+
+  if (pthread_mutex_init(&p->lock,NULL) != 0) return pipe_serial(p);
+  if (pthread_cond_init(&p->cond,NULL) != 0) {
+    pthread_mutex_destroy(&p->lock);
+    return pipe_serial(p);
+  }
+  if (pthread_create(&reader,NULL,pipe_reader,p) != 0) {
+    r = pipe_serial(p);
+    goto out;
+  }
+  if ((r = pthread_create(&writer,NULL,pipe_writer,p)) != 0) {
+    pthread_mutex_lock(&p->lock);
+    p->err = r;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    pthread_cancel(reader);
+    pthread_join(reader,NULL);
+    goto out;
+  }
+
+  pthread_mutex_lock(&p->lock);
+  while (!p->err && !DONE(p,p->ncrypt)) {
+    if (p->ncrypt == p->nread) {
+      pthread_cond_wait(&p->cond,&p->lock);
+      continue;
+    }
+    s = SLOT(p,p->ncrypt);
+    pthread_mutex_unlock(&p->lock);
+    r = pipe_crypt(p,s);
+    pthread_mutex_lock(&p->lock);
+    if (r != 0) {
+      if (!p->err) p->err = r;
+    } else {
+      p->ncrypt++;
+    }
+    pthread_cond_broadcast(&p->cond);
+  }
+  r = p->err;
+  pthread_mutex_unlock(&p->lock);
+
+  /* On failure, don't wait for I/O which may never complete. */
+  if (r != 0) {
+    pthread_cancel(reader);
+    pthread_cancel(writer);
+  }
+  pthread_join(reader,NULL);
+  pthread_join(writer,NULL);
+  r = p->err;
+
+out:
+  pthread_cond_destroy(&p->cond);
+  pthread_mutex_destroy(&p->lock);
+  return r;
+}
+#endif /* _WIN32 */
+
+static long long
+pipe_run(int mode,int in_fd,int out_fd,
+         const unsigned char *n,const unsigned char *k)
+{
+  struct pipe *p;
+  long long total;
+  size_t i;
+  int r;
+
+  p = calloc(1,sizeof(struct pipe));
+  if (p == NULL) return -1;
+  p->mem = malloc(PIPE_NBUFS * PIPE_SLOTBYTES);
+  if (p->mem == NULL) {
+    free(p);
+    return -1;
+  }
+  for (i = 0; i < PIPE_NBUFS; ++i)
+    p->slot[i].buf = p->mem + i * PIPE_SLOTBYTES;
+
+  p->end    = ~0ULL;
+  p->mode   = mode;
+  p->in_fd  = in_fd;
+  p->out_fd = out_fd;
+  for (i = 0; i < 24; ++i) p->nonce[i] = n[i];
+  if (mode == PIPE_STREAM)
+    crypto_core_hsalsa20(p->key,n,k,sigma);
+  else
+    for (i = 0; i < 32; ++i) p->key[i] = k[i];
+
+#ifdef _WIN32
+  r = pipe_serial(p);
+#else
+#ifdef POSIX_FADV_SEQUENTIAL
+  (void) posix_fadvise(in_fd,0,0,POSIX_FADV_SEQUENTIAL);
+#endif
+  r = pipe_threaded(p);
+#endif
+
+  for (i = 0; i < PIPE_NBUFS * PIPE_SLOTBYTES; ++i) p->mem[i] = 0;
+  for (i = 0; i < 32; ++i) p->key[i] = 0;
+  free(p->mem);
+
+  if (r != 0) {
+    free(p);
+    errno = r;
+    return -1;
+  }
+  total = p->total;
+  free(p);
+  return total;
+}
+
+/* The input length is not known up front, so the entry probes below
+   carry a length of 0, and the return probes the number of bytes
+   read. */
+
+/* XOR everything from in_fd with the xsalsa20 stream for n and k. */
+long long
+nacl_pipe_stream_xor(int in_fd,int out_fd,
+                     const unsigned char *n,
+                     const unsigned char *k)
+{
+  long long r;
+  NACL_PROBE_ENTRY(nacl_pipe_stream_xor,0);
+  r = pipe_run(PIPE_STREAM,in_fd,out_fd,n,k);
+  NACL_PROBE_RETURN(nacl_pipe_stream_xor,r < 0 ? 0 : r,r < 0 ? -1 : 0);
+  return r;
+}
+
+/* Seal everything from in_fd into a stream of records. */
+long long
+nacl_pipe_secretbox_seal(int in_fd,int out_fd,
+                         const unsigned char *n,
+                         const unsigned char *k)
+{
+  long long r;
+  NACL_PROBE_ENTRY(nacl_pipe_secretbox_seal,0);
+  r = pipe_run(PIPE_SEAL,in_fd,out_fd,n,k);
+  NACL_PROBE_RETURN(nacl_pipe_secretbox_seal,r < 0 ? 0 : r,r < 0 ? -1 : 0);
+  return r;
+}
+
+/* Open a stream of records from in_fd. */
+long long
+nacl_pipe_secretbox_open(int in_fd,int out_fd,
+                         const unsigned char *n,
+                         const unsigned char *k)
+{
+  long long r;
+  NACL_PROBE_ENTRY(nacl_pipe_secretbox_open,0);
+  r = pipe_run(PIPE_OPEN,in_fd,out_fd,n,k);
+  NACL_PROBE_RETURN(nacl_pipe_secretbox_open,r < 0 ? 0 : r,r < 0 ? -1 : 0);
+  return r;
+}
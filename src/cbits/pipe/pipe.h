@@ -0,0 +1,22 @@
+#ifndef _PIPE_H_
+#define _PIPE_H_
+
+/* Size of every buffer in the pipeline, and the amount of plaintext
+   in every record of a sealed stream but the last. */
+#define PIPE_BUFBYTES    (256*1024)
+#define PIPE_NBUFS       4
+#define PIPE_HEADERBYTES 20
+
+long long nacl_pipe_stream_xor(int in_fd,int out_fd,
+                               const unsigned char *n,
+                               const unsigned char *k);
+
+long long nacl_pipe_secretbox_seal(int in_fd,int out_fd,
+                                   const unsigned char *n,
+                                   const unsigned char *k);
+
+long long nacl_pipe_secretbox_open(int in_fd,int out_fd,
+                                   const unsigned char *n,
+                                   const unsigned char *k);
+
+#endif /* _PIPE_H_ */
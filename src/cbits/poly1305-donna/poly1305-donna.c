@@ -1,4 +1,5 @@
 #include "poly1305-donna.h"
+#include "probes.h"
 
 #if defined(POLY1305_8BIT)
 #include "poly1305-donna-8.h"
@@ -63,16 +64,30 @@ poly1305_update(poly1305_context *ctx, const unsigned char *m, size_t bytes) {
 void
 poly1305_auth(unsigned char mac[16], const unsigned char *m, size_t bytes, const unsigned char key[32]) {
 	poly1305_context ctx;
+#ifndef PRIVATE_API
+	NACL_PROBE_ENTRY(poly1305_auth,bytes);
+#endif
 	poly1305_init(&ctx, key);
 	poly1305_update(&ctx, m, bytes);
 	poly1305_finish(&ctx, mac);
+#ifndef PRIVATE_API
+	NACL_PROBE_RETURN(poly1305_auth,bytes,0);
+#endif
 }
 
 int
 poly1305_auth_verify(const unsigned char mac1[16], const unsigned char *m, size_t bytes, const unsigned char key[32]) {
   unsigned char mac2[16];
+  int r;
+#ifndef PRIVATE_API
+  NACL_PROBE_ENTRY(poly1305_auth_verify,bytes);
+#endif
   poly1305_auth(mac2, m, bytes, key);
-  return (1 == poly1305_verify(mac1, mac2)) ? 0 : 1;
+  r = (1 == poly1305_verify(mac1, mac2)) ? 0 : 1;
+#ifndef PRIVATE_API
+  NACL_PROBE_RETURN(poly1305_auth_verify,bytes,r);
+#endif
+  return r;
 }
 
 int
@@ -0,0 +1,277 @@
+/*
+	poly1305 over many independent (key, message) pairs at once
+
+	poly1305_auth_many computes the authenticators of n messages, each
+	under its own one-time key: keys holds n 32 byte keys back to back,
+	and macs receives n 16 byte tags. poly1305_verify_many checks n tags
+	the same way, setting ok[i] to 1 or 0 and returning the number of
+	tags that verified.
+
+	With AVX2, four messages are processed at a time, one per 64 bit
+	lane, using the same 5x26 bit limbs as poly1305-donna-32. Messages
+	of different lengths are handled by masking out lanes whose message
+	has already ended. Without AVX2 this is just a loop over
+	poly1305_auth.
+*/
+
+#include "poly1305-many.h"
+#include "poly1305-donna.h"
+#include "probes.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include <stdint.h>
+
+#define POLY1305_LANES 4
+
+static uint32_t
+U8TO32_LE(const unsigned char *p) {
+	return
+		(((uint32_t)p[0]      ) |
+		 ((uint32_t)p[1] <<  8) |
+		 ((uint32_t)p[2] << 16) |
+		 ((uint32_t)p[3] << 24));
+}
+
+static void
+U32TO8_LE(unsigned char *p, uint32_t v) {
+	p[0] = (v      ) & 0xff;
+	p[1] = (v >>  8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+}
+
+/* authenticate up to four messages, one per lane */
+static void
+poly1305_auth_lanes(unsigned char *macs, const unsigned char * const *m,
+                    const size_t *bytes, const unsigned char *keys, size_t cnt) {
+	uint64_t r[5][POLY1305_LANES], h[5][POLY1305_LANES], t[5][POLY1305_LANES];
+	uint64_t active[POLY1305_LANES];
+	size_t blocks[POLY1305_LANES], maxblocks = 0, b, l, i;
+	unsigned char last[16];
+	const unsigned char *p;
+	__m256i R0, R1, R2, R3, R4, S1, S2, S3, S4;
+	__m256i H0, H1, H2, H3, H4;
+	const __m256i mask26 = _mm256_set1_epi64x(0x3ffffff);
+
+	for (l = 0; l < POLY1305_LANES; l++) {
+		const unsigned char *key = keys + 32 * l;
+		if (l < cnt) {
+			r[0][l] = (U8TO32_LE(&key[ 0])     ) & 0x3ffffff;
+			r[1][l] = (U8TO32_LE(&key[ 3]) >> 2) & 0x3ffff03;
+			r[2][l] = (U8TO32_LE(&key[ 6]) >> 4) & 0x3ffc0ff;
+			r[3][l] = (U8TO32_LE(&key[ 9]) >> 6) & 0x3f03fff;
+			r[4][l] = (U8TO32_LE(&key[12]) >> 8) & 0x00fffff;
+			blocks[l] = (bytes[l] + 15) / 16;
+		} else {
+			for (i = 0; i < 5; i++) r[i][l] = 0;
+			blocks[l] = 0;
+		}
+		if (blocks[l] > maxblocks) maxblocks = blocks[l];
+	}
+
+	R0 = _mm256_loadu_si256((const __m256i *)r[0]);
+	R1 = _mm256_loadu_si256((const __m256i *)r[1]);
+	R2 = _mm256_loadu_si256((const __m256i *)r[2]);
+	R3 = _mm256_loadu_si256((const __m256i *)r[3]);
+	R4 = _mm256_loadu_si256((const __m256i *)r[4]);
+	S1 = _mm256_add_epi64(R1, _mm256_slli_epi64(R1, 2));
+	S2 = _mm256_add_epi64(R2, _mm256_slli_epi64(R2, 2));
+	S3 = _mm256_add_epi64(R3, _mm256_slli_epi64(R3, 2));
+	S4 = _mm256_add_epi64(R4, _mm256_slli_epi64(R4, 2));
+
+	H0 = H1 = H2 = H3 = H4 = _mm256_setzero_si256();
+
+	for (b = 0; b < maxblocks; b++) {
+		__m256i A, D0, D1, D2, D3, D4, C, T0, T1, T2, T3, T4;
+
+		/* gather this block from every lane that still has one */
+		for (l = 0; l < POLY1305_LANES; l++) {
+			uint64_t hibit = 1 << 24;
+			if (b >= blocks[l]) {
+				for (i = 0; i < 5; i++) t[i][l] = 0;
+				active[l] = 0;
+				continue;
+			}
+			p = m[l] + 16 * b;
+			if (bytes[l] - 16 * b < 16) {
+				size_t left = bytes[l] - 16 * b;
+				for (i = 0; i < left; i++) last[i] = p[i];
+				last[i++] = 1;
+				for (; i < 16; i++) last[i] = 0;
+				p = last;
+				hibit = 0;
+			}
+			t[0][l] = (U8TO32_LE(p+ 0)     ) & 0x3ffffff;
+			t[1][l] = (U8TO32_LE(p+ 3) >> 2) & 0x3ffffff;
+			t[2][l] = (U8TO32_LE(p+ 6) >> 4) & 0x3ffffff;
+			t[3][l] = (U8TO32_LE(p+ 9) >> 6) & 0x3ffffff;
+			t[4][l] = (U8TO32_LE(p+12) >> 8) | hibit;
+			active[l] = ~(uint64_t)0;
+		}
+		A = _mm256_loadu_si256((const __m256i *)active);
+
+		/* h += m[i] */
+		T0 = _mm256_add_epi64(H0, _mm256_loadu_si256((const __m256i *)t[0]));
+		T1 = _mm256_add_epi64(H1, _mm256_loadu_si256((const __m256i *)t[1]));
+		T2 = _mm256_add_epi64(H2, _mm256_loadu_si256((const __m256i *)t[2]));
+		T3 = _mm256_add_epi64(H3, _mm256_loadu_si256((const __m256i *)t[3]));
+		T4 = _mm256_add_epi64(H4, _mm256_loadu_si256((const __m256i *)t[4]));
+
+		/* h *= r */
+		D0 = _mm256_add_epi64(
+		       _mm256_add_epi64(_mm256_mul_epu32(T0, R0), _mm256_mul_epu32(T1, S4)),
+		       _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(T2, S3), _mm256_mul_epu32(T3, S2)),
+		                        _mm256_mul_epu32(T4, S1)));
+		D1 = _mm256_add_epi64(
+		       _mm256_add_epi64(_mm256_mul_epu32(T0, R1), _mm256_mul_epu32(T1, R0)),
+		       _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(T2, S4), _mm256_mul_epu32(T3, S3)),
+		                        _mm256_mul_epu32(T4, S2)));
+		D2 = _mm256_add_epi64(
+		       _mm256_add_epi64(_mm256_mul_epu32(T0, R2), _mm256_mul_epu32(T1, R1)),
+		       _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(T2, R0), _mm256_mul_epu32(T3, S4)),
+		                        _mm256_mul_epu32(T4, S3)));
+		D3 = _mm256_add_epi64(
+		       _mm256_add_epi64(_mm256_mul_epu32(T0, R3), _mm256_mul_epu32(T1, R2)),
+		       _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(T2, R1), _mm256_mul_epu32(T3, R0)),
+		                        _mm256_mul_epu32(T4, S4)));
+		D4 = _mm256_add_epi64(
+		       _mm256_add_epi64(_mm256_mul_epu32(T0, R4), _mm256_mul_epu32(T1, R3)),
+		       _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(T2, R2), _mm256_mul_epu32(T3, R1)),
+		                        _mm256_mul_epu32(T4, R0)));
+
+		/* (partial) h %= p */
+		                               C = _mm256_srli_epi64(D0, 26); T0 = _mm256_and_si256(D0, mask26);
+		D1 = _mm256_add_epi64(D1, C);  C = _mm256_srli_epi64(D1, 26); T1 = _mm256_and_si256(D1, mask26);
+		D2 = _mm256_add_epi64(D2, C);  C = _mm256_srli_epi64(D2, 26); T2 = _mm256_and_si256(D2, mask26);
+		D3 = _mm256_add_epi64(D3, C);  C = _mm256_srli_epi64(D3, 26); T3 = _mm256_and_si256(D3, mask26);
+		D4 = _mm256_add_epi64(D4, C);  C = _mm256_srli_epi64(D4, 26); T4 = _mm256_and_si256(D4, mask26);
+		T0 = _mm256_add_epi64(T0, _mm256_add_epi64(C, _mm256_slli_epi64(C, 2)));
+		C  = _mm256_srli_epi64(T0, 26); T0 = _mm256_and_si256(T0, mask26);
+		T1 = _mm256_add_epi64(T1, C);
+
+		/* lanes whose message has ended keep their state */
+		H0 = _mm256_blendv_epi8(H0, T0, A);
+		H1 = _mm256_blendv_epi8(H1, T1, A);
+		H2 = _mm256_blendv_epi8(H2, T2, A);
+		H3 = _mm256_blendv_epi8(H3, T3, A);
+		H4 = _mm256_blendv_epi8(H4, T4, A);
+	}
+
+	_mm256_storeu_si256((__m256i *)h[0], H0);
+	_mm256_storeu_si256((__m256i *)h[1], H1);
+	_mm256_storeu_si256((__m256i *)h[2], H2);
+	_mm256_storeu_si256((__m256i *)h[3], H3);
+	_mm256_storeu_si256((__m256i *)h[4], H4);
+
+	for (l = 0; l < cnt; l++) {
+		const unsigned char *pad = keys + 32 * l + 16;
+		uint32_t h0 = h[0][l], h1 = h[1][l], h2 = h[2][l], h3 = h[3][l], h4 = h[4][l];
+		uint32_t g0, g1, g2, g3, g4, c, mask;
+		uint64_t f;
+
+		/* fully carry h */
+		             c = h1 >> 26; h1 = h1 & 0x3ffffff;
+		h2 +=     c; c = h2 >> 26; h2 = h2 & 0x3ffffff;
+		h3 +=     c; c = h3 >> 26; h3 = h3 & 0x3ffffff;
+		h4 +=     c; c = h4 >> 26; h4 = h4 & 0x3ffffff;
+		h0 += c * 5; c = h0 >> 26; h0 = h0 & 0x3ffffff;
+		h1 +=     c;
+
+		/* compute h + -p */
+		g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+		g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+		g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+		g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+		g4 = h4 + c - (1 << 26);
+
+		/* select h if h < p, or h + -p if h >= p */
+		mask = (g4 >> 31) - 1;
+		g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+		mask = ~mask;
+		h0 = (h0 & mask) | g0;
+		h1 = (h1 & mask) | g1;
+		h2 = (h2 & mask) | g2;
+		h3 = (h3 & mask) | g3;
+		h4 = (h4 & mask) | g4;
+
+		/* h = h % (2^128) */
+		h0 = ((h0      ) | (h1 << 26));
+		h1 = ((h1 >>  6) | (h2 << 20));
+		h2 = ((h2 >> 12) | (h3 << 14));
+		h3 = ((h3 >> 18) | (h4 <<  8));
+
+		/* mac = (h + pad) % (2^128) */
+		f = (uint64_t)h0 + U8TO32_LE(pad +  0)            ; h0 = (uint32_t)f;
+		f = (uint64_t)h1 + U8TO32_LE(pad +  4) + (f >> 32); h1 = (uint32_t)f;
+		f = (uint64_t)h2 + U8TO32_LE(pad +  8) + (f >> 32); h2 = (uint32_t)f;
+		f = (uint64_t)h3 + U8TO32_LE(pad + 12) + (f >> 32); h3 = (uint32_t)f;
+
+		U32TO8_LE(macs + 16 * l +  0, h0);
+		U32TO8_LE(macs + 16 * l +  4, h1);
+		U32TO8_LE(macs + 16 * l +  8, h2);
+		U32TO8_LE(macs + 16 * l + 12, h3);
+	}
+}
+
+static void
+auth_many(unsigned char *macs, const unsigned char * const *m,
+          const size_t *bytes, const unsigned char *keys, size_t n) {
+	unsigned char lastkeys[32 * POLY1305_LANES];
+	size_t i;
+
+	for (; n >= POLY1305_LANES; n -= POLY1305_LANES) {
+		poly1305_auth_lanes(macs, m, bytes, keys, POLY1305_LANES);
+		macs += 16 * POLY1305_LANES;
+		keys += 32 * POLY1305_LANES;
+		m += POLY1305_LANES;
+		bytes += POLY1305_LANES;
+	}
+
+	if (n) {
+		/* don't read past the end of the caller's key array */
+		for (i = 0; i < 32 * n; i++) lastkeys[i] = keys[i];
+		poly1305_auth_lanes(macs, m, bytes, lastkeys, n);
+		for (i = 0; i < sizeof(lastkeys); i++) lastkeys[i] = 0;
+	}
+}
+
+#else
+
+static void
+auth_many(unsigned char *macs, const unsigned char * const *m,
+          const size_t *bytes, const unsigned char *keys, size_t n) {
+	size_t i;
+	for (i = 0; i < n; i++)
+		poly1305_auth(macs + 16 * i, m[i], bytes[i], keys + 32 * i);
+}
+
+#endif
+
+void
+poly1305_auth_many(unsigned char *macs, const unsigned char * const *m,
+                   const size_t *bytes, const unsigned char *keys, size_t n) {
+	NACL_PROBE_ENTRY(poly1305_auth_many,n);
+	auth_many(macs, m, bytes, keys, n);
+	NACL_PROBE_RETURN(poly1305_auth_many,n,0);
+}
+
+size_t
+poly1305_verify_many(unsigned char *ok, const unsigned char *macs,
+                     const unsigned char * const *m, const size_t *bytes,
+                     const unsigned char *keys, size_t n) {
+	unsigned char mine[16 * 16];
+	size_t i, j, k, good = 0;
+
+	NACL_PROBE_ENTRY(poly1305_verify_many,n);
+	for (i = 0; i < n; i += k) {
+		k = (n - i < 16) ? n - i : 16;
+		auth_many(mine, m + i, bytes + i, keys + 32 * i, k);
+		for (j = 0; j < k; j++) {
+			ok[i + j] = (unsigned char)poly1305_verify(macs + 16 * (i + j), mine + 16 * j);
+			good += ok[i + j];
+		}
+	}
+	NACL_PROBE_RETURN(poly1305_verify_many,n,good);
+	return good;
+}
@@ -0,0 +1,14 @@
+#ifndef POLY1305_MANY_H
+#define POLY1305_MANY_H
+
+#include <stddef.h>
+
+void poly1305_auth_many(unsigned char *macs,
+                        const unsigned char * const *m, const size_t *bytes,
+                        const unsigned char *keys, size_t n);
+
+size_t poly1305_verify_many(unsigned char *ok, const unsigned char *macs,
+                            const unsigned char * const *m, const size_t *bytes,
+                            const unsigned char *keys, size_t n);
+
+#endif /* POLY1305_MANY_H */
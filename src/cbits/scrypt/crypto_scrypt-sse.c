@@ -41,11 +41,25 @@
 #include "sysendian.h"
 
 #include "crypto_scrypt.h"
+#include "probes.h"
+
+/*
+ * SCRYPT_PREFETCH: when nonzero, smix prefetches all of V_j as soon as j
+ * is known, rather than waiting for each cache line in turn to miss while
+ * it is being mixed in.  Build with -DSCRYPT_PREFETCH=0 (or configure with
+ * -f-scrypt-prefetch) to turn it off.
+ */
+#ifndef SCRYPT_PREFETCH
+#define SCRYPT_PREFETCH 1
+#endif
 
 static void blkcpy(void *, void *, size_t);
 static void blkxor(void *, void *, size_t);
+static void blkprefetch(void *, size_t);
 static void salsa20_8(__m128i *);
 static void blockmix_salsa8(__m128i *, __m128i *, __m128i *, size_t);
+static void blockmix_salsa8_xor(__m128i *, __m128i *, __m128i *, __m128i *,
+    size_t);
 static uint64_t integerify(void *, size_t);
 static void smix(uint8_t *, size_t, uint64_t, void *, void *);
 
@@ -73,6 +87,26 @@ blkxor(void * dest, void * src, size_t len)
 		D[i] = _mm_xor_si128(D[i], S[i]);
 }
 
+/**
+ * blkprefetch(src, len):
+ * Ask for the len bytes at the cache-line-aligned address src to be
+ * brought into the cache, if SCRYPT_PREFETCH is enabled.
+ */
+static void
+blkprefetch(void * src, size_t len)
+{
+#if SCRYPT_PREFETCH
+	char * S = src;
+	size_t i;
+
+	for (i = 0; i < len; i += 64)
+		_mm_prefetch(&S[i], _MM_HINT_T0);
+#else
+	(void)src;
+	(void)len;
+#endif
+}
+
 /**
  * salsa20_8(B):
  * Apply the salsa20/8 core to the provided block.
@@ -169,6 +203,45 @@ blockmix_salsa8(__m128i * Bin, __m128i * Bout, __m128i * X, size_t r)
 	}
 }
 
+/**
+ * blockmix_salsa8_xor(Bin1, Bin2, Bout, X, r):
+ * Compute Bout = BlockMix_{salsa20/8, r}(Bin1 xor Bin2), without writing
+ * Bin1 xor Bin2 out first.  Each 64-byte block of Bin2 is read only when
+ * it is mixed in, so fetching the later blocks overlaps with mixing the
+ * earlier ones.  The temporary space X must be 64 bytes.
+ */
+static void
+blockmix_salsa8_xor(__m128i * Bin1, __m128i * Bin2, __m128i * Bout,
+    __m128i * X, size_t r)
+{
+	size_t i;
+
+	/* 1: X <-- B_{2r - 1} */
+	blkcpy(X, &Bin1[8 * r - 4], 64);
+	blkxor(X, &Bin2[8 * r - 4], 64);
+
+	/* 2: for i = 0 to 2r - 1 do */
+	for (i = 0; i < r; i++) {
+		/* 3: X <-- H(X \xor B_i) */
+		blkxor(X, &Bin1[i * 8], 64);
+		blkxor(X, &Bin2[i * 8], 64);
+		salsa20_8(X);
+
+		/* 4: Y_i <-- X */
+		/* 6: B' <-- (Y_0, Y_2 ... Y_{2r-2}, Y_1, Y_3 ... Y_{2r-1}) */
+		blkcpy(&Bout[i * 4], X, 64);
+
+		/* 3: X <-- H(X \xor B_i) */
+		blkxor(X, &Bin1[i * 8 + 4], 64);
+		blkxor(X, &Bin2[i * 8 + 4], 64);
+		salsa20_8(X);
+
+		/* 4: Y_i <-- X */
+		/* 6: B' <-- (Y_0, Y_2 ... Y_{2r-2}, Y_1, Y_3 ... Y_{2r-1}) */
+		blkcpy(&Bout[(r + i) * 4], X, 64);
+	}
+}
+
 /**
  * integerify(B, r):
  * Return the result of parsing B_{2r-1} as a little-endian integer.
@@ -196,6 +269,7 @@ smix(uint8_t * B, size_t r, uint64_t N, void * V, void * XY)
 	__m128i * Y = (void *)((uintptr_t)(XY) + 128 * r);
 	__m128i * Z = (void *)((uintptr_t)(XY) + 256 * r);
 	uint32_t * X32 = (void *)X;
+	__m128i * Vj;
 	uint64_t i, j;
 	size_t k;
 
@@ -223,21 +297,34 @@ smix(uint8_t * B, size_t r, uint64_t N, void * V, void * XY)
 		blockmix_salsa8(Y, X, Z, r);
 	}
 
+	/*
+	 * X is kept in the shuffled word order which salsa20_8 works in, and
+	 * so is every V_i, so V_j can be mixed into X as it stands.  V_j is
+	 * prefetched as soon as j is known, and mixed in one 64-byte block
+	 * at a time by blockmix_salsa8_xor, so all of its cache lines are in
+	 * flight at once and most arrive while earlier ones are being mixed.
+	 */
+	j = integerify(X, r) & (N - 1);
+	Vj = (void *)((uintptr_t)(V) + j * 128 * r);
+	blkprefetch(Vj, 128 * r);
+
 	/* 6: for i = 0 to N - 1 do */
 	for (i = 0; i < N; i += 2) {
-		/* 7: j <-- Integerify(X) mod N */
-		j = integerify(X, r) & (N - 1);
-
 		/* 8: X <-- H(X \xor V_j) */
-		blkxor(X, (void *)((uintptr_t)(V) + j * 128 * r), 128 * r);
-		blockmix_salsa8(X, Y, Z, r);
+		blockmix_salsa8_xor(X, Vj, Y, Z, r);
 
 		/* 7: j <-- Integerify(X) mod N */
 		j = integerify(Y, r) & (N - 1);
+		Vj = (void *)((uintptr_t)(V) + j * 128 * r);
+		blkprefetch(Vj, 128 * r);
 
 		/* 8: X <-- H(X \xor V_j) */
-		blkxor(Y, (void *)((uintptr_t)(V) + j * 128 * r), 128 * r);
-		blockmix_salsa8(Y, X, Z, r);
+		blockmix_salsa8_xor(Y, Vj, X, Z, r);
+
+		/* 7: j <-- Integerify(X) mod N */
+		j = integerify(X, r) & (N - 1);
+		Vj = (void *)((uintptr_t)(V) + j * 128 * r);
+		blkprefetch(Vj, 128 * r);
 	}
 
 	/* 10: B' <-- X */
@@ -269,6 +356,8 @@ crypto_scrypt(const uint8_t * passwd, size_t passwdlen,
 	uint32_t * XY;
 	uint32_t i;
 
+	NACL_PROBE_ENTRY4(crypto_scrypt, passwdlen, N, r, p);
+
 	/* Sanity-check parameters. */
 #if SIZE_MAX > UINT32_MAX
 	if (buflen > (((uint64_t)(1) << 32) - 1) * 32) {
@@ -354,6 +443,7 @@ crypto_scrypt(const uint8_t * passwd, size_t passwdlen,
 	free(B0);
 
 	/* Success! */
+	NACL_PROBE_RETURN(crypto_scrypt, passwdlen, 0);
 	return (0);
 
 err2:
@@ -362,5 +452,6 @@ err1:
 	free(B0);
 err0:
 	/* Failure! */
+	NACL_PROBE_RETURN(crypto_scrypt, passwdlen, -1);
 	return (-1);
 }
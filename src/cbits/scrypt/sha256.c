@@ -352,6 +352,156 @@ scrypt_HMAC_SHA256_Final(unsigned char digest[32], scrypt_HMAC_SHA256_CTX * ctx)
 	memset(ihash, 0, 32);
 }
 
+#if defined(__GNUC__)
+/*
+ * Multi-buffer SHA-256: MB_LANES independent compressions at once, one
+ * per 32-bit vector lane (8 with AVX2, otherwise 4 with SSE2), using
+ * the same round macros as scrypt_SHA256_Transform.  This is used by
+ * scrypt_PBKDF2_SHA256 below, whose blocks are independent of each
+ * other.
+ */
+#define HAVE_SHA256_MB
+
+#if defined(__AVX2__)
+#define MB_LANES 8
+#else
+#define MB_LANES 4
+#endif
+
+typedef uint32_t mb_word __attribute__((vector_size(4 * MB_LANES)));
+
+static const uint32_t K256[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* Round j of the eight starting at round i, with a rotating state */
+#define RNDmb(S, W, i, j)			\
+	RND(S[(64 - j) % 8], S[(65 - j) % 8],	\
+	    S[(66 - j) % 8], S[(67 - j) % 8],	\
+	    S[(68 - j) % 8], S[(69 - j) % 8],	\
+	    S[(70 - j) % 8], S[(71 - j) % 8],	\
+	    W[i + j] + K256[i + j])
+
+static void
+scrypt_SHA256_Transform_mb(mb_word state[8], const mb_word block[16])
+{
+	mb_word W[64];
+	mb_word S[8];
+	mb_word t0, t1;
+	int i;
+
+	/* 1. Prepare message schedule W. */
+	memcpy(W, block, 16 * sizeof(mb_word));
+	for (i = 16; i < 64; i++)
+		W[i] = s1(W[i - 2]) + W[i - 7] + s0(W[i - 15]) + W[i - 16];
+
+	/* 2. Initialize working variables. */
+	memcpy(S, state, 8 * sizeof(mb_word));
+
+	/* 3. Mix. */
+	for (i = 0; i < 64; i += 8) {
+		RNDmb(S, W, i, 0);
+		RNDmb(S, W, i, 1);
+		RNDmb(S, W, i, 2);
+		RNDmb(S, W, i, 3);
+		RNDmb(S, W, i, 4);
+		RNDmb(S, W, i, 5);
+		RNDmb(S, W, i, 6);
+		RNDmb(S, W, i, 7);
+	}
+
+	/* 4. Mix local working variables into global state */
+	for (i = 0; i < 8; i++)
+		state[i] += S[i];
+
+	/* Clean the stack. */
+	memset(W, 0, sizeof(W));
+	memset(S, 0, sizeof(S));
+	t0 = t1 = (mb_word){ 0 };
+}
+
+/*
+ * Compute the PBKDF2 blocks T_{first+1} .. T_{first+n} for c = 1, one
+ * per lane, into out[32 * n]; n is at most MB_LANES.  Each block is
+ * HMAC(P, S || INT(i)), so every lane starts from the inner and outer
+ * midstates in PShctx and they differ only in the four bytes of INT(i).
+ */
+static void
+scrypt_PBKDF2_SHA256_mb(const scrypt_HMAC_SHA256_CTX * PShctx,
+    size_t first, size_t n, uint8_t * out)
+{
+	unsigned char tail[MB_LANES][128];
+	mb_word state[8];
+	mb_word block[16];
+	uint32_t r, count[2];
+	size_t tlen, b, j;
+	int k;
+
+	/*
+	 * The rest of each inner hash: the buffered end of S, INT(i), and
+	 * the padding, in one or two blocks.
+	 */
+	r = (PShctx->ictx.count[1] >> 3) & 0x3f;
+	tlen = (r + 4 + 9 <= 64) ? 64 : 128;
+	count[1] = PShctx->ictx.count[1] + 32;
+	count[0] = PShctx->ictx.count[0] + (count[1] < 32);
+	for (j = 0; j < MB_LANES; j++) {
+		memcpy(tail[j], PShctx->ictx.buf, r);
+		be32enc(&tail[j][r], (uint32_t)(first + j + 1));
+		memcpy(&tail[j][r + 4], PAD, tlen - 8 - r - 4);
+		be32enc_vect(&tail[j][tlen - 8], count, 8);
+	}
+
+	/* Inner hashes. */
+	for (k = 0; k < 8; k++)
+		state[k] = (mb_word){ 0 } + PShctx->ictx.state[k];
+	for (b = 0; b < tlen; b += 64) {
+		for (k = 0; k < 16; k++)
+			for (j = 0; j < MB_LANES; j++)
+				block[k][j] = be32dec(&tail[j][b + 4 * k]);
+		scrypt_SHA256_Transform_mb(state, block);
+	}
+
+	/*
+	 * Outer hashes: the inner hashes are exactly the first eight
+	 * words of the last block, after 64 bytes of key pad.
+	 */
+	for (k = 0; k < 8; k++) {
+		block[k] = state[k];
+		state[k] = (mb_word){ 0 } + PShctx->octx.state[k];
+	}
+	block[8] = (mb_word){ 0 } + 0x80000000;
+	for (k = 9; k < 15; k++)
+		block[k] = (mb_word){ 0 };
+	block[15] = (mb_word){ 0 } + (64 + 32) * 8;
+	scrypt_SHA256_Transform_mb(state, block);
+
+	for (j = 0; j < n; j++)
+		for (k = 0; k < 8; k++)
+			be32enc(&out[32 * j + 4 * k], state[k][j]);
+
+	/* Clean the stack. */
+	memset(tail, 0, sizeof(tail));
+	memset(block, 0, sizeof(block));
+	memset(state, 0, sizeof(state));
+}
+#endif /* __GNUC__ */
+
 /**
  * PBKDF2_SHA256(passwd, passwdlen, salt, saltlen, c, buf, dkLen):
  * Compute PBKDF2(passwd, salt, c, dkLen) using HMAC-SHA256 as the PRF, and
@@ -374,6 +524,25 @@ scrypt_PBKDF2_SHA256(const uint8_t * passwd, size_t passwdlen, const uint8_t * s
 	scrypt_HMAC_SHA256_Init(&PShctx, passwd, passwdlen);
 	scrypt_HMAC_SHA256_Update(&PShctx, salt, saltlen);
 
+#ifdef HAVE_SHA256_MB
+	/* With one iteration, compute MB_LANES blocks at a time. */
+	if (c == 1 && dkLen > 32) {
+		uint8_t TT[32 * MB_LANES];
+
+		for (i = 0; i * 32 < dkLen; i += MB_LANES) {
+			clen = dkLen - i * 32;
+			if (clen > 32 * MB_LANES)
+				clen = 32 * MB_LANES;
+			scrypt_PBKDF2_SHA256_mb(&PShctx, i, (clen + 31) / 32, TT);
+			memcpy(&buf[i * 32], TT, clen);
+		}
+
+		memset(TT, 0, sizeof(TT));
+		memset(&PShctx, 0, sizeof(scrypt_HMAC_SHA256_CTX));
+		return;
+	}
+#endif
+
 	/* Iterate through the blocks. */
 	for (i = 0; i * 32 < dkLen; i++) {
 		/* Generate INT(i + 1). */
@@ -315,7 +315,7 @@ get_cpuid(x86_regs *regs, uint32_t flags) {
 		a2(mov [%1 + 8], ecx)
 		a2(mov [%1 + 12], edx)
 		a1(pop cpuid_bx)
-		asm_gcc_parms() : "+a"(flags) : "S"(regs)  : "%ecx", "%edx", "cc"
+		asm_gcc_parms() : "+a"(flags) : "S"(regs)  : "%ecx", "%edx", "cc", "memory"
 	asm_gcc_end()
 #endif
 }
@@ -0,0 +1,15 @@
+/*
+	scrypt-jane instantiated with the chacha mix and blake512 PBKDF2. Each
+	mix/hash combination must live in its own translation unit; see
+	scrypt-jane-nacl.c for the dispatcher.
+*/
+
+#define SCRYPT_CHACHA
+#define SCRYPT_BLAKE512
+#define scrypt nacl_scrypt_jane_chacha_blake512
+#define scrypt_set_fatal_error nacl_scrypt_jane_chacha_blake512_set_fatal_error
+/* The BLAKE-512 tables are not static */
+#define blake512_sigma nacl_scrypt_jane_chacha_blake512_sigma
+#define blake512_constants nacl_scrypt_jane_chacha_blake512_constants
+
+#include "scrypt-jane.c"
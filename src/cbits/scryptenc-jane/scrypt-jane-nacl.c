@@ -0,0 +1,114 @@
+/*
+	Runtime selection between the scrypt-jane instances built by the
+	scrypt-jane-<mix>-<hash>.c files. Within each instance, the mix
+	implementation (AVX2/AVX/SSSE3/SSE2/portable) is itself chosen at
+	runtime from cpuid.
+
+	scrypt-jane exits the process on any error, so out-of-range
+	parameters are checked here first and rejected with -1 instead.
+	Errors which can't be checked for up front (running out of memory,
+	or a failed power-on self test) go to a fatal error hook which
+	longjmps back here, and are also reported as -1. A self test
+	failure disables that instance for good.
+*/
+
+#include <setjmp.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "scrypt-jane-nacl.h"
+#include "probes.h"
+
+typedef void (*nacl_scrypt_jane_fn)(const unsigned char *, size_t,
+                                    const unsigned char *, size_t,
+                                    unsigned char, unsigned char, unsigned char,
+                                    unsigned char *, size_t);
+
+#define INSTANCE(mix,hash) \
+  void nacl_scrypt_jane_##mix##_##hash(const unsigned char *, size_t, \
+                                       const unsigned char *, size_t, \
+                                       unsigned char, unsigned char, unsigned char, \
+                                       unsigned char *, size_t); \
+  void nacl_scrypt_jane_##mix##_##hash##_set_fatal_error(void (*)(const char *));
+INSTANCE(chacha,sha512)
+INSTANCE(chacha,blake512)
+INSTANCE(chacha,skein512)
+INSTANCE(chacha,keccak512)
+INSTANCE(salsa64,sha512)
+INSTANCE(salsa64,blake512)
+INSTANCE(salsa64,skein512)
+INSTANCE(salsa64,keccak512)
+#undef INSTANCE
+
+static const nacl_scrypt_jane_fn instances[2][4] = {
+  { nacl_scrypt_jane_chacha_sha512,  nacl_scrypt_jane_chacha_blake512,
+    nacl_scrypt_jane_chacha_skein512,  nacl_scrypt_jane_chacha_keccak512 },
+  { nacl_scrypt_jane_salsa64_sha512, nacl_scrypt_jane_salsa64_blake512,
+    nacl_scrypt_jane_salsa64_skein512, nacl_scrypt_jane_salsa64_keccak512 },
+};
+
+typedef void (*nacl_scrypt_jane_hook_fn)(void (*)(const char *));
+
+static const nacl_scrypt_jane_hook_fn hooks[2][4] = {
+  { nacl_scrypt_jane_chacha_sha512_set_fatal_error,
+    nacl_scrypt_jane_chacha_blake512_set_fatal_error,
+    nacl_scrypt_jane_chacha_skein512_set_fatal_error,
+    nacl_scrypt_jane_chacha_keccak512_set_fatal_error },
+  { nacl_scrypt_jane_salsa64_sha512_set_fatal_error,
+    nacl_scrypt_jane_salsa64_blake512_set_fatal_error,
+    nacl_scrypt_jane_salsa64_skein512_set_fatal_error,
+    nacl_scrypt_jane_salsa64_keccak512_set_fatal_error },
+};
+
+/* Chunks are capped at 32KB: r = 2^8 for 64 byte blocks, 2^7 for 128 */
+static const unsigned char max_rfactor[2] = { 8, 7 };
+static const unsigned int block_bytes[2] = { 64, 128 };
+
+/* Where the fatal error hook returns to, for the call on this thread */
+static __thread jmp_buf *fatal_jmp;
+static __thread int fatal_post;
+static volatile int broken[2][4];
+
+static void fatal_error(const char *msg)
+{
+  fatal_post = strstr(msg, "self") != NULL;
+  longjmp(*fatal_jmp, 1);
+}
+
+int nacl_scrypt_jane(int mix, int hash,
+                     const unsigned char *password, size_t password_len,
+                     const unsigned char *salt, size_t salt_len,
+                     unsigned char Nfactor, unsigned char rfactor,
+                     unsigned char pfactor,
+                     unsigned char *out, size_t bytes)
+{
+  jmp_buf env;
+  uint64_t chunk;
+  int r = -1;
+
+  NACL_PROBE_ENTRY4(nacl_scrypt_jane, password_len, Nfactor, rfactor, pfactor);
+  if (mix < 0 || mix > 1 || hash < 0 || hash > 3 ||
+      Nfactor > 30 || rfactor > max_rfactor[mix] || pfactor > 25 ||
+      broken[mix][hash])
+    goto done;
+
+  /* scrypt-jane sizes its p + 1 working chunks with 32-bit arithmetic */
+  chunk = (uint64_t)block_bytes[mix] * 2 << rfactor;
+  if ((((uint64_t)1 << pfactor) + 1) * chunk > UINT32_MAX)
+    goto done;
+
+  fatal_jmp = &env;
+  hooks[mix][hash](fatal_error);
+  if (setjmp(env) == 0) {
+    instances[mix][hash](password, password_len, salt, salt_len,
+                         Nfactor, rfactor, pfactor, out, bytes);
+    r = 0;
+  } else if (fatal_post) {
+    broken[mix][hash] = 1;
+  }
+  fatal_jmp = NULL;
+
+done:
+  NACL_PROBE_RETURN(nacl_scrypt_jane, password_len, r);
+  return r;
+}
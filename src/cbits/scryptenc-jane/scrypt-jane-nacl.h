@@ -0,0 +1,23 @@
+#ifndef _SCRYPT_JANE_NACL_H_
+#define _SCRYPT_JANE_NACL_H_
+
+#include <stddef.h>
+
+/* Mix functions */
+#define NACL_SCRYPT_JANE_CHACHA   0 /* ChaCha20/8, 64 byte blocks */
+#define NACL_SCRYPT_JANE_SALSA64  1 /* Salsa6420/8, 128 byte blocks */
+
+/* PBKDF2 hash functions */
+#define NACL_SCRYPT_JANE_SHA512    0
+#define NACL_SCRYPT_JANE_BLAKE512  1
+#define NACL_SCRYPT_JANE_SKEIN512  2
+#define NACL_SCRYPT_JANE_KECCAK512 3
+
+int nacl_scrypt_jane(int mix, int hash,
+                     const unsigned char *password, size_t password_len,
+                     const unsigned char *salt, size_t salt_len,
+                     unsigned char Nfactor, unsigned char rfactor,
+                     unsigned char pfactor,
+                     unsigned char *out, size_t bytes);
+
+#endif /* _SCRYPT_JANE_NACL_H_ */
@@ -0,0 +1,12 @@
+/*
+	scrypt-jane instantiated with the salsa64 mix and keccak512 PBKDF2. Each
+	mix/hash combination must live in its own translation unit; see
+	scrypt-jane-nacl.c for the dispatcher.
+*/
+
+#define SCRYPT_SALSA64
+#define SCRYPT_KECCAK512
+#define scrypt nacl_scrypt_jane_salsa64_keccak512
+#define scrypt_set_fatal_error nacl_scrypt_jane_salsa64_keccak512_set_fatal_error
+
+#include "scrypt-jane.c"
@@ -0,0 +1,12 @@
+/*
+	scrypt-jane instantiated with the salsa64 mix and skein512 PBKDF2. Each
+	mix/hash combination must live in its own translation unit; see
+	scrypt-jane-nacl.c for the dispatcher.
+*/
+
+#define SCRYPT_SALSA64
+#define SCRYPT_SKEIN512
+#define scrypt nacl_scrypt_jane_salsa64_skein512
+#define scrypt_set_fatal_error nacl_scrypt_jane_salsa64_skein512_set_fatal_error
+
+#include "scrypt-jane.c"
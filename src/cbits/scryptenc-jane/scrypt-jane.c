@@ -6,6 +6,15 @@
 
 #include <string.h>
 
+/*
+	nacl: the cpuid vendor check is only informational, and the nop
+	romix helper is unused by the instances which convert endianness.
+*/
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
 #include "scrypt-jane.h"
 #include "code/scrypt-jane-portable.h"
 #include "code/scrypt-jane-hash.h"
@@ -160,8 +169,12 @@ scrypt(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t
 	p = (1 << pfactor);
 
 	chunk_bytes = SCRYPT_BLOCK_BYTES * r * 2;
-	V = scrypt_alloc((uint64_t)N * chunk_bytes);
-	YX = scrypt_alloc((p + 1) * chunk_bytes);
+	/*
+		nacl: V and YX share one allocation, so a failure (which longjmps
+		out through the fatal error hook) can never leak the other.
+	*/
+	V = scrypt_alloc(((uint64_t)N + p + 1) * chunk_bytes);
+	YX.ptr = V.ptr + (size_t)N * chunk_bytes;
 
 	/* 1: X = PBKDF2(password, salt) */
 	Y = YX.ptr;
@@ -178,5 +191,4 @@ scrypt(const uint8_t *password, size_t password_len, const uint8_t *salt, size_t
 	scrypt_ensure_zero(YX.ptr, (p + 1) * chunk_bytes);
 
 	scrypt_free(&V);
-	scrypt_free(&YX);
 }
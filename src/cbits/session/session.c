@@ -0,0 +1,132 @@
+#include "session.h"
+#include "probes.h"
+
+#define PRIVATE_API
+#include "../xsalsa20poly1305/xsalsa20poly1305.c"
+#undef PRIVATE_API
+
+/*
+ * Record framing for Crypto.Session.
+ *
+ * Every record is sent as
+ *
+ *   length (4 bytes, big endian) || tag (16 bytes) || ciphertext
+ *
+ * where length counts the tag and ciphertext, and the tag and
+ * ciphertext are exactly those of crypto_secretbox under the session
+ * key. The nonce is owned by the caller; its last 8 bytes are a big
+ * endian record counter which is bumped after every record, so both
+ * directions stay in lock step without sending nonces on the wire.
+ */
+
+static void
+session_incnonce(unsigned char *nonce)
+{
+  int i;
+  for (i = 23; i >= 16; --i)
+    if (++nonce[i] != 0) break;
+}
+
+/* Seal n records, whose plaintexts are concatenated in m, into out
+   (which must have room for the plaintexts plus SESSION_HEADERBYTES
+   per record.) Returns -1 without sealing anything, or touching the
+   nonce, if any record is too large. */
+static int
+session_seal(unsigned char *out,
+             const unsigned char *m,
+             const unsigned long long *lens,unsigned long long n,
+             unsigned char *nonce,
+             const unsigned char *k)
+{
+  unsigned long long i,len,flen;
+
+  for (i = 0; i < n; ++i)
+    if (lens[i] > SESSION_MAXRECORD) return -1;
+
+  for (i = 0; i < n; ++i) {
+    len = lens[i];
+    flen = len + 16;
+
+    out[0] = flen >> 24;
+    out[1] = flen >> 16;
+    out[2] = flen >> 8;
+    out[3] = flen;
+    xsalsa20poly1305_seal_detached(out + SESSION_HEADERBYTES,out + 4,
+                                   m,len,nonce,k);
+    session_incnonce(nonce);
+
+    out += SESSION_HEADERBYTES + len;
+    m   += len;
+  }
+  return 0;
+}
+
+int
+nacl_session_seal(unsigned char *out,
+                  const unsigned char *m,
+                  const unsigned long long *lens,unsigned long long n,
+                  unsigned char *nonce,
+                  const unsigned char *k)
+{
+  int r;
+  NACL_PROBE_ENTRY(nacl_session_seal,n);
+  r = session_seal(out,m,lens,n,nonce,k);
+  NACL_PROBE_RETURN(nacl_session_seal,n,r);
+  return r;
+}
+
+/* Open as many complete records as there are in the input (up to
+   maxn), writing the plaintexts back to back into out (which must be
+   at least inlen bytes) and their lengths into lens. Returns the
+   number of records opened and sets *consumed to the number of input
+   bytes they used; any partial record at the end is left for the next
+   call. Returns -1 if a record fails to authenticate or is too
+   large. */
+static long long
+session_open(unsigned char *out,
+             unsigned long long *lens,unsigned long long maxn,
+             const unsigned char *in,unsigned long long inlen,
+             unsigned long long *consumed,
+             unsigned char *nonce,
+             const unsigned char *k)
+{
+  unsigned long long n = 0, off = 0, flen;
+
+  *consumed = 0;
+  while (n < maxn && inlen - off >= 4) {
+    flen = ((unsigned long long)in[off]   << 24) |
+           ((unsigned long long)in[off+1] << 16) |
+           ((unsigned long long)in[off+2] << 8)  |
+            (unsigned long long)in[off+3];
+    if (flen < 16 || flen > SESSION_MAXRECORD + 16) return -1;
+    if (inlen - off - 4 < flen) break;
+
+    if (xsalsa20poly1305_open_detached(out,in + off + SESSION_HEADERBYTES,
+                                       in + off + 4,flen - 16,
+                                       nonce,k) != 0)
+      return -1;
+    session_incnonce(nonce);
+
+    lens[n++] = flen - 16;
+    out += flen - 16;
+    off += 4 + flen;
+  }
+
+  *consumed = off;
+  return n;
+}
+
+long long
+nacl_session_open(unsigned char *out,
+                  unsigned long long *lens,unsigned long long maxn,
+                  const unsigned char *in,unsigned long long inlen,
+                  unsigned long long *consumed,
+                  unsigned char *nonce,
+                  const unsigned char *k)
+{
+  long long r;
+  NACL_PROBE_ENTRY(nacl_session_open,inlen);
+  r = session_open(out,lens,maxn,in,inlen,consumed,nonce,k);
+  NACL_PROBE_RETURN(nacl_session_open,inlen,r);
+  return r;
+}
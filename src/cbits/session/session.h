@@ -0,0 +1,20 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+#define SESSION_HEADERBYTES 20
+#define SESSION_MAXRECORD   (16*1024*1024)
+
+int nacl_session_seal(unsigned char *out,
+                      const unsigned char *m,
+                      const unsigned long long *lens,unsigned long long n,
+                      unsigned char *nonce,
+                      const unsigned char *k);
+
+long long nacl_session_open(unsigned char *out,
+                            unsigned long long *lens,unsigned long long maxn,
+                            const unsigned char *in,unsigned long long inlen,
+                            unsigned long long *consumed,
+                            unsigned char *nonce,
+                            const unsigned char *k);
+
+#endif /* _SESSION_H_ */
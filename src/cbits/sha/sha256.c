@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include "sha256.h"
+#include "probes.h"
 
 static inline
 uint32_t load_bigendian(const unsigned char *x)
@@ -224,7 +225,7 @@ static const char iv[32] = {
   0x5b,0xe0,0xcd,0x19,
 } ;
 
-int sha256(unsigned char *out,const unsigned char *in,unsigned long long inlen)
+static int hash(unsigned char *out,const unsigned char *in,unsigned long long inlen)
 {
   unsigned char h[32];
   unsigned char padded[128];
@@ -269,3 +270,12 @@ int sha256(unsigned char *out,const unsigned char *in,unsigned long long inlen)
 
   return 0;
 }
+
+int sha256(unsigned char *out,const unsigned char *in,unsigned long long inlen)
+{
+  int r;
+  NACL_PROBE_ENTRY(sha256,inlen);
+  r = hash(out,in,inlen);
+  NACL_PROBE_RETURN(sha256,inlen,r);
+  return r;
+}
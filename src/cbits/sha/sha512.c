@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include "sha512.h"
+#include "probes.h"
 
 static inline
 uint64_t load_bigendian(const unsigned char *x)
@@ -251,7 +252,7 @@ static const unsigned char iv[64] = {
   0x5b,0xe0,0xcd,0x19,0x13,0x7e,0x21,0x79
 } ;
 
-int sha512(unsigned char *out,const unsigned char *in,unsigned long long inlen)
+static int hash(unsigned char *out,const unsigned char *in,unsigned long long inlen)
 {
   unsigned char h[64];
   unsigned char padded[256];
@@ -298,3 +299,12 @@ int sha512(unsigned char *out,const unsigned char *in,unsigned long long inlen)
 
   return 0;
 }
+
+int sha512(unsigned char *out,const unsigned char *in,unsigned long long inlen)
+{
+  int r;
+  NACL_PROBE_ENTRY(sha512,inlen);
+  r = hash(out,in,inlen);
+  NACL_PROBE_RETURN(sha512,inlen,r);
+  return r;
+}
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "siphash2448.h"
+#include "probes.h"
 
 typedef  uint8_t  u8;
 typedef uint32_t u32;
@@ -26,23 +27,6 @@ int crypto_verify_8(const unsigned char *x,const unsigned char *y)
 
 #define rotl64(x, c) ( ((x) << (c)) ^ ((x) >> (64-(c))) )
 
-static inline
-u64 siphash(const u8 key[16], const unsigned char *m, const u64 n,
-            const size_t rounds, const size_t finalrounds)
-{
-	u64 v0, v1, v2, v3;
-	u64 k0, k1;
-	u64 mi, mask, len;
-	size_t i, k;
-
-	k0 = *((u64*)(key + 0));
-	k1 = *((u64*)(key + 8));
-
-	v0 = k0 ^ 0x736f6d6570736575ULL;
-	v1 = k1 ^ 0x646f72616e646f6dULL;
-	v2 = k0 ^ 0x6c7967656e657261ULL;
-	v3 = k1 ^ 0x7465646279746573ULL;
-
 #define HALF_ROUND(a,b,c,d,s,t) \
 	do \
 	{ \
@@ -60,6 +44,23 @@ u64 siphash(const u8 key[16], const unsigned char *m, const u64 n,
 		v2 = rotl64(v2, 32); \
 	} while(0)
 
+static inline
+u64 siphash(const u8 key[16], const unsigned char *m, const u64 n,
+            const size_t rounds, const size_t finalrounds)
+{
+	u64 v0, v1, v2, v3;
+	u64 k0, k1;
+	u64 mi, len;
+	size_t i, k;
+
+	k0 = *((u64*)(key + 0));
+	k1 = *((u64*)(key + 8));
+
+	v0 = k0 ^ 0x736f6d6570736575ULL;
+	v1 = k1 ^ 0x646f72616e646f6dULL;
+	v2 = k0 ^ 0x6c7967656e657261ULL;
+	v3 = k1 ^ 0x7465646279746573ULL;
+
 	for(i = 0; i < (n-n%8); i += 8)
 	{
 		mi = *((u64*)(m + i));
@@ -68,10 +69,10 @@ u64 siphash(const u8 key[16], const unsigned char *m, const u64 n,
 		v0 ^= mi;
 	}
 
-	mi = *((u64*)(m + i));
+	/* the last n%8 bytes, without reading past the end of m */
 	len = (n&0xff) << 56;
-	mask = n%8 == 0 ? 0 : 0xffffffffffffffffULL >> (8*(8-n%8));
-	mi = (mi&mask) ^ len;
+	for(mi = 0, k = 0; k < n%8; ++k) mi |= (u64)m[i+k] << (8*k);
+	mi ^= len;
 
 	v3 ^= mi;
 	for(k = 0; k < rounds; ++k) COMPRESS(v0,v1,v2,v3);
@@ -80,8 +81,6 @@ u64 siphash(const u8 key[16], const unsigned char *m, const u64 n,
 	v2 ^= 0xff;
 	for(k = 0; k < finalrounds; ++k) COMPRESS(v0,v1,v2,v3);
 
-#undef COMPRESS
-#undef HALF_ROUND
 	return (v0 ^ v1) ^ (v2 ^ v3);
 }
 
@@ -94,8 +93,10 @@ int siphash24_mac(unsigned char *out,const unsigned char *in,
     u8  bytes[8];
     u64 gpr;
   } hash;
+  NACL_PROBE_ENTRY(siphash24_mac,inlen);
   hash.gpr = siphash(k, in, inlen, 2, 4);
   for(i=0; i < 8; ++i) out[i] = hash.bytes[i];
+  NACL_PROBE_RETURN(siphash24_mac,inlen,0);
   return 0;
 }
 
@@ -104,8 +105,12 @@ int siphash24_mac_verify(const unsigned char *h,const unsigned char *in,
                          unsigned long long inlen,const unsigned char *k)
 {
   u8 correct[8];
+  int r;
+  NACL_PROBE_ENTRY(siphash24_mac_verify,inlen);
   siphash24_mac(correct,in,inlen,k);
-  return crypto_verify_8(h,correct);
+  r = crypto_verify_8(h,correct);
+  NACL_PROBE_RETURN(siphash24_mac_verify,inlen,r);
+  return r;
 }
 
 int siphash48_mac(unsigned char *out,const unsigned char *in,
@@ -117,8 +122,10 @@ int siphash48_mac(unsigned char *out,const unsigned char *in,
     u8  bytes[8];
     u64 gpr;
   } hash;
+  NACL_PROBE_ENTRY(siphash48_mac,inlen);
   hash.gpr = siphash(k, in, inlen, 4, 8);
   for(i=0; i < 8; ++i) out[i] = hash.bytes[i];
+  NACL_PROBE_RETURN(siphash48_mac,inlen,0);
   return 0;
 }
 
@@ -126,6 +133,283 @@ int siphash48_mac_verify(const unsigned char *h,const unsigned char *in,
                          unsigned long long inlen,const unsigned char *k)
 {
   u8 correct[8];
+  int r;
+  NACL_PROBE_ENTRY(siphash48_mac_verify,inlen);
   siphash48_mac(correct,in,inlen,k);
-  return crypto_verify_8(h,correct);
+  r = crypto_verify_8(h,correct);
+  NACL_PROBE_RETURN(siphash48_mac_verify,inlen,r);
+  return r;
 }
+
+/*
+ * Shard placement (Crypto.Hash.Placement)
+ *
+ * Every key is hashed with siphash24 under the placement key. For
+ * jump consistent hashing, that hash is the seed of Lamping and
+ * Veach's jump function. For rendezvous hashing, the weight of node
+ * i is siphash24 of the 16 bytes h || s_i, where h is the hash of the
+ * key and s_i is the hash of the node's name, and the node with the
+ * greatest weight wins (the first one, in case of ties).
+ *
+ * With AVX2, both hash four messages at a time with 4-lane vectors
+ * where they can: runs of four keys of equal length, and groups of
+ * four nodes. Anything else, and everything without AVX2 (where the
+ * vectors are split in two and lose to the scalar code), goes
+ * through siphash() one message at a time.
+ */
+
+#if defined(__AVX2__)
+#define SIPHASH_X4
+#endif
+
+static inline u64 load64(const unsigned char *p, size_t n)
+{
+  u64 x = 0;
+  size_t i;
+  for (i = 0; i < n; ++i) x |= (u64)p[i] << (8*i);
+  return x;
+}
+
+#define SIP_BLOCK(v0,v1,v2,v3,mi) \
+  do { \
+    v3 ^= mi; \
+    COMPRESS(v0,v1,v2,v3); COMPRESS(v0,v1,v2,v3); \
+    v0 ^= mi; \
+  } while(0)
+
+#define SIP_FINAL(v0,v1,v2,v3) \
+  do { \
+    v2 ^= 0xff; \
+    COMPRESS(v0,v1,v2,v3); COMPRESS(v0,v1,v2,v3); \
+    COMPRESS(v0,v1,v2,v3); COMPRESS(v0,v1,v2,v3); \
+  } while(0)
+
+#if defined(SIPHASH_X4)
+typedef u64 u64x4 __attribute__ ((vector_size (32)));
+
+/* siphash24 of four messages of n bytes each, without reading past
+   the end of any of them. */
+static inline void
+siphash24_x4(u64 out[4], const unsigned char *m[4], u64 n, const u8 key[16])
+{
+  u64 k0 = load64(key, 8), k1 = load64(key + 8, 8);
+  u64x4 v0 = { 0,0,0,0 }, v1 = v0, v2 = v0, v3 = v0, mi, r;
+  u64 i, j;
+
+  v0 += k0 ^ 0x736f6d6570736575ULL;
+  v1 += k1 ^ 0x646f72616e646f6dULL;
+  v2 += k0 ^ 0x6c7967656e657261ULL;
+  v3 += k1 ^ 0x7465646279746573ULL;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    for (j = 0; j < 4; ++j) mi[j] = load64(m[j] + i, 8);
+    SIP_BLOCK(v0,v1,v2,v3,mi);
+  }
+  for (j = 0; j < 4; ++j) mi[j] = load64(m[j] + i, n - i) ^ ((n & 0xff) << 56);
+  SIP_BLOCK(v0,v1,v2,v3,mi);
+  SIP_FINAL(v0,v1,v2,v3);
+
+  r = (v0 ^ v1) ^ (v2 ^ v3);
+  for (j = 0; j < 4; ++j) out[j] = r[j];
+}
+
+/* siphash24 of the 16 bytes a || b[j], for four values of b. */
+static inline void
+siphash24_16_x4(u64 out[4], u64 a, const u64 b[4], u64 k0, u64 k1)
+{
+  u64x4 v0 = { 0,0,0,0 }, v1 = v0, v2 = v0, v3 = v0, mi = v0, r;
+  u64 j;
+
+  v0 += k0 ^ 0x736f6d6570736575ULL;
+  v1 += k1 ^ 0x646f72616e646f6dULL;
+  v2 += k0 ^ 0x6c7967656e657261ULL;
+  v3 += k1 ^ 0x7465646279746573ULL;
+
+  mi += a;
+  SIP_BLOCK(v0,v1,v2,v3,mi);
+  for (j = 0; j < 4; ++j) mi[j] = b[j];
+  SIP_BLOCK(v0,v1,v2,v3,mi);
+  mi = (u64x4){ 0,0,0,0 } + ((u64)16 << 56);
+  SIP_BLOCK(v0,v1,v2,v3,mi);
+  SIP_FINAL(v0,v1,v2,v3);
+
+  r = (v0 ^ v1) ^ (v2 ^ v3);
+  for (j = 0; j < 4; ++j) out[j] = r[j];
+}
+#endif
+
+static inline u64
+siphash24_16(u64 a, u64 b, u64 k0, u64 k1)
+{
+  u64 v0 = k0 ^ 0x736f6d6570736575ULL;
+  u64 v1 = k1 ^ 0x646f72616e646f6dULL;
+  u64 v2 = k0 ^ 0x6c7967656e657261ULL;
+  u64 v3 = k1 ^ 0x7465646279746573ULL;
+  u64 mi = (u64)16 << 56;
+
+  SIP_BLOCK(v0,v1,v2,v3,a);
+  SIP_BLOCK(v0,v1,v2,v3,b);
+  SIP_BLOCK(v0,v1,v2,v3,mi);
+  SIP_FINAL(v0,v1,v2,v3);
+  return (v0 ^ v1) ^ (v2 ^ v3);
+}
+
+/* Hash the n keys concatenated in m, with lengths lens, into h. */
+static void
+siphash24_many(u64 *h, const unsigned char *m,
+               const unsigned long long *lens, unsigned long long n,
+               const unsigned char *k)
+{
+  unsigned long long i = 0;
+#if defined(SIPHASH_X4)
+  const unsigned char *p[4];
+  unsigned long long j;
+#endif
+
+  while (i < n) {
+#if defined(SIPHASH_X4)
+    if (i + 4 <= n && lens[i] == lens[i+1] &&
+        lens[i] == lens[i+2] && lens[i] == lens[i+3]) {
+      for (j = 0; j < 4; ++j) p[j] = m + j*lens[i];
+      siphash24_x4(h + i, p, lens[i], k);
+      m += 4*lens[i];
+      i += 4;
+      continue;
+    }
+#endif
+    h[i] = siphash(k, m, lens[i], 2, 4);
+    m += lens[i];
+    i += 1;
+  }
+}
+
+/* Lamping and Veach, "A Fast, Minimal Memory, Consistent Hash
+   Algorithm", 2014. */
+static inline unsigned int
+jump_consistent(u64 key, unsigned int buckets)
+{
+  long long b = -1, j = 0;
+  while (j < buckets) {
+    b = j;
+    key = key * 2862933555777941757ULL + 1;
+    j = (b + 1) * ((double)(1LL << 31) / (double)((key >> 33) + 1));
+  }
+  return b;
+}
+
+/* Place n keys (concatenated in m, with lengths lens) into buckets
+   buckets, writing bucket numbers to out. */
+static void jump_many(unsigned int *out,const unsigned char *m,
+                      const unsigned long long *lens,unsigned long long n,
+                      unsigned int buckets,const unsigned char *k)
+{
+  u64 h[64];
+  unsigned long long i, c;
+
+  if (buckets == 0) buckets = 1;
+  while (n > 0) {
+    c = n < 64 ? n : 64;
+    siphash24_many(h, m, lens, c, k);
+    for (i = 0; i < c; ++i) {
+      out[i] = jump_consistent(h[i], buckets);
+      m += lens[i];
+    }
+    out += c; lens += c; n -= c;
+  }
+}
+
+void siphash24_jump_many(unsigned int *out,const unsigned char *m,
+                         const unsigned long long *lens,unsigned long long n,
+                         unsigned int buckets,const unsigned char *k)
+{
+  NACL_PROBE_ENTRY(siphash24_jump_many,n);
+  jump_many(out,m,lens,n,buckets,k);
+  NACL_PROBE_RETURN(siphash24_jump_many,n,0);
+}
+
+/* Hash nnodes node names (concatenated in m, with lengths lens) into
+   8 byte seeds for siphash24_rendezvous_many. */
+static void node_seeds(unsigned char *seeds,const unsigned char *m,
+                       const unsigned long long *lens,unsigned long long n,
+                       const unsigned char *k)
+{
+  u64 h[64];
+  unsigned long long i, c;
+  int b;
+
+  while (n > 0) {
+    c = n < 64 ? n : 64;
+    siphash24_many(h, m, lens, c, k);
+    for (i = 0; i < c; ++i) {
+      for (b = 0; b < 8; ++b) seeds[8*i + b] = h[i] >> (8*b);
+      m += lens[i];
+    }
+    seeds += 8*c; lens += c; n -= c;
+  }
+}
+
+void siphash24_node_seeds(unsigned char *seeds,const unsigned char *m,
+                          const unsigned long long *lens,unsigned long long n,
+                          const unsigned char *k)
+{
+  NACL_PROBE_ENTRY(siphash24_node_seeds,n);
+  node_seeds(seeds,m,lens,n,k);
+  NACL_PROBE_RETURN(siphash24_node_seeds,n,0);
+}
+
+/* Place n keys (concatenated in m, with lengths lens) onto the nodes
+   with the given seeds, writing node numbers to out. */
+static void rendezvous_many(unsigned int *out,const unsigned char *m,
+                            const unsigned long long *lens,
+                            unsigned long long n,
+                            const unsigned char *seeds,unsigned int nnodes,
+                            const unsigned char *k)
+{
+  u64 h[64], w[4], best;
+  u64 k0 = load64(k, 8), k1 = load64(k + 8, 8);
+  unsigned long long i, c;
+  unsigned int node, win;
+#if defined(SIPHASH_X4)
+  u64 s[4];
+  unsigned int j;
+#endif
+
+  while (n > 0) {
+    c = n < 64 ? n : 64;
+    siphash24_many(h, m, lens, c, k);
+    for (i = 0; i < c; ++i) {
+      best = 0; win = 0; node = 0;
+#if defined(SIPHASH_X4)
+      for (; node + 4 <= nnodes; node += 4) {
+        for (j = 0; j < 4; ++j) s[j] = load64(seeds + 8*(node + j), 8);
+        siphash24_16_x4(w, h[i], s, k0, k1);
+        for (j = 0; j < 4; ++j)
+          if (w[j] > best || (node + j) == 0) { best = w[j]; win = node + j; }
+      }
+#endif
+      for (; node < nnodes; ++node) {
+        w[0] = siphash24_16(h[i], load64(seeds + 8*node, 8), k0, k1);
+        if (w[0] > best || node == 0) { best = w[0]; win = node; }
+      }
+      out[i] = win;
+      m += lens[i];
+    }
+    out += c; lens += c; n -= c;
+  }
+}
+
+void siphash24_rendezvous_many(unsigned int *out,const unsigned char *m,
+                               const unsigned long long *lens,
+                               unsigned long long n,
+                               const unsigned char *seeds,unsigned int nnodes,
+                               const unsigned char *k)
+{
+  NACL_PROBE_ENTRY(siphash24_rendezvous_many,n);
+  rendezvous_many(out,m,lens,n,seeds,nnodes,k);
+  NACL_PROBE_RETURN(siphash24_rendezvous_many,n,0);
+}
+
+#undef SIP_FINAL
+#undef SIP_BLOCK
+#undef COMPRESS
+#undef HALF_ROUND
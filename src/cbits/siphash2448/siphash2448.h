@@ -11,4 +11,16 @@ int siphash48_mac(unsigned char *out,const unsigned char *in,
 int siphash48_mac_verify(const unsigned char *h,const unsigned char *in,
                          unsigned long long inlen,const unsigned char *k);
 
+void siphash24_jump_many(unsigned int *out,const unsigned char *m,
+                         const unsigned long long *lens,unsigned long long n,
+                         unsigned int buckets,const unsigned char *k);
+void siphash24_node_seeds(unsigned char *seeds,const unsigned char *m,
+                          const unsigned long long *lens,unsigned long long n,
+                          const unsigned char *k);
+void siphash24_rendezvous_many(unsigned int *out,const unsigned char *m,
+                               const unsigned long long *lens,
+                               unsigned long long n,
+                               const unsigned char *seeds,unsigned int nnodes,
+                               const unsigned char *k);
+
 #endif /* _SIPHASH2448_H_ */
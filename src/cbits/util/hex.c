@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include "hex.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/*
+ * Hex encoding/decoding for keys, nonces and signatures.
+ *
+ * nacl_hex_encode writes 2*len lowercase hex digits for len input
+ * bytes. nacl_hex_decode reads len hex digits (len must be even,
+ * either case is accepted) and writes len/2 bytes, returning -1 if
+ * any digit is invalid.
+ *
+ * The vector paths are picked at compile time (we build with
+ * -march=native); the scalar loops handle the tail and everything
+ * else.
+ */
+
+static const unsigned char hexdigits[16] = "0123456789abcdef";
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+static inline __m128i
+hex_encode_nibbles_128(__m128i x)
+{
+  const __m128i lut = _mm_loadu_si128((const __m128i *)hexdigits);
+  return _mm_shuffle_epi8(lut, x);
+}
+
+/* 16 hex digits -> 16 nibbles; *ok is cleared if any digit is invalid */
+static inline __m128i
+hex_decode_nibbles_128(__m128i c, int *ok)
+{
+  const __m128i l = _mm_or_si128(c, _mm_set1_epi8(0x20));
+  const __m128i digit =
+    _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                  _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+  const __m128i alpha =
+    _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)),
+                  _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), l));
+
+  if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff) *ok = 0;
+
+  return _mm_or_si128(
+    _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+    _mm_and_si128(alpha, _mm_sub_epi8(l, _mm_set1_epi8('a' - 10))));
+}
+#endif
+
+#if defined(__AVX2__)
+static inline __m256i
+hex_decode_nibbles_256(__m256i c, int *ok)
+{
+  const __m256i l = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+  const __m256i digit =
+    _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+  const __m256i alpha =
+    _mm256_and_si256(_mm256_cmpgt_epi8(l, _mm256_set1_epi8('a' - 1)),
+                     _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), l));
+
+  if (_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) != -1) *ok = 0;
+
+  return _mm256_or_si256(
+    _mm256_and_si256(digit, _mm256_sub_epi8(c, _mm256_set1_epi8('0'))),
+    _mm256_and_si256(alpha, _mm256_sub_epi8(l, _mm256_set1_epi8('a' - 10))));
+}
+#endif
+
+static inline int
+hex_value(unsigned char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+void
+nacl_hex_encode(unsigned char *out, const unsigned char *in, size_t len)
+{
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  {
+    const __m256i lut =
+      _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hexdigits));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    for (; i + 32 <= len; i += 32) {
+      __m256i x  = _mm256_loadu_si256((const __m256i *)(in + i));
+      __m256i hi = _mm256_shuffle_epi8(lut,
+                     _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+      __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, mask));
+      __m256i a  = _mm256_unpacklo_epi8(hi, lo);
+      __m256i b  = _mm256_unpackhi_epi8(hi, lo);
+
+      _mm256_storeu_si256((__m256i *)(out + 2*i),
+                          _mm256_permute2x128_si256(a, b, 0x20));
+      _mm256_storeu_si256((__m256i *)(out + 2*i + 32),
+                          _mm256_permute2x128_si256(a, b, 0x31));
+    }
+  }
+#endif
+#if defined(__AVX2__) || defined(__SSSE3__)
+  {
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    for (; i + 16 <= len; i += 16) {
+      __m128i x  = _mm_loadu_si128((const __m128i *)(in + i));
+      __m128i hi = hex_encode_nibbles_128(
+                     _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+      __m128i lo = hex_encode_nibbles_128(_mm_and_si128(x, mask));
+
+      _mm_storeu_si128((__m128i *)(out + 2*i), _mm_unpacklo_epi8(hi, lo));
+      _mm_storeu_si128((__m128i *)(out + 2*i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+  }
+#endif
+
+  for (; i < len; ++i) {
+    out[2*i]   = hexdigits[in[i] >> 4];
+    out[2*i+1] = hexdigits[in[i] & 0x0f];
+  }
+}
+
+int
+nacl_hex_decode(unsigned char *out, const unsigned char *in, size_t len)
+{
+  size_t i = 0;
+  int ok = 1;
+
+  if (len & 1) return -1;
+
+#if defined(__AVX2__)
+  {
+    const __m256i pairs = _mm256_set1_epi16(0x0110);
+
+    for (; i + 64 <= len; i += 64) {
+      __m256i a = hex_decode_nibbles_256(
+                    _mm256_loadu_si256((const __m256i *)(in + i)), &ok);
+      __m256i b = hex_decode_nibbles_256(
+                    _mm256_loadu_si256((const __m256i *)(in + i + 32)), &ok);
+      __m256i r = _mm256_packus_epi16(_mm256_maddubs_epi16(a, pairs),
+                                      _mm256_maddubs_epi16(b, pairs));
+
+      _mm256_storeu_si256((__m256i *)(out + i/2),
+                          _mm256_permute4x64_epi64(r, 0xd8));
+    }
+  }
+#endif
+#if defined(__AVX2__) || defined(__SSSE3__)
+  {
+    const __m128i pairs = _mm_set1_epi16(0x0110);
+
+    for (; i + 32 <= len; i += 32) {
+      __m128i a = hex_decode_nibbles_128(
+                    _mm_loadu_si128((const __m128i *)(in + i)), &ok);
+      __m128i b = hex_decode_nibbles_128(
+                    _mm_loadu_si128((const __m128i *)(in + i + 16)), &ok);
+
+      _mm_storeu_si128((__m128i *)(out + i/2),
+                       _mm_packus_epi16(_mm_maddubs_epi16(a, pairs),
+                                        _mm_maddubs_epi16(b, pairs)));
+    }
+  }
+#endif
+
+  for (; i < len; i += 2) {
+    int hi = hex_value(in[i]);
+    int lo = hex_value(in[i+1]);
+    if ((hi | lo) < 0) return -1;
+    out[i/2] = (unsigned char)((hi << 4) | lo);
+  }
+
+  return ok ? 0 : -1;
+}
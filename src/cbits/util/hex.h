@@ -0,0 +1,9 @@
+#ifndef _HEX_H_
+#define _HEX_H_
+
+#include <stddef.h>
+
+void nacl_hex_encode(unsigned char *, const unsigned char *, size_t);
+int  nacl_hex_decode(unsigned char *, const unsigned char *, size_t);
+
+#endif /* _HEX_H_ */
@@ -0,0 +1,42 @@
+#ifndef _PROBES_H_
+#define _PROBES_H_
+
+/*
+ * USDT (statically defined tracing) probes, for perf, bpftrace and
+ * SystemTap. They are compiled in only when NACL_USDT is defined (the
+ * 'usdt' cabal flag), which needs <sys/sdt.h> from systemtap-sdt-dev.
+ * Otherwise they expand to nothing.
+ *
+ * When compiled in, a probe nobody is tracing costs a single NOP: the
+ * arguments live in registers or on the stack already, and sys/sdt.h
+ * only records where, in an ELF note.
+ *
+ * Every instrumented function has a pair of probes in the 'nacl'
+ * provider:
+ *
+ *   <name>__entry(size_t len, ...)
+ *   <name>__return(size_t len, int result)
+ *
+ * where len is the length of the main input. For example:
+ *
+ *   bpftrace -e 'usdt:./libnacl.so:nacl:ed25519_sign_open__return
+ *                { @[arg1] = hist(arg0); }'
+ */
+
+#ifdef NACL_USDT
+#include <stddef.h>
+#include <sys/sdt.h>
+
+#define NACL_PROBE_ENTRY(name,len) \
+  DTRACE_PROBE1(nacl,name##__entry,(size_t)(len))
+#define NACL_PROBE_ENTRY4(name,len,a,b,c) \
+  DTRACE_PROBE4(nacl,name##__entry,(size_t)(len),a,b,c)
+#define NACL_PROBE_RETURN(name,len,r) \
+  DTRACE_PROBE2(nacl,name##__return,(size_t)(len),(int)(r))
+#else
+#define NACL_PROBE_ENTRY(name,len)
+#define NACL_PROBE_ENTRY4(name,len,a,b,c)
+#define NACL_PROBE_RETURN(name,len,r)
+#endif
+
+#endif /* _PROBES_H_ */
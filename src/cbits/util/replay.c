@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+
+/*
+ * An anti-replay sliding window over 64-bit message counters, in the
+ * style of IPsec (RFC 6479) and WireGuard, which any number of threads
+ * can check counters against at once without taking a lock.
+ *
+ * A counter is accepted if it is no more than `window' behind the
+ * highest counter accepted so far (`top'), and has not been accepted
+ * before. The bitmap is a ring of slots, each covering a block of 16
+ * consecutive counters: the low 16 bits of a slot are the bits for
+ * its counters, and the high 48 bits say which block (counter >> 4)
+ * they belong to. Bits and block are updated together with one
+ * compare-and-swap, so a slot only ever moves on to newer blocks, and
+ * a counter's bit can only be set once:
+ *
+ *   - if the slot is empty, it is claimed for the counter's block;
+ *   - if the slot holds the counter's block, the bit is set, unless it
+ *     already was (a replay);
+ *   - if it holds an older block, that block has left the window, and
+ *     the slot is reset to the counter's block with just its bit set;
+ *   - if it holds a newer block, the counter has left the window.
+ *
+ * A slot in use always has at least one bit set, so a slot with none
+ * is empty, whatever its block says: nacl_replay_init starts every
+ * slot empty by zeroing it, and empty slots are never compared by
+ * block.
+ *
+ * There are enough slots that every block within `window' of `top'
+ * has one to itself. `top' is raised after the slot is updated; it
+ * only decides what is too old, so it does not matter if another
+ * thread sees it late. Block numbers in occupied slots are compared
+ * modulo 2^48, which is only ambiguous for counters more than 2^51
+ * apart.
+ */
+
+#define SLOT_BITS  16
+#define SLOT_SHIFT 4
+#define TAG_SHIFT  16
+#define BITS_MASK  (((uint64_t)1 << SLOT_BITS) - 1)
+
+struct replay_window {
+  uint64_t top;
+  uint64_t window;
+  uint64_t mask;         /* number of slots - 1 */
+  uint64_t pad[5];       /* keep top off the slots' cache lines */
+  uint64_t slot[];
+};
+
+static uint64_t
+replay_slots(uint64_t window)
+{
+  uint64_t need = (window + SLOT_BITS - 1) / SLOT_BITS + 1, n = 2;
+  while (n < need) n <<= 1;
+  return n;
+}
+
+size_t
+nacl_replay_bytes(uint64_t window)
+{
+  return sizeof(struct replay_window) + replay_slots(window) * sizeof(uint64_t);
+}
+
+void
+nacl_replay_init(void *p, uint64_t window)
+{
+  struct replay_window *w = p;
+  /* all-zero slots have no bits set, so they start out empty */
+  memset(w, 0, nacl_replay_bytes(window));
+  w->window = window;
+  w->mask = replay_slots(window) - 1;
+}
+
+/* Mark ctr as seen if it is fresh, given a recent value of top. */
+static inline int
+replay_mark(struct replay_window *w, uint64_t top, uint64_t ctr)
+{
+  const uint64_t block = ctr >> SLOT_SHIFT;
+  const uint64_t bit = (uint64_t)1 << (ctr & (SLOT_BITS - 1));
+  const uint64_t tag = block << TAG_SHIFT;
+  uint64_t *slot = &w->slot[block & w->mask];
+  uint64_t old, new;
+
+  if (top >= w->window && ctr <= top - w->window) return -1;
+
+  old = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+  do {
+    if ((old & BITS_MASK) == 0) {
+      new = tag | bit;
+    } else if ((old >> TAG_SHIFT) == (block & (~(uint64_t)0 >> TAG_SHIFT))) {
+      if (old & bit) return -1;
+      new = old | bit;
+    } else if ((int64_t)(tag - (old & ~(uint64_t)0 << TAG_SHIFT)) > 0) {
+      new = tag | bit;
+    } else {
+      return -1;
+    }
+  } while (!__atomic_compare_exchange_n(slot, &old, new, 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+  return 0;
+}
+
+static inline void
+replay_raise(struct replay_window *w, uint64_t top, uint64_t ctr)
+{
+  while (ctr > top &&
+         !__atomic_compare_exchange_n(&w->top, &top, ctr, 1,
+                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    ;
+}
+
+/* Returns 0 if ctr is fresh (and marks it seen), -1 otherwise. */
+int
+nacl_replay_check(void *p, uint64_t ctr)
+{
+  struct replay_window *w = p;
+  uint64_t top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+
+  if (replay_mark(w, top, ctr) != 0) return -1;
+  replay_raise(w, top, ctr);
+  return 0;
+}
+
+/* Check n counters in order, writing 1 to ok[i] for each fresh one
+   and 0 for the rest. The shared top is raised once, at the end. */
+void
+nacl_replay_check_many(void *p, unsigned char *ok,
+                       const uint64_t *ctrs, size_t n)
+{
+  struct replay_window *w = p;
+  uint64_t top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE), hi = top;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    ok[i] = replay_mark(w, hi, ctrs[i]) == 0;
+    if (ok[i] && ctrs[i] > hi) hi = ctrs[i];
+  }
+  replay_raise(w, top, hi);
+}
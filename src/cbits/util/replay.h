@@ -0,0 +1,12 @@
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+size_t nacl_replay_bytes(uint64_t);
+void   nacl_replay_init(void *, uint64_t);
+int    nacl_replay_check(void *, uint64_t);
+void   nacl_replay_check_many(void *, unsigned char *, const uint64_t *, size_t);
+
+#endif /* _REPLAY_H_ */
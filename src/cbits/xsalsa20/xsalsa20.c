@@ -1,4 +1,5 @@
 #include "xsalsa20.h"
+#include "probes.h"
 
 static const unsigned char sigma[16] = "expand 32-byte k";
 
@@ -289,8 +290,12 @@ int xsalsa20_stream_xor(
 )
 {
   unsigned char subkey[32];
+  int r;
+  NACL_PROBE_ENTRY(xsalsa20_stream_xor,mlen);
   crypto_core_hsalsa20(subkey,n,k,sigma);
-  return crypto_stream_salsa20_xor(c,m,mlen,n + 16,subkey);
+  r = crypto_stream_salsa20_xor(c,m,mlen,n + 16,subkey);
+  NACL_PROBE_RETURN(xsalsa20_stream_xor,mlen,r);
+  return r;
 }
 
 int xsalsa20_stream(
@@ -300,6 +305,10 @@ int xsalsa20_stream(
 )
 {
   unsigned char subkey[32];
+  int r;
+  NACL_PROBE_ENTRY(xsalsa20_stream,clen);
   crypto_core_hsalsa20(subkey,n,k,sigma);
-  return crypto_stream_salsa20(c,clen,n + 16,subkey);
+  r = crypto_stream_salsa20(c,clen,n + 16,subkey);
+  NACL_PROBE_RETURN(xsalsa20_stream,clen,r);
+  return r;
 }
@@ -1,8 +1,28 @@
 #include "xsalsa20poly1305.h"
+#include "probes.h"
+#include "../poly1305-donna/poly1305-many.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* Keep everything static when this file is itself included privately. */
+#ifdef PRIVATE_API
+#include "../poly1305-donna/poly1305-donna.c"
+#else
 #define PRIVATE_API
 #include "../poly1305-donna/poly1305-donna.c"
 #undef PRIVATE_API
+#endif
+
+struct xsalsa20poly1305_seal_state {
+  poly1305_context mac;
+  unsigned char subkey[32];
+  unsigned char n[8];
+  unsigned char block[64];      /* current keystream block */
+  unsigned int used;            /* bytes of block already used */
+  unsigned long long ic;        /* number of the next block */
+};
 
 static const unsigned char sigma[16] = "expand 32-byte k";
 
@@ -285,6 +305,48 @@ static int crypto_stream_salsa20_xor(
   return 0;
 }
 
+/* like crypto_stream_salsa20_xor, but starting at block ic */
+static int crypto_stream_salsa20_xor_ic(
+        unsigned char *c,
+  const unsigned char *m,unsigned long long mlen,
+  const unsigned char *n,
+  unsigned long long ic,
+  const unsigned char *k
+)
+{
+  unsigned char in[16];
+  unsigned char block[64];
+  int i;
+  unsigned int u;
+
+  if (!mlen) return 0;
+
+  for (i = 0;i < 8;++i) in[i] = n[i];
+  for (i = 8;i < 16;++i) { in[i] = ic & 0xff; ic >>= 8; }
+
+  while (mlen >= 64) {
+    crypto_core_salsa20(block,in,k,sigma);
+    for (i = 0;i < 64;++i) c[i] = m[i] ^ block[i];
+
+    u = 1;
+    for (i = 8;i < 16;++i) {
+      u += (unsigned int) in[i];
+      in[i] = u;
+      u >>= 8;
+    }
+
+    mlen -= 64;
+    c += 64;
+    m += 64;
+  }
+
+  if (mlen) {
+    crypto_core_salsa20(block,in,k,sigma);
+    for (i = 0;i < mlen;++i) c[i] = m[i] ^ block[i];
+  }
+  return 0;
+}
+
 static int xsalsa20_stream_xor(
         unsigned char *c,
   const unsigned char *m,unsigned long long mlen,
@@ -319,10 +381,15 @@ int xsalsa20poly1305_secretbox(
 )
 {
   int i;
-  if (mlen < 32) return -1;
+  NACL_PROBE_ENTRY(xsalsa20poly1305_secretbox,mlen);
+  if (mlen < 32) {
+    NACL_PROBE_RETURN(xsalsa20poly1305_secretbox,mlen,-1);
+    return -1;
+  }
   xsalsa20_stream_xor(c,m,mlen,n,k);
   poly1305_auth(c + 16,c + 32,mlen - 32,c);
   for (i = 0;i < 16;++i) c[i] = 0;
+  NACL_PROBE_RETURN(xsalsa20poly1305_secretbox,mlen,0);
   return 0;
 }
 
@@ -338,10 +405,587 @@ int xsalsa20poly1305_secretbox_open(
 {
   int i;
   unsigned char subkey[32];
-  if (clen < 32) return -1;
+  NACL_PROBE_ENTRY(xsalsa20poly1305_secretbox_open,clen);
+  if (clen < 32) {
+    NACL_PROBE_RETURN(xsalsa20poly1305_secretbox_open,clen,-1);
+    return -1;
+  }
   xsalsa20_stream(subkey,32,n,k);
-  if (poly1305_auth_verify(c + 16,c + 32,clen - 32,subkey) != 0) return -1;
+  if (poly1305_auth_verify(c + 16,c + 32,clen - 32,subkey) != 0) {
+    NACL_PROBE_RETURN(xsalsa20poly1305_secretbox_open,clen,-1);
+    return -1;
+  }
   xsalsa20_stream_xor(m,c,clen,n,k);
   for (i = 0;i < 32;++i) m[i] = 0;
+  NACL_PROBE_RETURN(xsalsa20poly1305_secretbox_open,clen,0);
   return 0;
 }
+
+/*
+ * Detached variants of the above: the same ciphertext and tag as
+ * xsalsa20poly1305_secretbox, but without the 32 bytes of zero
+ * padding on input or output, so callers can seal straight into a
+ * larger buffer. c may equal m. Sealing is only needed by the files
+ * which include this one privately.
+ */
+
+#ifdef PRIVATE_API
+static void xsalsa20poly1305_seal_detached(
+  unsigned char *c,
+  unsigned char *mac,
+  const unsigned char *m,unsigned long long mlen,
+  const unsigned char *n,
+  const unsigned char *k
+)
+{
+  unsigned char subkey[32];
+  unsigned char in[16];
+  unsigned char block0[64];
+  unsigned long long i;
+
+  crypto_core_hsalsa20(subkey,n,k,sigma);
+  for (i = 0;i < 8;++i) in[i] = n[16 + i];
+  for (i = 8;i < 16;++i) in[i] = 0;
+  crypto_core_salsa20(block0,in,subkey,sigma);
+
+  for (i = 0;i < mlen && i < 32;++i) c[i] = m[i] ^ block0[32 + i];
+  if (mlen > 32)
+    crypto_stream_salsa20_xor_ic(c + 32,m + 32,mlen - 32,n + 16,1,subkey);
+
+  poly1305_auth(mac,c,mlen,block0);
+
+  for (i = 0;i < 64;++i) block0[i] = 0;
+  for (i = 0;i < 32;++i) subkey[i] = 0;
+}
+#endif
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_open_detached(
+  unsigned char *m,
+  const unsigned char *c,
+  const unsigned char *mac,
+  unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *k
+)
+{
+  unsigned char subkey[32];
+  unsigned char in[16];
+  unsigned char block0[64];
+  unsigned long long i;
+  int r = -1;
+
+  NACL_PROBE_ENTRY(xsalsa20poly1305_open_detached,clen);
+  crypto_core_hsalsa20(subkey,n,k,sigma);
+  for (i = 0;i < 8;++i) in[i] = n[16 + i];
+  for (i = 8;i < 16;++i) in[i] = 0;
+  crypto_core_salsa20(block0,in,subkey,sigma);
+
+  if (poly1305_auth_verify(mac,c,clen,block0) == 0) {
+    for (i = 0;i < clen && i < 32;++i) m[i] = c[i] ^ block0[32 + i];
+    if (clen > 32)
+      crypto_stream_salsa20_xor_ic(m + 32,c + 32,clen - 32,n + 16,1,subkey);
+    r = 0;
+  }
+
+  for (i = 0;i < 64;++i) block0[i] = 0;
+  for (i = 0;i < 32;++i) subkey[i] = 0;
+  NACL_PROBE_RETURN(xsalsa20poly1305_open_detached,clen,r);
+  return r;
+}
+
+/*
+ * Key rotation: turn the 16 byte tag and clen - 16 bytes of
+ * ciphertext in c (as returned by Crypto.Encrypt.SecretBox.encrypt)
+ * under (on,ok) into the same under (nn,nk), without ever computing
+ * the plaintext.
+ *
+ * The old tag is checked first. Then every 64 bytes of ciphertext are
+ * XORed with the old and new keystream blocks at once, and the new
+ * tag is accumulated over the result a chunk at a time, while it is
+ * still in cache. out may equal c; it is untouched if the old tag is
+ * wrong.
+ */
+
+#define RESEAL_CHUNK 4096
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_reseal(
+  unsigned char *out,
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *on,
+  const unsigned char *ok,
+  const unsigned char *nn,
+  const unsigned char *nk
+)
+{
+  unsigned char osub[32], nsub[32];
+  unsigned char oblock0[64], nblock0[64];
+  unsigned char oin[16], nin[16];
+  unsigned char ks[128];
+  poly1305_context st;
+  unsigned long long i, j, mlen, len, off, ic;
+  int r = -1;
+
+  NACL_PROBE_ENTRY(xsalsa20poly1305_reseal,clen);
+  if (clen < 16) goto done;
+  mlen = clen - 16;
+
+  crypto_core_hsalsa20(osub,on,ok,sigma);
+  for (i = 0;i < 8;++i) oin[i] = on[16 + i];
+  for (i = 8;i < 16;++i) oin[i] = 0;
+  crypto_core_salsa20(oblock0,oin,osub,sigma);
+  if (poly1305_auth_verify(c,c + 16,mlen,oblock0) != 0) goto wipe;
+
+  crypto_core_hsalsa20(nsub,nn,nk,sigma);
+  for (i = 0;i < 8;++i) nin[i] = nn[16 + i];
+  for (i = 8;i < 16;++i) nin[i] = 0;
+  crypto_core_salsa20(nblock0,nin,nsub,sigma);
+  poly1305_init(&st,nblock0);
+
+  /* The first 32 bytes use the rest of block 0... */
+  len = mlen < 32 ? mlen : 32;
+  for (i = 0;i < len;++i)
+    out[16 + i] = c[16 + i] ^ oblock0[32 + i] ^ nblock0[32 + i];
+  poly1305_update(&st,out + 16,len);
+
+  /* ...and everything after that starts at block 1. */
+  for (off = 32, ic = 1;off < mlen;off += len) {
+    len = mlen - off < RESEAL_CHUNK ? mlen - off : RESEAL_CHUNK;
+    for (j = 0;j < len;j += 64, ++ic) {
+      for (i = 0;i < 8;++i) oin[8 + i] = nin[8 + i] = ic >> (8 * i);
+      crypto_core_salsa20(ks,oin,osub,sigma);
+      crypto_core_salsa20(ks + 64,nin,nsub,sigma);
+      for (i = 0;i < 64 && j + i < len;++i)
+        out[16 + off + j + i] = c[16 + off + j + i] ^ ks[i] ^ ks[64 + i];
+    }
+    poly1305_update(&st,out + 16 + off,len);
+  }
+
+  poly1305_finish(&st,out);
+  r = 0;
+
+wipe:
+  for (i = 0;i < 128;++i) ks[i] = 0;
+  for (i = 0;i < 64;++i) oblock0[i] = nblock0[i] = 0;
+  for (i = 0;i < 32;++i) osub[i] = nsub[i] = 0;
+done:
+  NACL_PROBE_RETURN(xsalsa20poly1305_reseal,clen,r);
+  return r;
+}
+
+/*
+ * Reseal n ciphertexts, concatenated in c with lengths lens, into
+ * out, with nonces on[24*i] and nn[24*i] for the ith. ok[i] is set to
+ * 1 if the ith was resealed, and 0 (with its output zeroed) if its
+ * old tag was wrong.
+ */
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_reseal_many(
+  unsigned char *out,
+  unsigned char *okflags,
+  const unsigned char *c,
+  const unsigned long long *lens,unsigned long long n,
+  const unsigned char *on,
+  const unsigned char *ok,
+  const unsigned char *nn,
+  const unsigned char *nk
+)
+{
+  unsigned long long i, j;
+
+  NACL_PROBE_ENTRY(xsalsa20poly1305_reseal_many,n);
+  for (i = 0;i < n;++i) {
+    okflags[i] = xsalsa20poly1305_reseal(out,c,lens[i],
+                                         on + 24*i,ok,nn + 24*i,nk) == 0;
+    if (!okflags[i])
+      for (j = 0;j < lens[i];++j) out[j] = 0;
+    out += lens[i];
+    c   += lens[i];
+  }
+  NACL_PROBE_RETURN(xsalsa20poly1305_reseal_many,n,0);
+}
+
+/*
+ * Incremental sealing, for messages which arrive in pieces: the
+ * ciphertext and tag are the same as xsalsa20poly1305_seal_detached
+ * of the whole message. Each piece is encrypted into c (which may
+ * equal m) and added to the tag as soon as it is given; a partly
+ * used keystream block is carried over to the next piece.
+ */
+
+#ifdef PRIVATE_API
+static
+#endif
+unsigned long xsalsa20poly1305_seal_statebytes(void)
+{
+  return sizeof(struct xsalsa20poly1305_seal_state);
+}
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_seal_init(
+  struct xsalsa20poly1305_seal_state *st,
+  const unsigned char *n,
+  const unsigned char *k
+)
+{
+  unsigned char in[16];
+  int i;
+
+  crypto_core_hsalsa20(st->subkey,n,k,sigma);
+  for (i = 0;i < 8;++i) st->n[i] = in[i] = n[16 + i];
+  for (i = 8;i < 16;++i) in[i] = 0;
+  crypto_core_salsa20(st->block,in,st->subkey,sigma);
+  poly1305_init(&st->mac,st->block);
+
+  /* The first 32 bytes of block 0 are the poly1305 key. */
+  st->used = 32;
+  st->ic = 1;
+}
+
+/* Encrypt or decrypt the next mlen bytes of the stream. */
+static void xsalsa20poly1305_state_xor(
+  struct xsalsa20poly1305_seal_state *st,
+  unsigned char *c,
+  const unsigned char *m,unsigned long long mlen
+)
+{
+  unsigned char in[16];
+  unsigned long long i, len, off = 0;
+
+  while (off < mlen) {
+    if (st->used == 64) {
+      len = (mlen - off) & ~63ULL;
+      if (len) {
+        crypto_stream_salsa20_xor_ic(c + off,m + off,len,st->n,st->ic,st->subkey);
+        st->ic += len / 64;
+        off += len;
+        continue;
+      }
+      for (i = 0;i < 8;++i) in[i] = st->n[i];
+      for (i = 0;i < 8;++i) in[8 + i] = st->ic >> (8 * i);
+      crypto_core_salsa20(st->block,in,st->subkey,sigma);
+      st->ic++;
+      st->used = 0;
+    }
+    for (;off < mlen && st->used < 64;++off)
+      c[off] = m[off] ^ st->block[st->used++];
+  }
+}
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_seal_update(
+  struct xsalsa20poly1305_seal_state *st,
+  unsigned char *c,
+  const unsigned char *m,unsigned long long mlen
+)
+{
+  NACL_PROBE_ENTRY(xsalsa20poly1305_seal_update,mlen);
+  xsalsa20poly1305_state_xor(st,c,m,mlen);
+  poly1305_update(&st->mac,c,mlen);
+  NACL_PROBE_RETURN(xsalsa20poly1305_seal_update,mlen,0);
+}
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_seal_final(
+  struct xsalsa20poly1305_seal_state *st,
+  unsigned char *mac
+)
+{
+  int i;
+  poly1305_finish(&st->mac,mac);
+  for (i = 0;i < 64;++i) st->block[i] = 0;
+  for (i = 0;i < 32;++i) st->subkey[i] = 0;
+}
+
+/*
+ * Checking a tag incrementally, with the same state: start with
+ * xsalsa20poly1305_seal_init, pass the ciphertext (without its tag)
+ * to xsalsa20poly1305_verify_update in pieces, and finish with
+ * xsalsa20poly1305_verify_final, which returns 0 if mac is correct
+ * and -1 otherwise.
+ */
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_verify_update(
+  struct xsalsa20poly1305_seal_state *st,
+  const unsigned char *c,unsigned long long clen
+)
+{
+  NACL_PROBE_ENTRY(xsalsa20poly1305_verify_update,clen);
+  poly1305_update(&st->mac,c,clen);
+  NACL_PROBE_RETURN(xsalsa20poly1305_verify_update,clen,0);
+}
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_verify_final(
+  struct xsalsa20poly1305_seal_state *st,
+  const unsigned char *mac
+)
+{
+  unsigned char correct[16];
+  int i, r;
+
+  xsalsa20poly1305_seal_final(st,correct);
+  r = poly1305_verify(mac,correct) ? 0 : -1;
+  for (i = 0;i < 16;++i) correct[i] = 0;
+  return r;
+}
+
+/*
+ * Check the tag of c (as returned by Crypto.Encrypt.SecretBox.encrypt,
+ * i.e. the tag and then clen - 16 bytes of ciphertext) without
+ * decrypting anything. Returns 0 if it is correct.
+ */
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_verify(
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *k
+)
+{
+  struct xsalsa20poly1305_seal_state st;
+  int r = -1;
+
+  NACL_PROBE_ENTRY(xsalsa20poly1305_verify,clen);
+  if (clen >= 16) {
+    xsalsa20poly1305_seal_init(&st,n,k);
+    xsalsa20poly1305_verify_update(&st,c + 16,clen - 16);
+    r = xsalsa20poly1305_verify_final(&st,c);
+  }
+  NACL_PROBE_RETURN(xsalsa20poly1305_verify,clen,r);
+  return r;
+}
+
+/*
+ * Verify and decrypt c (in the same format) into the clen - 16 bytes
+ * at m. This takes two passes over c: the whole tag is checked first,
+ * and only then is anything decrypted, so m is never written to if
+ * the tag is wrong and no unverified plaintext is ever exposed. The
+ * price is reading c twice, which costs the cache misses of a second
+ * pass once c is larger than the cache. m may equal c + 16.
+ */
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_open_into(
+  unsigned char *m,
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *k
+)
+{
+  struct xsalsa20poly1305_seal_state st, dec;
+  int i, r = -1;
+
+  NACL_PROBE_ENTRY(xsalsa20poly1305_open_into,clen);
+  if (clen < 16) goto done;
+
+  xsalsa20poly1305_seal_init(&st,n,k);
+  dec = st;
+  xsalsa20poly1305_verify_update(&st,c + 16,clen - 16);
+  r = xsalsa20poly1305_verify_final(&st,c);
+  if (r == 0)
+    xsalsa20poly1305_state_xor(&dec,m,c + 16,clen - 16);
+  for (i = 0;i < 64;++i) dec.block[i] = 0;
+  for (i = 0;i < 32;++i) dec.subkey[i] = 0;
+
+done:
+  NACL_PROBE_RETURN(xsalsa20poly1305_open_into,clen,r);
+  return r;
+}
+
+/*
+ * Trial decryption, for boxes whose key is one of many candidates:
+ * find the first of the nkeys keys (32 bytes each, back to back)
+ * under which the tag of c (in the same format as above) is correct,
+ * and decrypt c with it into the clen - 16 bytes at m. Returns the
+ * index of that key, or -1 if there is none (m is left untouched).
+ *
+ * Only the poly1305 key (the first 32 bytes of keystream) is derived
+ * for each candidate. With AVX2 that is done for eight keys at a time,
+ * one per 32-bit lane; the tags are then computed four at a time by
+ * poly1305_auth_many, and c is only decrypted once, under the key
+ * which matched.
+ */
+
+#define TRIAL_BATCH 16
+
+#if defined(__AVX2__)
+#define TRIAL_LANES 8
+
+#define ROTATE8(x,c) \
+  _mm256_or_si256(_mm256_slli_epi32(x,c),_mm256_srli_epi32(x,32 - (c)))
+#define QUARTER8(a,b,c,d) \
+  b = _mm256_xor_si256(b,ROTATE8(_mm256_add_epi32(a,d), 7)); \
+  c = _mm256_xor_si256(c,ROTATE8(_mm256_add_epi32(b,a), 9)); \
+  d = _mm256_xor_si256(d,ROTATE8(_mm256_add_epi32(c,b),13)); \
+  a = _mm256_xor_si256(a,ROTATE8(_mm256_add_epi32(d,c),18));
+#define DOUBLEROUND8() \
+  QUARTER8( x0, x4, x8,x12) QUARTER8( x5, x9,x13, x1) \
+  QUARTER8(x10,x14, x2, x6) QUARTER8(x15, x3, x7,x11) \
+  QUARTER8( x0, x1, x2, x3) QUARTER8( x5, x6, x7, x4) \
+  QUARTER8(x10,x11, x8, x9) QUARTER8(x15,x12,x13,x14)
+
+/* Word w of each of up to eight keys, one per lane. */
+static __m256i xsalsa20_lanes(const unsigned char *keys,size_t cnt,int w)
+{
+  uint32 t[TRIAL_LANES];
+  size_t l;
+
+  for (l = 0;l < TRIAL_LANES;++l)
+    t[l] = load_littleendian(keys + 32 * (l < cnt ? l : 0) + 4 * w);
+  return _mm256_loadu_si256((const __m256i *) t);
+}
+
+/* The poly1305 keys for up to eight keys at once. */
+static void xsalsa20poly1305_polykeys_lanes(
+  unsigned char *pk,
+  const unsigned char *n,
+  const unsigned char *keys,size_t cnt
+)
+{
+  __m256i x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
+  __m256i k[8], z[8];
+  uint32 t[8][TRIAL_LANES];
+  size_t l;
+  int i;
+
+  for (i = 0;i < 8;++i) k[i] = xsalsa20_lanes(keys,cnt,i);
+
+  /* HSalsa20(n[0..15], k) */
+  x0 = _mm256_set1_epi32(load_littleendian(sigma + 0));
+  x5 = _mm256_set1_epi32(load_littleendian(sigma + 4));
+  x10 = _mm256_set1_epi32(load_littleendian(sigma + 8));
+  x15 = _mm256_set1_epi32(load_littleendian(sigma + 12));
+  x1 = k[0]; x2 = k[1]; x3 = k[2]; x4 = k[3];
+  x11 = k[4]; x12 = k[5]; x13 = k[6]; x14 = k[7];
+  x6 = _mm256_set1_epi32(load_littleendian(n + 0));
+  x7 = _mm256_set1_epi32(load_littleendian(n + 4));
+  x8 = _mm256_set1_epi32(load_littleendian(n + 8));
+  x9 = _mm256_set1_epi32(load_littleendian(n + 12));
+  for (i = ROUNDS;i > 0;i -= 2) { DOUBLEROUND8() }
+
+  /* Salsa20(n[16..23] || 0, subkey), of which we need words 0..7 */
+  k[0] = x0; k[1] = x5; k[2] = x10; k[3] = x15;
+  k[4] = x6; k[5] = x7; k[6] = x8; k[7] = x9;
+  x0 = _mm256_set1_epi32(load_littleendian(sigma + 0));
+  x5 = _mm256_set1_epi32(load_littleendian(sigma + 4));
+  x10 = _mm256_set1_epi32(load_littleendian(sigma + 8));
+  x15 = _mm256_set1_epi32(load_littleendian(sigma + 12));
+  x1 = k[0]; x2 = k[1]; x3 = k[2]; x4 = k[3];
+  x11 = k[4]; x12 = k[5]; x13 = k[6]; x14 = k[7];
+  x6 = _mm256_set1_epi32(load_littleendian(n + 16));
+  x7 = _mm256_set1_epi32(load_littleendian(n + 20));
+  x8 = _mm256_setzero_si256();
+  x9 = _mm256_setzero_si256();
+  z[0] = x0; z[1] = x1; z[2] = x2; z[3] = x3;
+  z[4] = x4; z[5] = x5; z[6] = x6; z[7] = x7;
+  for (i = ROUNDS;i > 0;i -= 2) { DOUBLEROUND8() }
+  z[0] = _mm256_add_epi32(z[0],x0); z[1] = _mm256_add_epi32(z[1],x1);
+  z[2] = _mm256_add_epi32(z[2],x2); z[3] = _mm256_add_epi32(z[3],x3);
+  z[4] = _mm256_add_epi32(z[4],x4); z[5] = _mm256_add_epi32(z[5],x5);
+  z[6] = _mm256_add_epi32(z[6],x6); z[7] = _mm256_add_epi32(z[7],x7);
+
+  for (i = 0;i < 8;++i) _mm256_storeu_si256((__m256i *) t[i],z[i]);
+  for (l = 0;l < cnt;++l)
+    for (i = 0;i < 8;++i) store_littleendian(pk + 32 * l + 4 * i,t[i][l]);
+  for (i = 0;i < 8;++i)
+    for (l = 0;l < TRIAL_LANES;++l) t[i][l] = 0;
+}
+#endif
+
+/* The poly1305 key for each of cnt keys. */
+static void xsalsa20poly1305_polykeys(
+  unsigned char *pk,
+  const unsigned char *n,
+  const unsigned char *keys,size_t cnt
+)
+{
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (;i < cnt;i += TRIAL_LANES)
+    xsalsa20poly1305_polykeys_lanes(pk + 32 * i,n,keys + 32 * i,
+                                    cnt - i < TRIAL_LANES ? cnt - i : TRIAL_LANES);
+#else
+  unsigned char subkey[32], in[16], block[64];
+  int j;
+
+  for (j = 0;j < 8;++j) in[j] = n[16 + j];
+  for (j = 8;j < 16;++j) in[j] = 0;
+  for (;i < cnt;++i) {
+    crypto_core_hsalsa20(subkey,n,keys + 32 * i,sigma);
+    crypto_core_salsa20(block,in,subkey,sigma);
+    for (j = 0;j < 32;++j) pk[32 * i + j] = block[j];
+  }
+  for (j = 0;j < 32;++j) subkey[j] = 0;
+  for (j = 0;j < 64;++j) block[j] = 0;
+#endif
+}
+
+/* Find the first of nkeys keys c was sealed under, and open c into m
+   with it. With m NULL, only the search is done. */
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_trial_open(
+  unsigned char *m,
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *keys,unsigned long long nkeys
+)
+{
+  struct xsalsa20poly1305_seal_state st;
+  unsigned char pk[32 * TRIAL_BATCH], tags[16 * TRIAL_BATCH];
+  const unsigned char *ms[TRIAL_BATCH];
+  size_t lens[TRIAL_BATCH];
+  unsigned long long i, j, cnt;
+  long long found = -1;
+
+  NACL_PROBE_ENTRY(xsalsa20poly1305_trial_open,clen);
+  if (clen < 16) goto done;
+
+  for (j = 0;j < TRIAL_BATCH;++j) {
+    ms[j] = c + 16;
+    lens[j] = clen - 16;
+  }
+  for (i = 0;i < nkeys && found < 0;i += cnt) {
+    cnt = nkeys - i < TRIAL_BATCH ? nkeys - i : TRIAL_BATCH;
+    xsalsa20poly1305_polykeys(pk,n,keys + 32 * i,cnt);
+    poly1305_auth_many(tags,ms,lens,pk,cnt);
+    for (j = 0;j < cnt;++j)
+      if (poly1305_verify(c,tags + 16 * j) && found < 0) found = i + j;
+  }
+  for (j = 0;j < sizeof pk;++j) pk[j] = 0;
+
+  if (found >= 0 && m) {
+    xsalsa20poly1305_seal_init(&st,n,keys + 32 * found);
+    xsalsa20poly1305_state_xor(&st,m,c + 16,clen - 16);
+    xsalsa20poly1305_seal_final(&st,tags);
+  }
+
+done:
+  NACL_PROBE_RETURN(xsalsa20poly1305_trial_open,clen,(int) found);
+  return (int) found;
+}
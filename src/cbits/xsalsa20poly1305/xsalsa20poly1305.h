@@ -19,4 +19,110 @@ int xsalsa20poly1305_secretbox_open(
   const unsigned char *n,
   const unsigned char *k);
 
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_reseal(
+  unsigned char *out,
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *on,
+  const unsigned char *ok,
+  const unsigned char *nn,
+  const unsigned char *nk);
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_reseal_many(
+  unsigned char *out,
+  unsigned char *okflags,
+  const unsigned char *c,
+  const unsigned long long *lens,unsigned long long n,
+  const unsigned char *on,
+  const unsigned char *ok,
+  const unsigned char *nn,
+  const unsigned char *nk);
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_open_detached(
+  unsigned char *m,
+  const unsigned char *c,
+  const unsigned char *mac,
+  unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *k);
+
+/* Opaque; allocate xsalsa20poly1305_seal_statebytes() bytes. */
+struct xsalsa20poly1305_seal_state;
+
+#ifdef PRIVATE_API
+static
+#endif
+unsigned long xsalsa20poly1305_seal_statebytes(void);
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_seal_init(
+  struct xsalsa20poly1305_seal_state *st,
+  const unsigned char *n,
+  const unsigned char *k);
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_seal_update(
+  struct xsalsa20poly1305_seal_state *st,
+  unsigned char *c,
+  const unsigned char *m,unsigned long long mlen);
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_seal_final(
+  struct xsalsa20poly1305_seal_state *st,
+  unsigned char *mac);
+
+#ifdef PRIVATE_API
+static
+#endif
+void xsalsa20poly1305_verify_update(
+  struct xsalsa20poly1305_seal_state *st,
+  const unsigned char *c,unsigned long long clen);
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_verify_final(
+  struct xsalsa20poly1305_seal_state *st,
+  const unsigned char *mac);
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_verify(
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *k);
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_open_into(
+  unsigned char *m,
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *k);
+
+#ifdef PRIVATE_API
+static
+#endif
+int xsalsa20poly1305_trial_open(
+  unsigned char *m,
+  const unsigned char *c,unsigned long long clen,
+  const unsigned char *n,
+  const unsigned char *keys,unsigned long long nkeys);
+
 #endif /* _XSALSA20POLY1305_H_ */
@@ -0,0 +1,53 @@
+module Array
+       ( tests -- :: Int -> Tests
+       ) where
+import           Control.Monad
+import           Data.ByteString   (ByteString)
+import qualified Data.ByteString   as S
+
+import           Crypto.NaCl.Array (Array)
+import qualified Crypto.NaCl.Array as A
+
+import           Test.QuickCheck
+import           Util
+
+--------------------------------------------------------------------------------
+-- Orphans
+
+-- A list of 8-byte records.
+newtype Records = Records [ByteString] deriving Show
+instance Arbitrary Records where
+  arbitrary = Records `liftM` listOf (S.pack `liftM` vector 8)
+
+pack :: Records -> Array ByteString
+pack (Records xs) = maybe (A.empty 8) id (A.fromList 8 xs)
+
+--------------------------------------------------------------------------------
+-- Tests
+
+roundtrip :: Records -> Bool
+roundtrip r@(Records xs) = A.toList (pack r) == xs
+                        && A.length (pack r) == length xs
+
+indexing :: Records -> Int -> Bool
+indexing r@(Records xs) i = A.index (pack r) i == lookup i (zip [0..] xs)
+
+slicing :: Records -> Int -> Int -> Bool
+slicing r@(Records xs) i n =
+  A.toList (A.slice i n (pack r)) == take (max 0 n) (drop (max 0 i) xs)
+
+-- Buffers that are not a whole number of records are rejected.
+badSize :: Records -> Bool
+badSize r = A.fromBytes 8 (S.snoc (A.toBytes (pack r)) 0) == (Nothing :: Maybe (Array ByteString))
+         && A.fromList 8 [S.replicate 7 0] == (Nothing :: Maybe (Array ByteString))
+
+tests :: Int -> Tests
+tests ntests =
+  [ ("array roundtrip", wrap roundtrip)
+  , ("array index",     wrap indexing)
+  , ("array slice",     wrap slicing)
+  , ("array bad size",  wrap badSize)
+  ]
+  where
+    wrap :: Testable prop => prop -> IO (Bool, Int)
+    wrap = mkArgTest ntests
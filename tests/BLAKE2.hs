@@ -6,8 +6,12 @@ module BLAKE2
 import           Data.ByteString        (ByteString)
 import qualified Data.ByteString        as S
 import           Data.ByteString.Base16
+import           Data.Maybe             (fromJust)
+import           Data.Word
 
 import           Crypto.Hash.BLAKE2
+import           Crypto.KDF.BLAKE2
+import           Crypto.Key
 
 import           Test.QuickCheck
 import           Util
@@ -65,6 +69,29 @@ vector2bp = blake2bp plainText == expectation
       "d072a4d03ef16c4fe067580f7c495f9e2432e110de1858bda44991558c7fff0e\
       \320efe983136ad3c157cfe83533509559f684684dac5aeb1456a7148ccc73753"
 
+--------------------------------------------------------------------------------
+-- Key derivation
+
+kdfMaster :: MasterKey
+kdfMaster = fromJust $ masterKey (S.pack [0..31])
+
+-- Same vector as libsodium's crypto_kdf test
+vectorKDF :: Bool
+vectorKDF = unSecretKey (deriveKey kdfMaster 0 ctx) == expectation
+  where
+    ctx = fromJust $ context "Examples"
+    expectation = (fst . decode)
+      "d676d6d54480f13ed75c930629f21919bf7126656e4b7f9ef045ee34ac288161"
+
+batchKDF :: [Word64] -> Bool
+batchKDF ids = deriveKeys kdfMaster ids ctx == map (\i -> deriveKey kdfMaster i ctx) ids
+  where ctx = fromJust $ context "batch"
+
+contextKDF :: Word64 -> Bool
+contextKDF i = deriveKey kdfMaster i c1 /= (deriveKey kdfMaster i c2 :: SecretKey ())
+  where c1 = fromJust $ context "one"
+        c2 = fromJust $ context "two"
+
 tests :: Int -> Tests
 tests ntests =
   [ ("blake2s  purity", wrapArg pure2s)
@@ -79,6 +106,9 @@ tests ntests =
   , ("blake2bp purity", wrapArg pure2bp)
   , ("blake2bp length", wrapArg length2bp)
   , ("blake2bp vector", wrap    vector2bp)
+  , ("blake2b-kdf vector",  wrap    vectorKDF)
+  , ("blake2b-kdf batch",   wrapArg batchKDF)
+  , ("blake2b-kdf context", wrapArg contextKDF)
   ]
   where
     wrap, wrapArg :: Testable prop => prop -> IO (Bool, Int)
@@ -0,0 +1,54 @@
+module Batch
+       ( tests -- :: Int -> Tests
+       ) where
+import           Data.ByteString           (ByteString)
+import qualified Data.ByteString           as S
+
+import           Crypto.Sign.Batch
+import           Crypto.Sign.Ed25519
+import           Crypto.Sign.Ed25519.Cache
+
+import           Test.QuickCheck
+import           Util
+
+--------------------------------------------------------------------------------
+-- Tests
+
+-- Every message verifies against its own proof, and not against the
+-- proof of a different message.
+proofs :: NonEmptyList ByteString -> Property
+proofs (NonEmpty xs) = ioProperty $ do
+  (pk,sk) <- createKeypair
+  let ps = signBatch sk xs
+      others = drop 1 ps ++ take 1 ps
+  return $ and (zipWith (verifyBatch pk) xs ps)
+        && and [ not (verifyBatch pk x p) | (x, p) <- zip xs others
+                                          , x /= xs !! proofIndex p ]
+
+-- Proofs survive serialization, and truncated ones are rejected.
+encoding :: NonEmptyList ByteString -> Property
+encoding (NonEmpty xs) = ioProperty $ do
+  (_,sk) <- createKeypair
+  let ps = signBatch sk xs
+  return $ all (\p -> decodeProof (encodeProof p) == Just p) ps
+        && all (\p -> decodeProof (S.init (encodeProof p)) == Nothing) ps
+
+-- Only the first message of a batch needs a signature verification.
+cached :: NonEmptyList ByteString -> Property
+cached (NonEmpty xs) = ioProperty $ do
+  (pk,sk) <- createKeypair
+  cache <- newVerifyCache 16
+  ok <- sequence (zipWith (verifyInBatch cache pk) xs (signBatch sk xs))
+  st <- cacheStats cache
+  return $ and ok && cacheMisses st == 1
+        && cacheHits st == fromIntegral (length xs - 1)
+
+tests :: Int -> Tests
+tests ntests =
+  [ ("batch sign proofs",   wrap proofs)
+  , ("batch sign encoding", wrap encoding)
+  , ("batch sign cached",   wrap cached)
+  ]
+  where
+    wrap :: Testable prop => prop -> IO (Bool, Int)
+    wrap = mkArgTest ntests
@@ -1,11 +1,18 @@
 module Box
        ( tests -- :: Int -> Tests
        ) where
+import           Control.Monad
 import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as S
+import           Data.List                (findIndex)
+import           Data.Maybe               (fromJust, isJust, isNothing)
 
 import           Crypto.Encrypt.Box
+import qualified Crypto.Encrypt.Box.Snapshot as Snapshot
+import qualified Crypto.Encrypt.SecretBox    as SecretBox
 import           Crypto.Key
 import           Crypto.Nonce
+import           System.Crypto.Random
 
 import           Test.QuickCheck
 import           Util
@@ -38,10 +45,72 @@ roundtripNM xs
       dec = decryptNM nm2 nonce enc
   in maybe False (== xs) dec
 
+-- A prepared peer key must give exactly the same NM.
+preparedNM :: Property
+preparedNM = secretboxProp $ \(pk1,_) (_,sk2) _ ->
+  createNMPrepared (preparePeerKey pk1) sk2 == createNM pk1 sk2
+
+-- A sealed snapshot should come back intact under the right key, and
+-- be rejected under any other; likewise through a file.
+snapshotRoundtrip :: Property
+snapshotRoundtrip = ioProperty $ do
+  (pk1,sk1) <- createKeypair
+  (pk2,_)   <- createKeypair
+  k1 <- SecretBox.randomKey
+  k2 <- SecretBox.randomKey
+  n  <- randomNonce
+  let snap = Snapshot.precompute sk1 [pk1, pk2]
+      enc  = Snapshot.encodeSnapshot k1 n snap
+  file <- withTemp "nacl-snap" $ \path -> do
+    Snapshot.writeSnapshot path k1 snap
+    Snapshot.readSnapshot path k1
+  return $ Snapshot.decodeSnapshot k1 enc == Just snap
+        && isNothing (Snapshot.decodeSnapshot k2 enc)
+        && Snapshot.lookupNM snap pk2 sk1 == createNM pk2 sk1
+        && file == snap
+
+-- NMs can only be rebuilt from exactly 32 bytes.
+nmBytes :: ByteString -> Bool
+nmBytes xs = check xs && check (S.take 32 (xs `S.append` S.replicate 32 0))
+  where check ys = fmap nmToBytes (nmFromBytes ys)
+                == if S.length ys == 32 then Just ys else Nothing
+
+-- Random bytes make as good a candidate NM as any.
+randomNM :: IO NM
+randomNM = (fromJust . nmFromBytes) `fmap` randombytes 32
+
+-- Trial decryption finds the same candidate as trying decryptNM with
+-- each in turn, including when there is none.
+trialEquiv :: ByteString -> Small Int -> Small Int -> Property
+trialEquiv xs (Small k) (Small at) = ioProperty $ do
+  nms   <- replicateM (k `mod` 40) randomNM
+  other <- randomNM
+  nonce <- randomNonce
+  let key   = if at >= 0 && at < length nms then nms !! at else other
+      c     = encryptNM key nonce xs
+      tries = [ decryptNM nm nonce c | nm <- nms ]
+      want  = fmap (\i -> (i, xs)) (findIndex isJust tries)
+  return $ trialOpen nms nonce c == want
+        && isNothing (trialOpen nms nonce (S.drop 1 c))
+
+-- With none of the candidates right, there is nothing to open.
+trialNone :: ByteString -> Property
+trialNone xs = ioProperty $ do
+  nms   <- replicateM 20 randomNM
+  other <- randomNM
+  nonce <- randomNonce
+  return $ isNothing (trialOpen nms nonce (encryptNM other nonce xs))
+        && isNothing (trialOpen [] nonce (encryptNM other nonce xs))
+
 tests :: Int -> Tests
 tests ntests =
   [ ("curve25519xsalsa20poly1305 roundtrip",    wrap roundtrip)
   , ("curve25519xsalsa20poly1305-NM roundtrip", wrap roundtripNM)
+  , ("curve25519xsalsa20poly1305-NM prepared",  wrap preparedNM)
+  , ("curve25519xsalsa20poly1305-NM bytes",     wrap nmBytes)
+  , ("curve25519xsalsa20poly1305-NM snapshot",  wrap snapshotRoundtrip)
+  , ("curve25519xsalsa20poly1305-NM trial",     wrap trialEquiv)
+  , ("curve25519xsalsa20poly1305-NM trial none", wrap trialNone)
   ]
   where
     wrap :: Testable prop => prop -> IO (Bool, Int)
@@ -22,9 +22,14 @@ roundtrip :: Property
 roundtrip = keypairProp $ \(p1,s2) (p2,s1) ->
   curve25519 s1 p1 == curve25519 s2 p2
 
+prepared :: Property
+prepared = keypairProp $ \(p1,_) (_,s2) ->
+  curve25519Prepared s2 (preparePeerKey p1) == curve25519 s2 p1
+
 tests :: Int -> [(String, IO (Bool,Int))]
 tests ntests =
   [ ("curve25519 roundtrip",            wrap roundtrip)
+  , ("curve25519 prepared peer key",    wrap prepared)
   ]
   where
     wrap :: Testable prop => prop -> IO (Bool, Int)
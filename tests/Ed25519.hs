@@ -7,7 +7,9 @@ import           Data.ByteString          (ByteString)
 import qualified Data.ByteString          as S
 
 import           Crypto.Key
+import qualified Crypto.NaCl.Array         as A
 import           Crypto.Sign.Ed25519
+import           Crypto.Sign.Ed25519.Cache
 
 import           Test.QuickCheck
 import           Util
@@ -45,6 +47,71 @@ signLength2 xs
   = keypairProp $ \(_,sk) ->
       (64 == S.length (unSignature $ sign' sk xs))
 
+-- Every key out of a batch should sign and verify, and no two
+-- secret keys should be the same.
+batchKeypairs :: Positive Int -> ByteString -> Property
+batchKeypairs (Positive n) xs = ioProperty $ do
+  kps <- createKeypairs (n `mod` 100)
+  let sks = map snd kps
+  return $ all (\(pk,sk) -> verify' pk xs (sign' sk xs)) kps
+        && and (zipWith (/=) sks (drop 1 sks))
+        && length kps == n `mod` 100
+
+-- The cache must agree with verify', and a repeated good signature
+-- should be answered from the cache.
+cachedVerify :: ByteString -> ByteString -> Property
+cachedVerify xs ys = ioProperty $ do
+  (pk,sk) <- createKeypair
+  cache <- newVerifyCache 16
+  let sig = sign' sk xs
+  r1 <- verifyCached cache pk xs sig
+  r2 <- verifyCached cache pk xs sig
+  r3 <- verifyCached cache pk ys sig
+  st <- cacheStats cache
+  return $ r1 && r2 && r3 == verify' pk ys sig && cacheHits st >= 1
+
+-- Moving bytes between the signature and the message of a cached
+-- triple must not hit the cache.
+cachedShifted :: ByteString -> Property
+cachedShifted xs = not (S.null xs) ==> ioProperty $ do
+  (pk,sk) <- createKeypair
+  cache <- newVerifyCache 16
+  let sig@(Signature sb) = sign' sk xs
+  r1 <- verifyCached cache pk xs sig
+  r2 <- verifyCached cache pk (S.drop 1 xs) (Signature (sb `S.append` S.take 1 xs))
+  return $ r1 && not r2
+
+-- Prepared keys accept exactly what their public keys accept.
+preparedVerify :: ByteString -> ByteString -> Property
+preparedVerify xs ys = ioProperty $ do
+  (pks, sks) <- createKeypairArrays 4
+  let (prep, ok) = prepareKeys pks
+      sig        = sign' (A.unsafeIndex sks 0) xs
+      sm         = sign (A.unsafeIndex sks 0) xs
+      check k m  = fmap (\p -> verifyPrepared' p m sig) (indexPrepared prep k)
+                == Just (verify' (A.unsafeIndex pks k) m sig)
+      check' k m = fmap (\p -> verifyPrepared p m) (indexPrepared prep k)
+                == Just (verify (A.unsafeIndex pks k) m)
+  return $ and ok && and [ check k m | k <- [0..3], m <- [xs, ys] ]
+        && and [ check' k m | k <- [0..3], m <- [sm, S.drop 1 sm, ys] ]
+        && length (preparedKeys prep) == 4
+        && indexPrepared prep 4 == Nothing
+
+-- verifyMany agrees with verify' item by item, including for bad
+-- messages and truncated signatures.
+manyVerify :: [ByteString] -> ByteString -> Property
+manyVerify ms ys = ioProperty $ do
+  (pk,sk) <- createKeypair
+  let good  = [ (pk, m, sign' sk m) | m <- ms ]
+      bad   = [ (pk, m `S.append` ys, sig) | (_, m, sig) <- good, not (S.null ys) ]
+      short = [ (pk, m, Signature (S.take 63 (unSignature sig))) | (_, m, sig) <- good ]
+      items = concat (zipWith3 (\a b c -> [a, b, c]) good (bad ++ repeat (head good)) short)
+  return $ verifyMany items == map (\(k,m,sig) -> verify' k m sig) items
+        && and (verifyMany good)
+
+-- y = 2 is not the y coordinate of any point.
+preparedInvalid :: Bool
+preparedInvalid = prepareKey (PublicKey (S.cons 2 (S.replicate 31 0))) == Nothing
 
 tests :: Int -> Tests
 tests ntests =
@@ -52,6 +119,12 @@ tests ntests =
   , ("ed25519 roundtrip #2",     wrap roundtrip')
   , ("ed25519 signature len",    wrap signLength)
   , ("ed25519 signature len #2", wrap signLength2)
+  , ("ed25519 batch keypairs",   wrap batchKeypairs)
+  , ("ed25519 cached verify",    wrap cachedVerify)
+  , ("ed25519 cached shifted",   wrap cachedShifted)
+  , ("ed25519 prepared verify",  wrap preparedVerify)
+  , ("ed25519 prepared invalid", wrap preparedInvalid)
+  , ("ed25519 verifyMany",       wrap manyVerify)
   ]
   where
     wrap :: Testable prop => prop -> IO (Bool, Int)
@@ -5,6 +5,9 @@ module HMACSHA512
 import           Control.Monad
 import           Data.ByteString    (ByteString)
 import qualified Data.ByteString    as S
+import           Data.ByteString.Builder
+import qualified Data.ByteString.Lazy as L
+import           Data.Monoid        (mconcat)
 
 import           Crypto.HMAC.SHA512
 import           Crypto.Key
@@ -26,10 +29,21 @@ roundtrip :: K2 -> ByteString -> Bool
 roundtrip (K2 k) xs = verify k' (authenticate k' xs) xs
   where k' = SecretKey k
 
+-- An authenticated builder is its message followed by the message's
+-- authenticator, however its chunks are written.
+builderEquiv :: K2 -> [ByteString] -> Bool
+builderEquiv (K2 k) xs = xs' == m `S.append` unAuth (authenticate k' m)
+  where k'  = SecretKey k
+        b   = mconcat (zipWith piece [0 :: Int ..] xs)
+        piece i x | even i    = byteString (S.concat (replicate 300 x))
+                  | otherwise = byteStringInsert x
+        m   = L.toStrict (toLazyByteString b)
+        xs' = L.toStrict (toLazyByteString (hmacBuilder k' b))
 
 tests :: Int -> Tests
 tests ntests =
   [ ("hmac-sha512256 roundtrip", wrap roundtrip)
+  , ("hmac-sha512256 builder",   wrap builderEquiv)
   ]
   where
     wrap :: Testable prop => prop -> IO (Bool, Int)
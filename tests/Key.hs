@@ -0,0 +1,51 @@
+module Key
+       ( tests -- :: Int -> Tests
+       ) where
+import           Control.Monad
+import           Data.Char             (toUpper)
+import           Data.Maybe            (isNothing)
+import           Data.ByteString       (ByteString)
+import qualified Data.ByteString.Char8 as S8
+
+import           Crypto.Key
+import           Crypto.Sign.Ed25519
+
+import           Test.QuickCheck
+import           Util
+
+--------------------------------------------------------------------------------
+-- Hex encoding
+
+hexRoundtrip :: ByteString -> Bool
+hexRoundtrip xs = decodeHex (encodeHex xs) == Just xs
+
+hexUpper :: ByteString -> Bool
+hexUpper xs = decodeHex (S8.map toUpper $ encodeHex xs) == Just xs
+
+hexOdd :: ByteString -> Bool
+hexOdd xs = isNothing $ decodeHex (S8.cons '0' $ encodeHex xs)
+
+type KP = (PublicKey Ed25519, SecretKey Ed25519)
+
+keypairProp :: (KP -> Bool) -> Property
+keypairProp k = ioProperty $ k `liftM` createKeypair
+
+showRead :: Property
+showRead = keypairProp $ \(pk,sk) ->
+  read (show pk) == pk && read (show sk) == sk
+
+showReadSig :: ByteString -> Property
+showReadSig xs = keypairProp $ \(_,sk) ->
+  let sig = sign' sk xs in read (show sig) == sig
+
+tests :: Int -> Tests
+tests ntests =
+  [ ("hex roundtrip",           wrap hexRoundtrip)
+  , ("hex uppercase",           wrap hexUpper)
+  , ("hex odd length",          wrap hexOdd)
+  , ("key show/read",           wrap showRead)
+  , ("signature show/read",     wrap showReadSig)
+  ]
+  where
+    wrap :: Testable prop => prop -> IO (Bool, Int)
+    wrap = mkArgTest ntests
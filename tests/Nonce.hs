@@ -2,10 +2,16 @@
 module Nonce
        ( tests -- :: Int -> Tests
        ) where
+import           Control.Concurrent
 import           Control.Monad
+import qualified Data.ByteString          as S
+import           Data.List                (foldl')
+import qualified Data.Set                 as Set
+import           Data.Word
 
 import           Crypto.Encrypt.Box       (Box)
 import           Crypto.Nonce
+import           Crypto.Nonce.Replay
 
 import           Test.QuickCheck
 import           Util
@@ -19,9 +25,80 @@ nonceProp k = ioProperty $ k `liftM` randomNonce
 incPure1 :: Property
 incPure1 = nonceProp $ \(n :: Nonce Box) -> incNonce n == incNonce n
 
+showRead :: Property
+showRead = nonceProp $ \(n :: Nonce Box) -> read (show n) == n
+
+--------------------------------------------------------------------------------
+-- Replay windows
+
+counterNonce :: Word64 -> Nonce Box
+counterNonce c = Nonce (S.replicate 16 0 `S.append` S.pack bytes)
+  where bytes = [ fromIntegral (c `div` 256^i) | i <- [7,6..0 :: Int] ]
+
+-- A window accepts what a set of seen counters and the highest one
+-- accepted say it should, one at a time or as a batch, starting from
+-- the given counter.
+replayModel :: Word64 -> Positive Int -> [(Bool, Word8)] -> Property
+replayModel start (Positive size) steps = ioProperty $ do
+  w  <- newReplayWindow size
+  w' <- newReplayWindow size
+  got   <- mapM (checkAndMark w . counterNonce) ctrs
+  batch <- checkAndMarkMany w' (map counterNonce ctrs)
+  return $ got == expect && batch == expect
+           && map (nonceCounter . counterNonce) ctrs == ctrs
+  where
+    -- Mostly small steps forward, with the odd one back.
+    ctrs = tail $ scanl (\c (back, d) -> if back then c - min c (fromIntegral d)
+                                                else c + fromIntegral d `mod` 8)
+                        start steps
+    expect = reverse . fst $ foldl' model ([], (Set.empty, 0)) ctrs
+    model (acc, (seen, top)) c
+      | fresh     = (True : acc, (Set.insert c seen, max top c))
+      | otherwise = (False : acc, (seen, top))
+      where fresh = c `Set.notMember` seen
+                    && (top < fromIntegral size || c > top - fromIntegral size)
+
+-- Counters from anywhere in the 64-bit range, as a random starting
+-- nonce gives.
+replayAnywhere :: Property
+replayAnywhere = forAll arbitraryBoundedIntegral replayModel
+
+-- A fresh window accepts a run of counters from a random nonce, and
+-- only once.
+replayRandom :: Property
+replayRandom = ioProperty $ do
+  w  <- newReplayWindow 64
+  n0 <- randomNonce
+  let ns = take 100 (iterate incNonce (n0 :: Nonce Box))
+  first  <- mapM (checkAndMark w) ns
+  second <- mapM (checkAndMark w) ns
+  return $ and first && not (or second)
+
+-- However threads race on a window, each counter is accepted once.
+replayOnce :: Property
+replayOnce = ioProperty $ do
+  w    <- newReplayWindow 4096
+  done <- forM [1 .. 4 :: Int] $ \t -> do
+    v <- newEmptyMVar
+    _ <- forkIO $ mapM (checkAndMark w . counterNonce) (order t) >>= putMVar v
+    return v
+  oks <- mapM takeMVar done
+  let accepted = [ c | (t, ok) <- zip [1..] oks, (c, True) <- zip (order t) ok ]
+  return $ Set.size (Set.fromList accepted) == length accepted
+           && length accepted == 1024
+  where order :: Int -> [Word64]
+        order t = [ (c * 7 + fromIntegral t) `mod` 1024 | c <- [0 .. 1023] ]
+
 tests :: Int -> Tests
 tests ntests =
-  [ ("pure incNonce #1", wrap incPure1)
+  [ ("pure incNonce #1",  wrap incPure1)
+  , ("nonce show/read",   wrap showRead)
+  , ("replay window",     wrap (replayModel 1000))
+  , ("replay from 2^51",  wrap (replayModel (2^(51 :: Int))))
+  , ("replay from 2^63",  wrap (replayModel (2^(63 :: Int))))
+  , ("replay anywhere",   wrap replayAnywhere)
+  , ("replay from nonce", wrap replayRandom)
+  , ("replay once",       wrap replayOnce)
   ]
   where
     wrap :: Testable prop => prop -> IO (Bool, Int)
@@ -0,0 +1,55 @@
+module Placement
+       ( tests -- :: Int -> Tests
+       ) where
+import           Data.ByteString       (ByteString)
+import           Data.Maybe            (fromJust)
+
+import           Crypto.Hash.Placement
+import           Crypto.Key
+
+import           Test.QuickCheck
+import           Util
+
+--------------------------------------------------------------------------------
+-- Shard placement
+
+placementProp :: (SecretKey Placement -> Bool) -> Property
+placementProp k = ioProperty $ k `fmap` randomKey
+
+-- Batches agree with single keys, and every key lands in range.
+jumpBatch :: Positive Int -> [ByteString] -> Property
+jumpBatch (Positive n) xs = placementProp $ \key ->
+  let bs = jumpMany key n xs
+  in bs == map (jump key n) xs && all (\b -> b >= 0 && b < n) bs
+
+-- Adding a bucket only moves keys into the new bucket.
+jumpGrow :: Positive Int -> [ByteString] -> Property
+jumpGrow (Positive n) xs = placementProp $ \key ->
+  and (zipWith (\a b -> a == b || b == n) (jumpMany key n xs)
+                                          (jumpMany key (n+1) xs))
+
+rendezvousBatch :: NonEmptyList ByteString -> [ByteString] -> Property
+rendezvousBatch (NonEmpty names) xs = placementProp $ \key ->
+  let ns = fromJust (nodes key names)
+      ps = rendezvousMany ns xs
+  in ps == map (rendezvous ns) xs
+     && all (\p -> p >= 0 && p < length names) ps
+
+-- Removing the last node only moves the keys which were on it.
+rendezvousShrink :: NonEmptyList ByteString -> ByteString -> [ByteString] -> Property
+rendezvousShrink (NonEmpty names) extra xs = placementProp $ \key ->
+  let big   = fromJust (nodes key (names ++ [extra]))
+      small = fromJust (nodes key names)
+  in and (zipWith (\a b -> a == b || a == length names)
+                  (rendezvousMany big xs) (rendezvousMany small xs))
+
+tests :: Int -> Tests
+tests ntests =
+  [ ("placement jump batch",        wrap jumpBatch)
+  , ("placement jump grow",         wrap jumpGrow)
+  , ("placement rendezvous batch",  wrap rendezvousBatch)
+  , ("placement rendezvous shrink", wrap rendezvousShrink)
+  ]
+  where
+    wrap :: Testable prop => prop -> IO (Bool, Int)
+    wrap = mkArgTest ntests
@@ -5,9 +5,11 @@ module Poly1305
 import           Control.Monad
 import           Data.ByteString     (ByteString)
 import qualified Data.ByteString     as S
+import           Data.Maybe          (fromJust)
 
 import           Crypto.Key
 import           Crypto.MAC.Poly1305
+import qualified Crypto.NaCl.Array   as A
 
 import           Test.QuickCheck
 import           Util
@@ -26,9 +28,43 @@ roundtrip :: K2 -> ByteString -> Bool
 roundtrip (K2 k) xs = verify k' (authenticate k' xs) xs
   where k' = SecretKey k
 
+-- Batched authentication agrees with authenticating one at a time,
+-- and corrupted authenticators never verify.
+many :: K2 -> [ByteString] -> Bool
+many (K2 k0) xss = authenticateMany kms == auths
+        && and (verifyMany [ (k, a, m) | ((k, m), a) <- zip kms auths ])
+        && map not (verifyMany [ (k, a, m) | ((k, m), a) <- zip kms (map bad auths) ])
+             == map (const True) kms
+  where kms   = [ (SecretKey (S.map (+i) k0), xs) | (i, xs) <- zip [0..] xss ]
+        auths = [ authenticate k xs | (k, xs) <- kms ]
+        bad (Auth a) = Auth (S.cons (S.head a + 1) (S.tail a))
+
+-- A key of the wrong length in a batch gives an authenticator which
+-- never verifies, and leaves the others alone.
+badKeys :: K2 -> ByteString -> ByteString -> Bool
+badKeys (K2 k0) xs ys = authenticateMany kms == [good, Auth S.empty, good']
+        && verifyMany [ (k, a, m) | ((k, m), a) <- zip kms [good, good, good'] ]
+             == [True, False, True]
+  where short = SecretKey (S.take 31 k0)
+        k1    = SecretKey (S.map (+1) k0)
+        kms   = [(SecretKey k0, xs), (short, xs), (k1, ys)]
+        good  = authenticate (SecretKey k0) xs
+        good' = authenticate k1 ys
+
+-- Packed arrays give the same authenticators as lists.
+packed :: K2 -> [ByteString] -> Bool
+packed (K2 k0) xss = fmap A.toList (authenticateArray keys xss) == Just auths
+        && maybe False (\as -> and (verifyArray keys as xss)) (A.fromList 16 auths)
+  where ks         = [ SecretKey (S.map (+i) k0) | i <- take (length xss) [0..] ]
+        keys       = fromJust (A.fromList 32 ks)
+        auths      = authenticateMany (zip ks xss)
+
 tests :: Int -> Tests
 tests ntests =
   [ ("poly1305 roundtrip", wrap roundtrip)
+  , ("poly1305 many",      wrap many)
+  , ("poly1305 bad keys",  wrap badKeys)
+  , ("poly1305 packed",    wrap packed)
   ]
   where
     wrap :: Testable prop => prop -> IO (Bool, Int)
@@ -0,0 +1,56 @@
+{-# LANGUAGE OverloadedStrings #-}
+
+module ScryptJane
+       ( tests -- :: Int -> Tests
+       ) where
+import           Data.ByteString        (ByteString)
+import qualified Data.ByteString        as S
+import           Data.ByteString.Base16
+import           Data.Maybe             (fromJust)
+
+import           Crypto.KDF.ScryptJane
+
+import           Test.QuickCheck
+import           Util
+
+--------------------------------------------------------------------------------
+-- Stretching
+
+lengthJane :: Positive Int -> ByteString -> Bool
+lengthJane (Positive n) xs = S.length (stretch params n (Salt "salt") xs) == n
+  where params = fromJust (janeParams ChaCha20_8 SHA512 3 0 0)
+
+-- The power-on self test vectors from upstream scrypt-jane
+-- (code/scrypt-jane-test-vectors.h), for the SHA512 instances.
+vector :: Mix -> ByteString -> ByteString -> (Int, Int, Int) -> ByteString
+       -> Bool
+vector mix pass salt (n, r, p) expectation =
+  stretch params 64 (Salt salt) pass == (fst . decode) expectation
+  where params = fromJust (janeParams mix SHA512 n r p)
+
+vectorChaCha1, vectorChaCha2, vectorSalsa64_1, vectorSalsa64_2 :: Bool
+vectorChaCha1 = vector ChaCha20_8 "" "" (3, 0, 0)
+  "e2057c44f9559f64bed57f8569c78c7f2b91d69a6cf8575561253deeb8d58cdc\
+  \2dd553848c06aa3777a6f0f135feb5cb61d72c67f37e8a1b04a3a343a2b229f2"
+vectorChaCha2 = vector ChaCha20_8 "password" "NaCl" (9, 3, 4)
+  "82da29b20827fc7822c4b87ebc36cfcd174ba130164a2570c7cbe02b56d3164e\
+  \85b684e79b7f8bb59433cf334465c8a146f9f5fc74297ed546ecbd95c18024e4"
+vectorSalsa64_1 = vector Salsa64_8 "" "" (3, 0, 0)
+  "a6cb779a641f950253e75c78dba343ffbe104c7be4e191cf67695a2c12d69949\
+  \92fd5aaa124c2ef695468f5e77621629dbe7ab022b9c3503f8d4047d2d7385f1"
+vectorSalsa64_2 = vector Salsa64_8 "password" "NaCl" (9, 3, 4)
+  "54b7cabbaf0fb05fb7106348b315d8b56264896a59c60f869638f0cfd4629061\
+  \7dced61385674af5320374300b5a2f86826e0c3e407adebe426e802bafdbcc94"
+
+tests :: Int -> Tests
+tests ntests =
+  [ ("scrypt-jane length",            wrapArg lengthJane)
+  , ("scrypt-jane chacha vector 1",   wrap    vectorChaCha1)
+  , ("scrypt-jane chacha vector 2",   wrap    vectorChaCha2)
+  , ("scrypt-jane salsa64 vector 1",  wrap    vectorSalsa64_1)
+  , ("scrypt-jane salsa64 vector 2",  wrap    vectorSalsa64_2)
+  ]
+  where
+    wrap, wrapArg :: Testable prop => prop -> IO (Bool, Int)
+    wrap = mkTest
+    wrapArg = mkArgTest ntests
@@ -2,7 +2,15 @@ module SecretBox
        ( tests -- :: Int -> Tests
        ) where
 import           Control.Monad
+import           Data.Maybe               (isJust, isNothing)
 import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as S
+import           Data.ByteString.Builder
+import qualified Data.ByteString.Lazy     as L
+import           Data.Monoid              (mconcat)
+import           Foreign.Marshal.Alloc    (allocaBytes)
+import           Foreign.Marshal.Array    (pokeArray)
+import           Foreign.Ptr              (castPtr)
 
 import           Crypto.Encrypt.SecretBox
 import           Crypto.Key
@@ -24,9 +32,99 @@ roundtrip xs
       dec = decrypt nonce enc key
   in maybe False (== xs) dec
 
+-- Sealed fd streams open again, and not once they are cut short.
+fdRoundtrip :: ByteString -> Property
+fdRoundtrip xs = ioProperty $ do
+  key   <- randomKey
+  nonce <- randomNonce
+  (_, enc) <- throughFds (\i o -> encryptFd nonce i o key) xs
+  (n, dec) <- throughFds (\i o -> decryptFd nonce i o key) enc
+  (bad, _) <- throughFds (\i o -> decryptFd nonce i o key) (S.init enc)
+  return $ n == Just (toInteger (S.length xs)) && dec == xs && isNothing bad
+
+-- A stream of several records, the last one short, opens again; but
+-- not with a byte changed in a record in the middle, nor with the
+-- last record dropped.
+fdLarge :: Property
+fdLarge = once $ ioProperty $ do
+  key   <- randomKey
+  nonce <- randomNonce
+  let xs     = bigInput (3 * 1024 * 1024 + 1001)
+      record = 4 + 16 + 256 * 1024
+      open   = throughFds (\i o -> decryptFd nonce i o key)
+  (_, enc) <- throughFds (\i o -> encryptFd nonce i o key) xs
+  let tampered = S.concat [ S.take (record + 100) enc
+                          , S.map (+1) (S.take 1 (S.drop (record + 100) enc))
+                          , S.drop (record + 101) enc ]
+  (n, dec) <- open enc
+  (bad, _) <- open tampered
+  (cut, _) <- open (S.take (12 * record) enc)
+  return $ n == Just (toInteger (S.length xs)) && dec == xs
+        && S.length enc == S.length xs + 13 * 20
+        && isNothing bad && isNothing cut
+
+-- Resealing is the same as decrypting and encrypting again, and
+-- batches agree with single ciphertexts, forged ones included.
+resealEquiv :: [ByteString] -> Property
+resealEquiv xs = ioProperty $ do
+  k   <- randomKey
+  k'  <- randomKey
+  ns  <- replicateM (length xs) randomNonce
+  ns' <- replicateM (length xs) randomNonce
+  let cs     = zipWith (\n x -> encrypt n x k) ns xs
+      forged = map (S.map (+1)) cs
+      jobs   = zip3 ns ns' cs ++ zip3 ns ns' forged
+      single = [ reseal k n k' n' c | (n, n', c) <- jobs ]
+      expect = map Just (zipWith (\n' x -> encrypt n' x k') ns' xs)
+            ++ map (const Nothing) forged
+  return $ single == expect && resealMany k k' jobs == expect
+
+-- A sealed builder holds the same ciphertext and tag as encrypt, in
+-- the other order, however its chunks are written.
+builderEquiv :: [ByteString] -> Property
+builderEquiv xs = secretboxProp $ \key nonce ->
+  let b     = mconcat (zipWith piece [0 :: Int ..] xs)
+      piece i x | even i    = byteString (S.concat (replicate 300 x))
+                | otherwise = byteStringInsert x
+      plain = L.toStrict (toLazyByteString b)
+      c     = L.toStrict (toLazyByteString (sealedBuilder key nonce b))
+      e     = encrypt nonce plain key
+  in c == S.drop 16 e `S.append` S.take 16 e
+     && openSealed key nonce c == Just plain
+     && isNothing (openSealed key nonce (S.map (+1) c))
+
+-- Opening into a buffer gives the plaintext, or leaves the buffer
+-- untouched for a forged ciphertext; verifying alone agrees with
+-- decrypt.
+openIntoEquiv :: ByteString -> Property
+openIntoEquiv xs = ioProperty $ do
+  key   <- randomKey
+  nonce <- randomNonce
+  let c      = encrypt nonce xs key
+      forged = S.map (+1) c
+      n      = S.length xs
+      into x = allocaBytes n $ \p -> do
+        pokeArray p (replicate n 0xaa)
+        ok <- openInto nonce x key p
+        ys <- S.packCStringLen (castPtr p, n)
+        return (ok, ys)
+  good <- into c
+  bad  <- into forged
+  vh   <- fromHandle (\h -> verifyHandle nonce h key) c
+  vh'  <- fromHandle (\h -> verifyHandle nonce h key) forged
+  return $ good == (True, xs) && bad == (False, S.replicate n 0xaa)
+        && verifyOnly nonce c key && not (verifyOnly nonce forged key)
+        && verifyOnly nonce forged key == isJust (decrypt nonce forged key)
+        && vh && not vh'
+
 tests :: Int -> Tests
 tests ntests =
-  [ ("xsalsa20poly1305 roundtrip", wrap roundtrip)
+  [ ("xsalsa20poly1305 roundtrip",    wrap roundtrip)
+  , ("xsalsa20poly1305 fd roundtrip", wrap fdRoundtrip)
+  , ("xsalsa20poly1305 fd records",   wrap fdLarge)
+  , ("xsalsa20poly1305 reseal",       wrap resealEquiv)
+  , ("xsalsa20poly1305 builder",      wrap builderEquiv)
+  , ("xsalsa20poly1305 open into",    wrap openIntoEquiv)
   ]
   where
     wrap :: Testable prop => prop -> IO (Bool, Int)
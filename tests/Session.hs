@@ -0,0 +1,108 @@
+{-# LANGUAGE OverloadedStrings #-}
+module Session
+       ( tests -- :: Int -> Tests
+       ) where
+import           Control.Concurrent
+import           Control.Exception        (IOException, try)
+import           Data.ByteString          (ByteString)
+import qualified Data.ByteString          as S
+import           System.IO
+
+import           Crypto.Encrypt.Box       (createKeypair)
+import           Crypto.Key
+import           Crypto.Session           (Session)
+import qualified Crypto.Session           as Session
+
+import           Test.QuickCheck
+import           Util
+
+--------------------------------------------------------------------------------
+-- Sessions
+
+-- Run a session on each end of a socket pair, returning what each
+-- end's action returned.
+sessions :: (Session -> IO a) -> (Session -> IO b) -> IO (a, b)
+sessions f g = do
+  (ha, hb) <- socketPair
+  kpa <- createKeypair
+  kpb <- createKeypair
+  v <- newEmptyMVar
+  _ <- forkIO $ Session.handshake ha kpa >>= f >>= putMVar v
+  b <- Session.handshake hb kpb >>= g
+  a <- takeMVar v
+  return (a, b)
+
+-- Receive until the peer closes the session.
+recvAll :: Session -> IO [ByteString]
+recvAll s = Session.recvMany s >>= \xs ->
+  if null xs then Session.close s >> return [] else fmap (xs ++) (recvAll s)
+
+-- Records come out as they went in, in order, and from the right key.
+roundtrip :: [[ByteString]] -> Property
+roundtrip batches = ioProperty $ do
+  (_, got) <- sessions (\s -> mapM_ (Session.sendMany s) batches >> Session.close s)
+                       recvAll
+  return $ got == concat batches
+
+-- A record which is too large is refused without using up a nonce, so
+-- the session carries on.
+oversized :: Property
+oversized = once . ioProperty $ do
+  (r, got) <- sessions
+    (\s -> do r <- try (Session.sendMany s ["before", huge])
+              Session.send s "after"
+              Session.close s
+              return (r :: Either IOException ()))
+    recvAll
+  return $ isLeft r && got == ["after"]
+  where huge = S.replicate (16*1024*1024 + 1) 0
+
+-- A peer which hangs up halfway through a record is an error.
+truncated :: Property
+truncated = once . ioProperty $ do
+  (ha, hb) <- socketPair
+  kp <- createKeypair
+  (PublicKey peer, _) <- createKeypair
+  _ <- forkIO $ do
+    S.hPut ha (peer `S.append` S.replicate 32 0)
+    _ <- S.hGet ha 64
+    S.hPut ha (S.pack [0, 0, 0, 100] `S.append` S.replicate 10 0)
+    hClose ha
+  s <- Session.handshake hb kp
+  r <- try (Session.recv s)
+  return $ isLeft (r :: Either IOException (Maybe ByteString))
+
+-- Two sessions between the same keys never seal a record the same
+-- way, even if the peer's randomness is the same every time.
+fresh :: Property
+fresh = once . ioProperty $ do
+  kp <- createKeypair
+  (PublicKey peer, _) <- createKeypair
+  let run = do
+        (ha, hb) <- socketPair
+        _ <- forkIO $ do
+          s <- Session.handshake ha kp
+          Session.send s "hello"
+          Session.close s
+        S.hPut hb (peer `S.append` S.replicate 32 0)
+        _ <- S.hGet hb 64
+        frame <- S.hGet hb (4 + 16 + 5)
+        hClose hb
+        return frame
+  a <- run
+  b <- run
+  return $ S.length a == 25 && a /= b
+
+isLeft :: Either a b -> Bool
+isLeft = either (const True) (const False)
+
+tests :: Int -> Tests
+tests ntests =
+  [ ("session roundtrip", wrap roundtrip)
+  , ("session oversized", wrap oversized)
+  , ("session truncated", wrap truncated)
+  , ("session fresh",     wrap fresh)
+  ]
+  where
+    wrap :: Testable prop => prop -> IO (Bool, Int)
+    wrap = mkArgTest ntests
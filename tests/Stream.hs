@@ -35,10 +35,28 @@ streamXor xs
       str = stream nonce (S.length xs) key
   in enc == (str `xorBS` xs)
 
+fdEquiv :: ByteString -> Property
+fdEquiv xs = ioProperty $ do
+  key   <- randomKey
+  nonce <- randomNonce
+  (n, enc) <- throughFds (\i o -> encryptFd nonce i o key) xs
+  return $ n == toInteger (S.length xs) && enc == encrypt nonce xs key
+
+-- Several buffers' worth, not a multiple of the buffer size.
+fdLarge :: Property
+fdLarge = once $ ioProperty $ do
+  key   <- randomKey
+  nonce <- randomNonce
+  let xs = bigInput (3 * 1024 * 1024 + 1001)
+  (n, enc) <- throughFds (\i o -> encryptFd nonce i o key) xs
+  return $ n == toInteger (S.length xs) && enc == encrypt nonce xs key
+
 tests :: Int -> Tests
 tests ntests =
   [ ("xsalsa20 roundtrip",        wrap roundtrip)
   , ("xsalsa20 stream/enc equiv", wrap streamXor)
+  , ("xsalsa20 fd/enc equiv",     wrap fdEquiv)
+  , ("xsalsa20 fd/enc large",     wrap fdLarge)
   ]
   where
     wrap :: Testable prop => prop -> IO (Bool, Int)
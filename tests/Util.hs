@@ -1,16 +1,38 @@
 {-# OPTIONS_GHC -fno-warn-orphans #-}
+{-# LANGUAGE ForeignFunctionInterface #-}
 module Util
        ( Test, Tests
        , driver
        , mkArgTest
        , mkTest
+       , throughFds
+       , bigInput
+       , fromHandle
+       , socketPair
+       , withTemp
        ) where
 
+import           Control.Exception  (bracket)
 import           Control.Monad
+import           Data.Bits          (shiftR)
 import           Data.ByteString    (ByteString)
 import qualified Data.ByteString    as S
+import           Data.Word          (Word32)
 
+import           Foreign.C.Error    (throwErrnoIfMinus1, throwErrnoIfMinus1_)
+import           Foreign.C.Types
+import           Foreign.Marshal.Array (allocaArray)
+import           Foreign.Ptr        (Ptr)
+import           Foreign.Storable   (peekElemOff)
 import           System.Environment (getArgs)
+import           System.IO          (Handle, IOMode(ReadMode), hClose,
+                                     hSetBinaryMode, openBinaryTempFile,
+                                     withBinaryFile)
+-- base's own POSIX bindings, rather than a dependency on unix
+import           GHC.IO.Handle.FD   (fdToHandle)
+import           System.Posix.Internals (c_close, c_open, c_unlink, o_RDONLY,
+                                         o_WRONLY, withFilePath)
+import           System.Posix.Types (Fd(..))
 import           Test.QuickCheck
 import           Text.Printf
 
@@ -52,3 +74,69 @@ extractResult r =
     GaveUp  {numTests=n} -> (True , n)
     Failure {numTests=n} -> (False, n)
     _                    -> (False, 0)
+
+--------------------------------------------------------------------------------
+-- File descriptors
+
+-- | Run a function from an input to an output descriptor over the
+-- given input, returning its result and the output.
+throughFds :: (Fd -> Fd -> IO a) -> ByteString -> IO (a, ByteString)
+throughFds k xs =
+  withTemp "nacl-in"  $ \inp ->
+  withTemp "nacl-out" $ \out -> do
+    S.writeFile inp xs
+    r <- bracket (openFd inp o_RDONLY) closeFd $ \i ->
+         bracket (openFd out o_WRONLY) closeFd $ \o ->
+           k i o
+    ys <- S.readFile out
+    return (r, ys)
+  where
+    openFd path flags = fmap Fd . throwErrnoIfMinus1 "open" $
+      withFilePath path $ \p -> c_open p flags 0
+    closeFd (Fd fd) = throwErrnoIfMinus1_ "close" (c_close fd)
+
+-- | @n@ bytes of deterministic, patternless input, for tests which
+-- need more than QuickCheck generates.
+bigInput :: Int -> ByteString
+bigInput n = fst (S.unfoldrN n step (1 :: Word32))
+  where step s = Just (fromIntegral (s `shiftR` 24), s * 1103515245 + 12345)
+
+-- | Run a function over a handle reading the given input.
+fromHandle :: (Handle -> IO a) -> ByteString -> IO a
+fromHandle k xs =
+  withTemp "nacl-in" $ \inp -> do
+    S.writeFile inp xs
+    withBinaryFile inp ReadMode k
+
+-- | Create an empty temporary file, and remove it afterwards.
+withTemp :: String -> (FilePath -> IO a) -> IO a
+withTemp name = bracket mk unlink
+  where
+    mk = do
+      (path, h) <- openBinaryTempFile "." name
+      hClose h
+      return path
+    unlink path = throwErrnoIfMinus1_ "unlink" (withFilePath path c_unlink)
+
+--------------------------------------------------------------------------------
+-- Sockets
+
+-- | A connected pair of Unix domain stream sockets, as binary handles.
+socketPair :: IO (Handle, Handle)
+socketPair =
+  allocaArray 2 $ \fds -> do
+    throwErrnoIfMinus1_ "socketpair" $
+      c_socketpair afUNIX sockSTREAM 0 fds
+    a <- end fds 0
+    b <- end fds 1
+    return (a, b)
+  where
+    afUNIX     = 1
+    sockSTREAM = 1
+    end fds i = do
+      h <- fdToHandle =<< peekElemOff fds i
+      hSetBinaryMode h True
+      return h
+
+foreign import ccall unsafe "socketpair"
+  c_socketpair :: CInt -> CInt -> CInt -> Ptr CInt -> IO CInt
@@ -3,6 +3,8 @@ module Main
        ) where
 import           Util        (driver)
 
+import           Array       (tests)
+import           Batch       (tests)
 import           BLAKE       (tests)
 import           BLAKE2      (tests)
 import           Box         (tests)
@@ -10,23 +12,33 @@ import           ChaCha20    (tests)
 import           Curve25519  (tests)
 import           Ed25519     (tests)
 import           HMACSHA512  (tests)
+import           Key         (tests)
 import           Nonce       (tests)
+import           Placement   (tests)
 import           Poly1305    (tests)
+import           ScryptJane  (tests)
 import           SecretBox   (tests)
+import           Session     (tests)
 import           SHA         (tests)
 import           Siphash2448 (tests)
 import           Stream      (tests)
 
 main :: IO ()
-main = driver $ \n -> BLAKE.tests n
+main = driver $ \n -> Array.tests n
+                   ++ Batch.tests n
+                   ++ BLAKE.tests n
                    ++ BLAKE2.tests n
                    ++ Box.tests n
                    ++ Curve25519.tests n
                    ++ Ed25519.tests n
                    ++ HMACSHA512.tests n
+                   ++ Key.tests n
                    ++ Nonce.tests n
+                   ++ Placement.tests n
                    ++ Poly1305.tests n
+                   ++ ScryptJane.tests n
                    ++ SecretBox.tests n
+                   ++ Session.tests n
                    ++ SHA.tests n
                    ++ Siphash2448.tests n
                    ++ Stream.tests n